@@ -0,0 +1,157 @@
+#ifndef _WIN32
+
+#include "bench.h"
+
+#include <chrono>
+
+#include "configgenerator.h"
+#include "localcdn.h"
+
+using namespace configcat;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+enum Mode { kAutoPoll, kLazyLoad, kManualPoll };
+
+// The flag evaluated by the benchmarks, its value is "value-1" (or the value of a targeting rule), never empty.
+constexpr char kColdStartFlag[] = "flag-1";
+constexpr auto kTimeout = seconds(10);
+
+const char* modeName(int64_t mode) {
+    switch (mode) {
+        case kAutoPoll: return "auto";
+        case kLazyLoad: return "lazy";
+        default: return "manual";
+    }
+}
+
+string coldStartConfigJson(size_t flagCount) {
+    ConfigGeneratorOptions options;
+    options.flagCount = flagCount;
+    options.segmentCount = 5;
+    options.percentageOptionCount = 2;
+    return generateConfigJson(options);
+}
+
+ConfigCatOptions coldStartOptions(int64_t mode, const LocalCdn& cdn) {
+    ConfigCatOptions options;
+    switch (mode) {
+        case kAutoPoll: options.pollingMode = PollingMode::autoPoll(60); break;
+        case kLazyLoad: options.pollingMode = PollingMode::lazyLoad(60); break;
+        default: options.pollingMode = PollingMode::manualPoll(); break;
+    }
+    options.baseUrl = cdn.getBaseUrl();
+    return options;
+}
+
+// Measures the time from `ConfigCatClient::get` until the first evaluation which returns the value from the config.
+// With manual polling that includes the `forceRefresh` call, unless the client can start from the cache.
+bool timeToFirstEvaluation(benchmark::State& state, const ConfigCatOptions& options, bool refresh) {
+    const auto user = ConfigCatUser::create("cold-start-user");
+    const auto start = steady_clock::now();
+
+    auto client = ConfigCatClient::get(kBenchSdkKey, &options);
+    if (refresh) {
+        // A failed refresh is retried right away.
+        while (!client->forceRefresh().success() && steady_clock::now() - start < kTimeout) {
+        }
+    }
+    while (client->getValue(kColdStartFlag, "", user).empty()) {
+        if (steady_clock::now() - start > kTimeout) {
+            ConfigCatClient::close(client);
+            state.SkipWithError("the config was not loaded in time");
+            return false;
+        }
+    }
+
+    state.SetIterationTime(duration<double>(steady_clock::now() - start).count());
+    ConfigCatClient::close(client);
+    return true;
+}
+
+void BM_ColdStart(benchmark::State& state) {
+    const auto mode = state.range(0);
+    const bool warmCache = state.range(1) != 0;
+
+    LocalCdn::Options cdnOptions;
+    cdnOptions.latency = milliseconds(state.range(2));
+    LocalCdn cdn(cdnOptions);
+    cdn.setConfigJson(kBenchSdkKey, coldStartConfigJson(100));
+
+    auto options = coldStartOptions(mode, cdn);
+    if (warmCache) {
+        // The cache is filled by a previous instance (e.g. another process of the service sharing an external cache).
+        options.configCache = make_shared<BenchConfigCache>();
+        auto primingOptions = coldStartOptions(kManualPoll, cdn);
+        primingOptions.configCache = options.configCache;
+        auto primingClient = ConfigCatClient::get(kBenchSdkKey, &primingOptions);
+        primingClient->forceRefresh();
+        ConfigCatClient::close(primingClient);
+    }
+
+    const auto requestsBefore = cdn.getRequestCount();
+    for (auto _ : state) {
+        if (!timeToFirstEvaluation(state, options, mode == kManualPoll && !warmCache)) {
+            break;
+        }
+    }
+
+    state.counters["requests"] = benchmark::Counter(static_cast<double>(cdn.getRequestCount() - requestsBefore),
+                                                    benchmark::Counter::kAvgIterations);
+    state.SetLabel(string(modeName(mode)) + (warmCache ? "/warm-cache" : "/cold-cache"));
+}
+BENCHMARK(BM_ColdStart)
+    ->ArgNames({"mode", "cache", "latency_ms"})
+    ->ArgsProduct({{kAutoPoll, kLazyLoad, kManualPoll}, {0, 1}, {0, 20}})
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+// A large config over a slow link, where parsing the config while it's being downloaded pays off.
+void BM_ColdStartLargeConfig(benchmark::State& state) {
+    const bool streamingParse = state.range(0) != 0;
+
+    LocalCdn::Options cdnOptions;
+    cdnOptions.latency = milliseconds(20);
+    cdnOptions.bandwidthBytesPerSecond = 4 * 1024 * 1024;
+    LocalCdn cdn(cdnOptions);
+    const auto configJson = coldStartConfigJson(1000);
+    cdn.setConfigJson(kBenchSdkKey, configJson);
+
+    auto options = coldStartOptions(kAutoPoll, cdn);
+    options.streamingParse = streamingParse;
+    for (auto _ : state) {
+        if (!timeToFirstEvaluation(state, options, false)) {
+            break;
+        }
+    }
+
+    state.counters["config_kb"] = benchmark::Counter(static_cast<double>(configJson.size()) / 1024);
+    state.SetLabel(streamingParse ? "streaming" : "buffered");
+}
+BENCHMARK(BM_ColdStartLargeConfig)->ArgName("streaming")->Arg(0)->Arg(1)->UseManualTime()->Unit(benchmark::kMillisecond);
+
+// The first request hits a failing CDN, the application retries the refresh right away.
+void BM_ColdStartAfterFailedFetch(benchmark::State& state) {
+    LocalCdn cdn;
+    cdn.setConfigJson(kBenchSdkKey, coldStartConfigJson(100));
+
+    const auto options = coldStartOptions(kManualPoll, cdn);
+    for (auto _ : state) {
+        cdn.failNextRequests(1, static_cast<int>(state.range(0)));
+        if (!timeToFirstEvaluation(state, options, true)) {
+            break;
+        }
+    }
+}
+BENCHMARK(BM_ColdStartAfterFailedFetch)
+    ->ArgName("status")
+    ->Arg(503)
+    ->Arg(0) // dropped connection
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+#endif // _WIN32
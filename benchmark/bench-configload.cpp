@@ -0,0 +1,139 @@
+#include "bench.h"
+
+#include <map>
+
+#include "allocationcounter.h"
+#include "benchmemory.h"
+#include "configentry.h"
+#include "configgenerator.h"
+
+using namespace configcat;
+using namespace std;
+
+namespace {
+
+// A realistic large config: targeting rules with list comparisons, segments, prerequisite chains and percentage options.
+ConfigGeneratorOptions configLoadOptions(size_t flagCount, uint32_t seed = 1) {
+    ConfigGeneratorOptions options;
+    options.flagCount = flagCount;
+    options.rulesPerFlag = 3;
+    options.conditionsPerRule = 3;
+    options.segmentCount = 10;
+    options.prerequisiteDepth = 3;
+    options.comparisonListSize = 10;
+    options.percentageOptionCount = 4;
+    options.seed = seed;
+    return options;
+}
+
+const string& configLoadJson(size_t flagCount, uint32_t seed = 1) {
+    static map<pair<size_t, uint32_t>, string> cache;
+    auto& json = cache[{flagCount, seed}];
+    if (json.empty()) {
+        json = generateConfigJson(configLoadOptions(flagCount, seed));
+    }
+    return json;
+}
+
+// Reports the allocations per iteration and the memory usage of the process.
+// `retainedRssKb` is the growth of the resident set while the result of one iteration is kept alive.
+void setMemoryCounters(benchmark::State& state, const AllocationCounter& allocations, int64_t retainedRssKb) {
+    const auto iterations = static_cast<double>(state.iterations());
+    state.counters["allocs"] = benchmark::Counter(static_cast<double>(allocations.count()) / iterations);
+    state.counters["peak_rss_kb"] = benchmark::Counter(static_cast<double>(peakRssKb()));
+    state.counters["retained_rss_kb"] = benchmark::Counter(static_cast<double>(retainedRssKb));
+}
+
+void BM_ConfigFromJson(benchmark::State& state) {
+    const auto& json = configLoadJson(static_cast<size_t>(state.range(0)));
+    const bool lazySettingDecoding = state.range(1) != 0;
+    const bool configArena = state.range(2) != 0;
+
+    const auto rssBefore = static_cast<int64_t>(currentRssKb());
+    auto retained = Config::fromJson(json, false, lazySettingDecoding, configArena);
+    const auto retainedRssKb = static_cast<int64_t>(currentRssKb()) - rssBefore;
+
+    const AllocationCounter allocations;
+    for (auto _ : state) {
+        auto config = Config::fromJson(json, false, lazySettingDecoding, configArena);
+        benchmark::DoNotOptimize(config);
+    }
+
+    setMemoryCounters(state, allocations, retainedRssKb);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * json.size()));
+    state.SetLabel(string(lazySettingDecoding ? "lazy" : "eager") + (configArena ? ", arena" : ""));
+}
+BENCHMARK(BM_ConfigFromJson)
+    ->ArgNames({"flags", "lazy", "arena"})
+    ->ArgsProduct({{100, 1000, 10000}, {0, 1}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+// Parsing the config cache entry (the serialized form the SDK writes to the ConfigCache).
+void BM_ConfigEntryFromString(benchmark::State& state) {
+    const auto& json = configLoadJson(static_cast<size_t>(state.range(0)));
+    const ConfigEntry entry(Config::fromJson(json), "\"etag\"", json, 1700000000000.0);
+    const auto text = entry.serialize();
+
+    const auto rssBefore = static_cast<int64_t>(currentRssKb());
+    auto retained = ConfigEntry::fromString(text);
+    const auto retainedRssKb = static_cast<int64_t>(currentRssKb()) - rssBefore;
+
+    const AllocationCounter allocations;
+    for (auto _ : state) {
+        auto parsed = ConfigEntry::fromString(text);
+        benchmark::DoNotOptimize(parsed);
+    }
+
+    setMemoryCounters(state, allocations, retainedRssKb);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+BENCHMARK(BM_ConfigEntryFromString)->ArgName("flags")->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+void BM_ConfigEntrySerialize(benchmark::State& state) {
+    const auto& json = configLoadJson(static_cast<size_t>(state.range(0)));
+    const ConfigEntry entry(Config::fromJson(json), "\"etag\"", json, 1700000000000.0);
+
+    const AllocationCounter allocations;
+    for (auto _ : state) {
+        auto text = entry.serialize();
+        benchmark::DoNotOptimize(text);
+    }
+
+    setMemoryCounters(state, allocations, 0);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * json.size()));
+}
+BENCHMARK(BM_ConfigEntrySerialize)->ArgName("flags")->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+// A new config version arriving to a client: download (in-process), parse, cache write and publication of the snapshot.
+// The served config alternates between two versions, so every refresh publishes a new snapshot.
+void BM_SnapshotPublication(benchmark::State& state) {
+    const auto flagCount = static_cast<size_t>(state.range(0));
+    const string* versions[] = {&configLoadJson(flagCount, 1), &configLoadJson(flagCount, 2)};
+
+    auto adapter = make_shared<BenchHttpSessionAdapter>(*versions[0]);
+    auto options = benchOptions();
+    options.httpSessionAdapter = adapter;
+    options.configCache = make_shared<BenchConfigCache>();
+    auto client = createBenchClient(*versions[0], options);
+
+    size_t version = 0;
+    const AllocationCounter allocations;
+    for (auto _ : state) {
+        version ^= 1;
+        // Swapping the served JSON is a string copy, negligible compared to the parse.
+        adapter->setConfigJson(*versions[version]);
+        auto result = client->forceRefresh();
+        if (!result.success()) {
+            state.SkipWithError("refresh failed");
+            break;
+        }
+    }
+
+    // The fetch runs on the calling thread with manual polling, so the thread's counter covers the whole publication.
+    setMemoryCounters(state, allocations, 0);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * versions[0]->size()));
+    ConfigCatClient::close(client);
+}
+BENCHMARK(BM_SnapshotPublication)->ArgName("flags")->Arg(100)->Arg(1000)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+} // namespace
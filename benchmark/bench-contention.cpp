@@ -0,0 +1,163 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "configcat/mapoverridedatasource.h"
+#include "utils.h"
+
+using namespace configcat;
+using namespace std;
+
+namespace {
+
+enum Mode { kAutoPoll, kLazyLoad, kManualPoll };
+enum Variant { kPlain, kWithHooks, kWithOverrides, kWithCache };
+
+constexpr int kSettingCount = 20;
+
+string contentionConfigJson() {
+    string settings;
+    for (int i = 0; i < kSettingCount; ++i) {
+        settings += string_format(
+            R"(%s"flag%d":{"t":0,"v":{"b":false},"r":[{"c":[{"u":{"a":"Email","c":2,"l":["@example.com"]}}],"s":{"v":{"b":true}}}],"i":"id%d"})",
+            i > 0 ? "," : "", i, i);
+    }
+    return R"({"p":{"u":"https://cdn-global.configcat.com","r":0,"s":"salt"},"f":{)" + settings + "}}";
+}
+
+const char* modeName(int64_t mode) {
+    switch (mode) {
+        case kAutoPoll: return "auto";
+        case kLazyLoad: return "lazy";
+        default: return "manual";
+    }
+}
+
+const char* variantName(int64_t variant) {
+    switch (variant) {
+        case kWithHooks: return "hooks";
+        case kWithOverrides: return "overrides";
+        case kWithCache: return "cache";
+        default: return "plain";
+    }
+}
+
+// The client shared by the threads of the current benchmark run (see `createSharedClient`).
+shared_ptr<ConfigCatClient> sharedClient;
+const auto sharedUser = make_shared<ConfigCatUser>("id", "jane@example.com");
+
+// Args: polling mode, variant
+void createSharedClient(const benchmark::State& state) {
+    auto options = benchOptions();
+    // Short intervals, so the readers compete with the refreshes too.
+    switch (state.range(0)) {
+        case kAutoPoll: options.pollingMode = PollingMode::autoPoll(1); break;
+        case kLazyLoad: options.pollingMode = PollingMode::lazyLoad(1); break;
+        default: options.pollingMode = PollingMode::manualPoll(); break;
+    }
+    switch (state.range(1)) {
+        case kWithHooks:
+            options.hooks = make_shared<Hooks>(nullptr, nullptr, [](const EvaluationDetailsBase& details) {
+                benchmark::DoNotOptimize(details.key);
+            });
+            break;
+        case kWithOverrides:
+            options.flagOverrides = make_shared<MapFlagOverrides>(unordered_map<string, Value>{ { "flag0", true } }, LocalOverRemote);
+            break;
+        case kWithCache:
+            options.configCache = make_shared<BenchConfigCache>();
+            break;
+    }
+    sharedClient = createBenchClient(contentionConfigJson(), options);
+}
+
+void closeSharedClient(const benchmark::State& state) {
+    ConfigCatClient::close(sharedClient);
+    sharedClient.reset();
+}
+
+// Collects the per-call latencies of all the threads of a run, and reports their percentiles.
+class LatencyRecorder {
+public:
+    void record(benchmark::State& state, vector<int64_t>&& threadSamples) {
+        lock_guard<mutex> lock(recorderMutex);
+        samples.insert(samples.end(), threadSamples.begin(), threadSamples.end());
+
+        // The last thread reports for the whole run, the counters of the threads are summed up.
+        if (++finishedThreads < state.threads()) {
+            return;
+        }
+        if (!samples.empty()) {
+            sort(samples.begin(), samples.end());
+            const auto percentile = [&](double p) {
+                return static_cast<double>(samples[min(samples.size() - 1, static_cast<size_t>(samples.size() * p))]);
+            };
+            state.counters["p50_ns"] = percentile(0.5);
+            state.counters["p99_ns"] = percentile(0.99);
+            state.counters["p999_ns"] = percentile(0.999);
+        }
+        samples.clear();
+        finishedThreads = 0;
+    }
+
+private:
+    mutex recorderMutex;
+    vector<int64_t> samples;
+    int finishedThreads = 0;
+};
+
+LatencyRecorder latencyRecorder;
+
+template <typename Operation>
+void runContended(benchmark::State& state, const Operation& operation) {
+    if (state.thread_index() == 0) {
+        state.SetLabel(string(modeName(state.range(0))) + "/" + variantName(state.range(1)));
+    }
+
+    // The clock reads add a few tens of nanoseconds to each sample.
+    vector<int64_t> samples;
+    samples.reserve(1 << 16);
+    for (auto _ : state) {
+        const auto start = chrono::steady_clock::now();
+        operation();
+        samples.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    latencyRecorder.record(state, std::move(samples));
+}
+
+void contentionArgs(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({ "mode", "variant" });
+    for (int mode : { kAutoPoll, kLazyLoad, kManualPoll }) {
+        for (int variant : { kPlain, kWithHooks, kWithOverrides, kWithCache }) {
+            benchmark->Args({ mode, variant });
+        }
+    }
+    benchmark->ThreadRange(1, 16)->UseRealTime()->Setup(createSharedClient)->Teardown(closeSharedClient);
+}
+
+} // namespace
+
+static void BM_ContendedGetValue(benchmark::State& state) {
+    runContended(state, [] {
+        benchmark::DoNotOptimize(sharedClient->getValue("flag7", false, sharedUser));
+    });
+}
+BENCHMARK(BM_ContendedGetValue)->Apply(contentionArgs);
+
+static void BM_ContendedGetValueDetails(benchmark::State& state) {
+    runContended(state, [] {
+        benchmark::DoNotOptimize(sharedClient->getValueDetails("flag7", false, sharedUser));
+    });
+}
+BENCHMARK(BM_ContendedGetValueDetails)->Apply(contentionArgs);
+
+static void BM_ContendedGetAllValues(benchmark::State& state) {
+    runContended(state, [] {
+        benchmark::DoNotOptimize(sharedClient->getAllValues(sharedUser));
+    });
+}
+BENCHMARK(BM_ContendedGetAllValues)->Apply(contentionArgs);
@@ -0,0 +1,371 @@
+#include "bench.h"
+
+#include <optional>
+#include <vector>
+
+#include "configcat/consolelogger.h"
+#include "configcatlogger.h"
+#include "evaluatelogbuilder.h"
+#include "rolloutevaluator.h"
+#include "utils.h"
+
+using namespace configcat;
+using namespace std;
+
+namespace {
+
+constexpr char kSalt[] = "benchSalt";
+constexpr char kKey[] = "benchKey";
+constexpr char kAttribute[] = "Custom1";
+
+string hashed(const string& text) {
+    return sha256(text + kSalt + kKey);
+}
+
+string jsonStringList(const vector<string>& values) {
+    string json = "[";
+    for (size_t i = 0; i < values.size(); ++i) {
+        json += (i > 0 ? ",\"" : "\"") + values[i] + "\"";
+    }
+    return json + "]";
+}
+
+string configJson(const string& settingsJson, const string& segmentsJson = "[]") {
+    return string_format(R"({"p":{"u":"https://cdn-global.configcat.com","r":0,"s":"%s"},"s":%s,"f":{%s}})",
+                         kSalt, segmentsJson.c_str(), settingsJson.c_str());
+}
+
+// A string setting with a single targeting rule.
+string ruleSettingJson(const string& key, const string& conditionsJson) {
+    return string_format(R"("%s":{"t":1,"v":{"s":"default"},"r":[{"c":%s,"s":{"v":{"s":"match"}}}]})",
+                         key.c_str(), conditionsJson.c_str());
+}
+
+// The user condition with the comparator, and a user attribute value that satisfies it (in the worst case, when the
+// comparator iterates over a list, the attribute matches the last item).
+pair<string, ConfigCatUser::AttributeValue> userCondition(UserComparator comparator, size_t listSize, size_t length) {
+    vector<string> texts;
+    for (size_t i = 0; i < listSize; ++i) {
+        texts.push_back(makeBenchText(length, i));
+    }
+    const string& lastText = texts.back();
+    const auto sliceLength = max<size_t>(lastText.size() / 2, 1);
+
+    string comparisonValue;
+    ConfigCatUser::AttributeValue attributeValue = lastText;
+    switch (comparator) {
+        case UserComparator::TextIsOneOf:
+        case UserComparator::TextIsNotOneOf:
+        case UserComparator::TextContainsAnyOf:
+        case UserComparator::TextNotContainsAnyOf:
+        case UserComparator::TextStartsWithAnyOf:
+        case UserComparator::TextNotStartsWithAnyOf:
+        case UserComparator::TextEndsWithAnyOf:
+        case UserComparator::TextNotEndsWithAnyOf:
+            comparisonValue = "\"l\":" + jsonStringList(texts);
+            break;
+        case UserComparator::TextEquals:
+        case UserComparator::TextNotEquals:
+            comparisonValue = "\"s\":\"" + lastText + "\"";
+            break;
+        case UserComparator::SemVerIsOneOf:
+        case UserComparator::SemVerIsNotOneOf: {
+            vector<string> versions;
+            for (size_t i = 0; i < listSize; ++i) {
+                versions.push_back("1.0." + to_string(i));
+            }
+            comparisonValue = "\"l\":" + jsonStringList(versions);
+            attributeValue = versions.back();
+            break;
+        }
+        case UserComparator::SemVerLess:
+        case UserComparator::SemVerLessOrEquals:
+        case UserComparator::SemVerGreater:
+        case UserComparator::SemVerGreaterOrEquals:
+            comparisonValue = R"("s":"1.2.3")";
+            attributeValue = string("1.2.3-beta.1+build.5");
+            break;
+        case UserComparator::NumberEquals:
+        case UserComparator::NumberNotEquals:
+        case UserComparator::NumberLess:
+        case UserComparator::NumberLessOrEquals:
+        case UserComparator::NumberGreater:
+        case UserComparator::NumberGreaterOrEquals:
+            comparisonValue = R"("d":42.5)";
+            attributeValue = string("42.5");
+            break;
+        case UserComparator::DateTimeBefore:
+        case UserComparator::DateTimeAfter:
+            comparisonValue = R"("d":1700000000)";
+            attributeValue = 1700000000.5;
+            break;
+        case UserComparator::SensitiveTextIsOneOf:
+        case UserComparator::SensitiveTextIsNotOneOf:
+        case UserComparator::SensitiveArrayContainsAnyOf:
+        case UserComparator::SensitiveArrayNotContainsAnyOf: {
+            vector<string> hashes;
+            for (const auto& text : texts) {
+                hashes.push_back(hashed(text));
+            }
+            comparisonValue = "\"l\":" + jsonStringList(hashes);
+            if (comparator == UserComparator::SensitiveArrayContainsAnyOf || comparator == UserComparator::SensitiveArrayNotContainsAnyOf) {
+                attributeValue = vector<string>{ lastText };
+            }
+            break;
+        }
+        case UserComparator::SensitiveTextEquals:
+        case UserComparator::SensitiveTextNotEquals:
+            comparisonValue = "\"s\":\"" + hashed(lastText) + "\"";
+            break;
+        case UserComparator::SensitiveTextStartsWithAnyOf:
+        case UserComparator::SensitiveTextNotStartsWithAnyOf:
+        case UserComparator::SensitiveTextEndsWithAnyOf:
+        case UserComparator::SensitiveTextNotEndsWithAnyOf: {
+            const bool startsWith = comparator == UserComparator::SensitiveTextStartsWithAnyOf
+                || comparator == UserComparator::SensitiveTextNotStartsWithAnyOf;
+            vector<string> slices;
+            for (const auto& text : texts) {
+                const auto length = min(sliceLength, text.size());
+                const auto slice = startsWith ? text.substr(0, length) : text.substr(text.size() - length);
+                slices.push_back(to_string(length) + "_" + hashed(slice));
+            }
+            comparisonValue = "\"l\":" + jsonStringList(slices);
+            break;
+        }
+        case UserComparator::ArrayContainsAnyOf:
+        case UserComparator::ArrayNotContainsAnyOf:
+            comparisonValue = "\"l\":" + jsonStringList(texts);
+            attributeValue = vector<string>{ lastText };
+            break;
+    }
+
+    return {
+        string_format(R"([{"u":{"a":"%s","c":%d,%s}}])", kAttribute, static_cast<int>(comparator), comparisonValue.c_str()),
+        attributeValue
+    };
+}
+
+bool isListComparator(UserComparator comparator) {
+    switch (comparator) {
+        case UserComparator::TextEquals:
+        case UserComparator::TextNotEquals:
+        case UserComparator::SemVerLess:
+        case UserComparator::SemVerLessOrEquals:
+        case UserComparator::SemVerGreater:
+        case UserComparator::SemVerGreaterOrEquals:
+        case UserComparator::NumberEquals:
+        case UserComparator::NumberNotEquals:
+        case UserComparator::NumberLess:
+        case UserComparator::NumberLessOrEquals:
+        case UserComparator::NumberGreater:
+        case UserComparator::NumberGreaterOrEquals:
+        case UserComparator::DateTimeBefore:
+        case UserComparator::DateTimeAfter:
+        case UserComparator::SensitiveTextEquals:
+        case UserComparator::SensitiveTextNotEquals:
+            return false;
+        default:
+            return true;
+    }
+}
+
+bool hasTextAttribute(UserComparator comparator) {
+    switch (comparator) {
+        case UserComparator::SemVerIsOneOf:
+        case UserComparator::SemVerIsNotOneOf:
+        case UserComparator::SemVerLess:
+        case UserComparator::SemVerLessOrEquals:
+        case UserComparator::SemVerGreater:
+        case UserComparator::SemVerGreaterOrEquals:
+        case UserComparator::NumberEquals:
+        case UserComparator::NumberNotEquals:
+        case UserComparator::NumberLess:
+        case UserComparator::NumberLessOrEquals:
+        case UserComparator::NumberGreater:
+        case UserComparator::NumberGreaterOrEquals:
+        case UserComparator::DateTimeBefore:
+        case UserComparator::DateTimeAfter:
+            return false;
+        default:
+            return true;
+    }
+}
+
+// Evaluates the settings of a config with the rollout evaluator directly, without the client around it.
+class EvaluatorBench {
+public:
+    explicit EvaluatorBench(const string& json)
+        : config(Config::fromJson(json))
+        , settings(config->getSettingsOrEmpty())
+        , logger(make_shared<ConfigCatLogger>(make_shared<ConsoleLogger>(LOG_LEVEL_WARNING), make_shared<Hooks>()))
+        , evaluator(logger) {
+    }
+
+    // Returns the evaluated value, or nullopt when the evaluation failed.
+    optional<Value> evaluate(const string& key, const shared_ptr<ConfigCatUser>& user) {
+        const auto it = settings->find(key);
+        if (it == settings->end()) {
+            return nullopt;
+        }
+        EvaluateContext context(key, it->second, user, settings);
+        optional<Value> returnValue;
+        try {
+            evaluator.evaluate(nullopt, context, returnValue);
+        } catch (...) {
+            return nullopt;
+        }
+        return returnValue;
+    }
+
+    void run(benchmark::State& state, const string& key, const shared_ptr<ConfigCatUser>& user) {
+        if (!evaluate(key, user)) {
+            state.SkipWithError("The evaluation failed.");
+            return;
+        }
+
+        const auto& setting = settings->at(key);
+        for (auto _ : state) {
+            EvaluateContext context(key, setting, user, settings);
+            optional<Value> returnValue;
+            auto result = evaluator.evaluate(nullopt, context, returnValue);
+            benchmark::DoNotOptimize(result);
+            benchmark::DoNotOptimize(returnValue);
+        }
+    }
+
+private:
+    shared_ptr<Config> config;
+    shared_ptr<Settings> settings;
+    shared_ptr<ConfigCatLogger> logger;
+    RolloutEvaluator evaluator;
+};
+
+} // namespace
+
+// Args: comparator, comparison list size, attribute length
+static void BM_UserCondition(benchmark::State& state) {
+    const auto comparator = static_cast<UserComparator>(state.range(0));
+    const auto [conditionsJson, attributeValue] = userCondition(comparator, state.range(1), state.range(2));
+
+    EvaluatorBench bench(configJson(ruleSettingJson(kKey, conditionsJson)));
+    auto user = make_shared<ConfigCatUser>("id", nullopt, nullopt, unordered_map<string, ConfigCatUser::AttributeValue>{ { kAttribute, attributeValue } });
+
+    // Whether the condition matches affects the cost (e.g. an early exit), so it's reported along the comparator.
+    const auto value = bench.evaluate(kKey, user);
+    const bool matched = value && get<string>(*value) == "match";
+    state.SetLabel(string(getUserComparatorText(comparator)) + (matched ? " (match)" : " (no match)"));
+
+    bench.run(state, kKey, user);
+}
+BENCHMARK(BM_UserCondition)->Apply([](benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({ "comparator", "list", "length" });
+    for (int comparator = 0; comparator <= static_cast<int>(UserComparator::ArrayNotContainsAnyOf); ++comparator) {
+        const auto userComparator = static_cast<UserComparator>(comparator);
+        for (int listSize : { 1, 16, 256 }) {
+            if (listSize > 1 && !isListComparator(userComparator)) {
+                break;
+            }
+            for (int length : { 8, 64, 512 }) {
+                if (length > 8 && !hasTextAttribute(userComparator)) {
+                    break;
+                }
+                benchmark->Args({ comparator, listSize, length });
+            }
+        }
+    }
+});
+
+// Args: number of percentage options, identifier length
+static void BM_PercentageOptions(benchmark::State& state) {
+    const auto optionCount = state.range(0);
+    string options;
+    for (int64_t i = 0; i < optionCount; ++i) {
+        const auto percentage = 100 / optionCount + (i == 0 ? 100 % optionCount : 0);
+        options += string_format(R"(%s{"p":%d,"v":{"s":"option%d"}})", i > 0 ? "," : "", static_cast<int>(percentage), static_cast<int>(i));
+    }
+    const auto settingJson = string_format(R"("%s":{"t":1,"v":{"s":"default"},"p":[%s]})", kKey, options.c_str());
+
+    EvaluatorBench bench(configJson(settingJson));
+    bench.run(state, kKey, make_shared<ConfigCatUser>(makeBenchText(state.range(1), 0)));
+}
+BENCHMARK(BM_PercentageOptions)->ArgNames({ "options", "length" })->ArgsProduct({ { 2, 10, 100 }, { 8, 512 } });
+
+// Args: number of conditions in the segment
+static void BM_Segment(benchmark::State& state) {
+    string conditions;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        // All the conditions (which are in AND relation) have to be checked to match.
+        conditions += string_format(R"(%s{"a":"Email","c":2,"l":["@example.com"]})", i > 0 ? "," : "");
+    }
+    const auto segmentsJson = string_format(R"([{"n":"Beta users","r":[%s]}])", conditions.c_str());
+
+    EvaluatorBench bench(configJson(ruleSettingJson(kKey, R"([{"s":{"s":0,"c":0}}])"), segmentsJson));
+    bench.run(state, kKey, make_shared<ConfigCatUser>("id", "jane@example.com"));
+}
+BENCHMARK(BM_Segment)->ArgName("conditions")->Arg(1)->Arg(4)->Arg(16);
+
+// Args: depth of the prerequisite flag chain
+static void BM_PrerequisiteChain(benchmark::State& state) {
+    const auto depth = state.range(0);
+    string settings = R"("flag0":{"t":1,"v":{"s":"match"}})";
+    for (int64_t i = 1; i <= depth; ++i) {
+        const auto condition = string_format(R"([{"p":{"f":"flag%d","c":0,"v":{"s":"match"}}}])", static_cast<int>(i - 1));
+        settings += "," + ruleSettingJson("flag" + to_string(i), condition);
+    }
+
+    EvaluatorBench bench(configJson(settings));
+    bench.run(state, "flag" + to_string(depth), make_shared<ConfigCatUser>("id"));
+}
+BENCHMARK(BM_PrerequisiteChain)->ArgName("depth")->Arg(1)->Arg(4)->Arg(16);
+
+namespace {
+
+const string& endToEndConfigJson() {
+    static const string json = configJson(
+        R"("simple":{"t":0,"v":{"b":true}},)"
+        + ruleSettingJson("targeted", R"([{"u":{"a":"Email","c":0,"l":["a@example.com","b@example.com","jane@example.com"]}}])")
+        + R"(,"percentage":{"t":1,"v":{"s":"default"},"p":[{"p":50,"v":{"s":"A"}},{"p":50,"v":{"s":"B"}}]})");
+    return json;
+}
+
+} // namespace
+
+// `ConfigCatClient::getValue` end to end: config snapshot lookup, evaluation, evaluation details and hooks.
+static void BM_GetValueSimple(benchmark::State& state) {
+    auto client = createBenchClient(endToEndConfigJson());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(client->getValue("simple", false));
+    }
+    ConfigCatClient::close(client);
+}
+BENCHMARK(BM_GetValueSimple);
+
+static void BM_GetValueTargeted(benchmark::State& state) {
+    auto client = createBenchClient(endToEndConfigJson());
+    auto user = make_shared<ConfigCatUser>("id", "jane@example.com");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(client->getValue("targeted", "", user));
+    }
+    ConfigCatClient::close(client);
+}
+BENCHMARK(BM_GetValueTargeted);
+
+static void BM_GetValuePercentage(benchmark::State& state) {
+    auto client = createBenchClient(endToEndConfigJson());
+    auto user = make_shared<ConfigCatUser>("id");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(client->getValue("percentage", "", user));
+    }
+    ConfigCatClient::close(client);
+}
+BENCHMARK(BM_GetValuePercentage);
+
+static void BM_GetValueDetails(benchmark::State& state) {
+    auto client = createBenchClient(endToEndConfigJson());
+    auto user = make_shared<ConfigCatUser>("id", "jane@example.com");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(client->getValueDetails("targeted", "", user));
+    }
+    ConfigCatClient::close(client);
+}
+BENCHMARK(BM_GetValueDetails);
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <benchmark/benchmark.h>
+
+#include "configcat/configcache.h"
+#include "configcat/configcatclient.h"
+#include "configcat/configcatoptions.h"
+#include "configcat/httpsessionadapter.h"
+
+namespace configcat {
+
+// SDK key of the benchmark clients, it passes the format validation of the client.
+constexpr char kBenchSdkKey[] = "BenchSdkKey-3456789012/1234567890123456789012";
+
+// In-process stand-in of the ConfigCat CDN, serves the given config JSON (and 304 when the ETag matches).
+class BenchHttpSessionAdapter : public HttpSessionAdapter {
+public:
+    explicit BenchHttpSessionAdapter(const std::string& configJson = "") : configJson(configJson) {}
+
+    void setConfigJson(const std::string& json) {
+        std::lock_guard<std::mutex> lock(adapterMutex);
+        configJson = json;
+        eTag = "\"" + std::to_string(++version) + "\"";
+    }
+
+    bool init(uint32_t connectTimeoutMs, uint32_t readTimeoutMs) override {
+        return true;
+    }
+
+    Response get(const std::string& url,
+                 const std::map<std::string, std::string>& header,
+                 const std::map<std::string, std::string>& proxies,
+                 const std::map<std::string, ProxyAuthentication>& proxyAuthentications) override {
+        std::lock_guard<std::mutex> lock(adapterMutex);
+        Response response;
+        const auto it = header.find("If-None-Match");
+        if (it != header.end() && it->second == eTag) {
+            response.statusCode = 304;
+        } else {
+            response.statusCode = 200;
+            response.text = configJson;
+        }
+        response.header["ETag"] = eTag;
+        return response;
+    }
+
+    void close() override {}
+
+private:
+    std::mutex adapterMutex;
+    std::string configJson;
+    std::string eTag = "\"0\"";
+    int version = 0;
+};
+
+// In-memory cache, shared by the clients it's passed to (like an external cache shared by the instances of a service).
+class BenchConfigCache : public ConfigCache {
+public:
+    const std::string& read(const std::string& key) override {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        return entries[key];
+    }
+
+    void write(const std::string& key, const std::string& value) override {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        entries[key] = value;
+    }
+
+private:
+    std::mutex cacheMutex;
+    std::map<std::string, std::string> entries;
+};
+
+// Manual polling, so there's no background activity during the measurements.
+inline ConfigCatOptions benchOptions() {
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    return options;
+}
+
+// Creates a client which has the given config JSON loaded already. The caller should close it with `ConfigCatClient::close`.
+inline std::shared_ptr<ConfigCatClient> createBenchClient(const std::string& configJson,
+                                                          ConfigCatOptions options = benchOptions()) {
+    if (!options.httpSessionAdapter) {
+        options.httpSessionAdapter = std::make_shared<BenchHttpSessionAdapter>(configJson);
+    }
+    auto client = ConfigCatClient::get(kBenchSdkKey, &options);
+    client->forceRefresh();
+    return client;
+}
+
+// Deterministic text of (at least) the given length, distinct for each index.
+inline std::string makeBenchText(size_t length, size_t index) {
+    std::string text = std::to_string(index) + "-";
+    while (text.size() < length) {
+        text += static_cast<char>('a' + (text.size() * 7 + index) % 26);
+    }
+    return text;
+}
+
+} // namespace configcat
@@ -0,0 +1,41 @@
+#include "benchmemory.h"
+
+#include <cstdio>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace configcat {
+
+uint64_t peakRssKb() {
+#if defined(__linux__)
+    rusage usage{};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? static_cast<uint64_t>(usage.ru_maxrss) : 0;
+#elif defined(__APPLE__)
+    rusage usage{};
+    // ru_maxrss is in bytes on macOS.
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? static_cast<uint64_t>(usage.ru_maxrss) / 1024 : 0;
+#else
+    return 0;
+#endif
+}
+
+uint64_t currentRssKb() {
+#if defined(__linux__)
+    FILE* file = std::fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    unsigned long long size = 0;
+    unsigned long long resident = 0;
+    const bool read = std::fscanf(file, "%llu %llu", &size, &resident) == 2;
+    std::fclose(file);
+    return read ? resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) / 1024 : 0;
+#else
+    return 0;
+#endif
+}
+
+} // namespace configcat
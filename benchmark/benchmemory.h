@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+namespace configcat {
+
+// The peak and the current resident set size of the process in KiB (0 where it's not available).
+uint64_t peakRssKb();
+uint64_t currentRssKb();
+
+} // namespace configcat
@@ -0,0 +1,173 @@
+#include "configgenerator.h"
+
+#include <random>
+
+#include "configcat/config.h"
+#include "utils.h"
+
+using namespace std;
+
+namespace configcat {
+
+namespace {
+
+constexpr char kSalt[] = "generatedSalt";
+
+// The user comparators used by the generated conditions, with a comparison value of the matching kind.
+constexpr UserComparator kComparators[] = {
+    UserComparator::TextIsOneOf,
+    UserComparator::TextContainsAnyOf,
+    UserComparator::TextStartsWithAnyOf,
+    UserComparator::SemVerIsOneOf,
+    UserComparator::SemVerLess,
+    UserComparator::NumberGreater,
+    UserComparator::SensitiveTextIsOneOf,
+    UserComparator::DateTimeBefore,
+    UserComparator::ArrayContainsAnyOf,
+};
+
+const char* settingValueJson(SettingType type, size_t index) {
+    static thread_local string json;
+    switch (type) {
+        case SettingType::Boolean: json = index % 2 ? R"({"b":true})" : R"({"b":false})"; break;
+        case SettingType::String: json = string_format(R"({"s":"value-%zu"})", index); break;
+        case SettingType::Int: json = string_format(R"({"i":%zu})", index); break;
+        default: json = string_format(R"({"d":%zu.5})", index); break;
+    }
+    return json.c_str();
+}
+
+class Generator {
+public:
+    explicit Generator(const ConfigGeneratorOptions& options) : options(options), random(options.seed) {}
+
+    string generate() {
+        string json = string_format(R"({"p":{"u":"https://cdn-global.configcat.com","r":0,"s":"%s"},"s":[)", kSalt);
+        for (size_t i = 0; i < options.segmentCount; ++i) {
+            json += string_format(R"(%s{"n":"segment-%zu","r":[%s]})", i > 0 ? "," : "", i, userCondition("segment-" + to_string(i)).c_str());
+        }
+        json += R"(],"f":{)";
+        for (size_t i = 0; i < options.flagCount; ++i) {
+            json += (i > 0 ? "," : "") + flag(i);
+        }
+        return json + "}}";
+    }
+
+private:
+    static string key(size_t index) {
+        return "flag-" + to_string(index);
+    }
+
+    static SettingType type(size_t index) {
+        return static_cast<SettingType>(index % 4);
+    }
+
+    string flag(size_t index) {
+        const auto settingType = type(index);
+        string json = string_format(R"("%s":{"t":%d,"v":%s,"i":"v%zu","r":[)", key(index).c_str(),
+                                    static_cast<int>(settingType), settingValueJson(settingType, index), index);
+        for (size_t rule = 0; rule < options.rulesPerFlag; ++rule) {
+            json += (rule > 0 ? "," : "") + targetingRule(index, rule);
+        }
+        json += "]";
+
+        if (options.percentageOptionCount > 0) {
+            json += R"(,"p":[)";
+            const auto count = options.percentageOptionCount;
+            for (size_t option = 0; option < count; ++option) {
+                const auto percentage = 100 / count + (option == 0 ? 100 % count : 0);
+                json += string_format(R"(%s{"p":%zu,"v":%s,"i":"p%zu-%zu"})", option > 0 ? "," : "",
+                                      percentage, settingValueJson(settingType, option), index, option);
+            }
+            json += "]";
+        }
+        return json + "}";
+    }
+
+    string targetingRule(size_t index, size_t rule) {
+        string conditions;
+        for (size_t condition = 0; condition < options.conditionsPerRule; ++condition) {
+            if (!conditions.empty()) {
+                conditions += ",";
+            }
+            // The first condition of the first rule refers to the previous flag of the chain.
+            const bool prerequisite = options.prerequisiteDepth > 0 && rule == 0 && condition == 0
+                && index % (options.prerequisiteDepth + 1) != 0;
+            if (prerequisite) {
+                conditions += string_format(R"({"p":{"f":"%s","c":1,"v":%s}})", key(index - 1).c_str(),
+                                            settingValueJson(type(index - 1), index + 1));
+            } else if (options.segmentCount > 0 && condition % 3 == 2) {
+                // Drawn one by one, as the evaluation order of the arguments is unspecified (the output must be reproducible).
+                const auto segment = randomIndex(options.segmentCount);
+                const auto segmentComparator = static_cast<int>(random() % 2);
+                conditions += string_format(R"({"s":{"s":%zu,"c":%d}})", segment, segmentComparator);
+            } else {
+                conditions += R"({"u":)" + userCondition(key(index)) + "}";
+            }
+        }
+        return string_format(R"({"c":[%s],"s":{"v":%s,"i":"r%zu-%zu"}})", conditions.c_str(),
+                             settingValueJson(type(index), index + rule + 1), index, rule);
+    }
+
+    string userCondition(const string& contextSalt) {
+        const auto comparator = kComparators[randomIndex(size(kComparators))];
+        const char* attribute = comparator == UserComparator::ArrayContainsAnyOf ? "Roles" : "Email";
+        string comparisonValue;
+        switch (comparator) {
+            case UserComparator::SemVerIsOneOf:
+                comparisonValue = "\"l\":" + list([&](size_t i) { return "1." + to_string(i) + "." + to_string(random() % 10); });
+                attribute = "Version";
+                break;
+            case UserComparator::SemVerLess: {
+                const auto major = static_cast<unsigned>(random() % 5);
+                const auto minor = static_cast<unsigned>(random() % 10);
+                comparisonValue = string_format(R"("s":"%u.%u.0")", major, minor);
+                attribute = "Version";
+                break;
+            }
+            case UserComparator::NumberGreater:
+                comparisonValue = string_format(R"("d":%u)", static_cast<unsigned>(random() % 1000));
+                attribute = "Age";
+                break;
+            case UserComparator::DateTimeBefore:
+                comparisonValue = string_format(R"("d":%u)", static_cast<unsigned>(1700000000u + random() % 100000000u));
+                attribute = "RegisteredAt";
+                break;
+            case UserComparator::SensitiveTextIsOneOf:
+                comparisonValue = "\"l\":" + list([&](size_t i) { return sha256(text(i) + kSalt + contextSalt); });
+                break;
+            default:
+                comparisonValue = "\"l\":" + list([&](size_t i) { return text(i); });
+                break;
+        }
+        return string_format(R"({"a":"%s","c":%d,%s})", attribute, static_cast<int>(comparator), comparisonValue.c_str());
+    }
+
+    template <typename Item>
+    string list(const Item& item) {
+        string json = "[";
+        for (size_t i = 0; i < options.comparisonListSize; ++i) {
+            json += (i > 0 ? ",\"" : "\"") + item(i) + "\"";
+        }
+        return json + "]";
+    }
+
+    string text(size_t index) {
+        return "user" + to_string(random() % 100000) + "-" + to_string(index) + "@example.com";
+    }
+
+    size_t randomIndex(size_t count) {
+        return random() % count;
+    }
+
+    const ConfigGeneratorOptions& options;
+    mt19937 random;
+};
+
+} // namespace
+
+string generateConfigJson(const ConfigGeneratorOptions& options) {
+    return Generator(options).generate();
+}
+
+} // namespace configcat
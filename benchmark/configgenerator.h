@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace configcat {
+
+// Shape of the synthetic config generated by `generateConfigJson`.
+struct ConfigGeneratorOptions {
+    // The number of feature flags and settings (the setting types rotate between bool, string, int and double).
+    size_t flagCount = 100;
+
+    // The number of targeting rules per flag, and the number of conditions (in AND relation) per rule.
+    size_t rulesPerFlag = 2;
+    size_t conditionsPerRule = 2;
+
+    // The number of segments. When there are segments, every third condition is a segment condition.
+    size_t segmentCount = 0;
+
+    // The length of the prerequisite flag chains (0 means there are no prerequisite flag conditions).
+    // Each flag depends on the previous one, except for the first flag of each chain.
+    size_t prerequisiteDepth = 0;
+
+    // The number of comparison values of the list comparators (IS ONE OF, CONTAINS ANY OF, etc.).
+    size_t comparisonListSize = 5;
+
+    // The number of percentage options per flag (0 means no percentage options).
+    size_t percentageOptionCount = 0;
+
+    // Seed of the pseudo-random generation, the same options always produce the same config.
+    uint32_t seed = 1;
+};
+
+// Generates a valid config_v6.json with the given shape.
+std::string generateConfigJson(const ConfigGeneratorOptions& options);
+
+} // namespace configcat
@@ -0,0 +1,54 @@
+// Writes a synthetic config_v6.json to the standard output, e.g. to reproduce a benchmark with a given config shape:
+//   configcat_generate_config --flags 10000 --rules 3 --conditions 3 --segments 10 > config.json
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "../configgenerator.h"
+
+using namespace configcat;
+using namespace std;
+
+namespace {
+
+void printUsage() {
+    cerr << "Usage: configcat_generate_config [--flags N] [--rules N] [--conditions N] [--segments N]"
+            " [--prerequisite-depth N] [--list-size N] [--percentage-options N] [--seed N]" << endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    ConfigGeneratorOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            printUsage();
+            return 1;
+        }
+        const char* name = argv[i];
+        const auto value = strtoull(argv[++i], nullptr, 10);
+        if (strcmp(name, "--flags") == 0) {
+            options.flagCount = value;
+        } else if (strcmp(name, "--rules") == 0) {
+            options.rulesPerFlag = value;
+        } else if (strcmp(name, "--conditions") == 0) {
+            options.conditionsPerRule = value;
+        } else if (strcmp(name, "--segments") == 0) {
+            options.segmentCount = value;
+        } else if (strcmp(name, "--prerequisite-depth") == 0) {
+            options.prerequisiteDepth = value;
+        } else if (strcmp(name, "--list-size") == 0) {
+            options.comparisonListSize = value;
+        } else if (strcmp(name, "--percentage-options") == 0) {
+            options.percentageOptionCount = value;
+        } else if (strcmp(name, "--seed") == 0) {
+            options.seed = static_cast<uint32_t>(value);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    cout << generateConfigJson(options) << endl;
+    return 0;
+}
@@ -0,0 +1,389 @@
+# Script mode part of `configcat_embed_config`, generates the source files of an embedded config snapshot.
+#
+# The snapshot is compiled as the code building its config model, so there's no JSON to parse at runtime. The JSON is
+# decoded here (with string(JSON), available from CMake 3.19) the same way as the SDK decodes a downloaded config.json.
+
+if(CMAKE_VERSION VERSION_LESS 3.19)
+    message(FATAL_ERROR "configcat_embed_config requires CMake 3.19 or later.")
+endif()
+
+# Fails the generation with the location of the invalid element.
+function(_configcat_embed_fail PATH MESSAGE)
+    message(FATAL_ERROR "Invalid config JSON ${CONFIGCAT_EMBED_JSON_FILE} at ${PATH}: ${MESSAGE}")
+endfunction()
+
+# Gets the member KEY of the JSON object (or the element KEY of the JSON array) into OUT and its type into OUT_TYPE.
+# OUT_TYPE is empty when the member is missing or null.
+function(_configcat_embed_get OUT OUT_TYPE JSON KEY)
+    string(JSON type ERROR_VARIABLE error TYPE "${JSON}" "${KEY}")
+    if(error OR type STREQUAL "NULL")
+        set(${OUT} "" PARENT_SCOPE)
+        set(${OUT_TYPE} "" PARENT_SCOPE)
+        return()
+    endif()
+    string(JSON value GET "${JSON}" "${KEY}")
+    set(${OUT} "${value}" PARENT_SCOPE)
+    set(${OUT_TYPE} "${type}" PARENT_SCOPE)
+endfunction()
+
+# Like `_configcat_embed_get`, but the member has to be present with the type EXPECTED_TYPE.
+function(_configcat_embed_require OUT JSON KEY EXPECTED_TYPE PATH)
+    _configcat_embed_get(value type "${JSON}" "${KEY}")
+    if(NOT type STREQUAL EXPECTED_TYPE)
+        _configcat_embed_fail("${PATH}" "the member '${KEY}' is missing or is not of type ${EXPECTED_TYPE}")
+    endif()
+    set(${OUT} "${value}" PARENT_SCOPE)
+endfunction()
+
+# A C++ string literal of the string. The strings with characters other than printable ASCII ones are written as
+# escaped bytes, so the result doesn't depend on the source encoding assumed by the compiler.
+function(_configcat_embed_literal OUT VALUE)
+    if(VALUE MATCHES "^[] !#-[^-~]*$")
+        set(${OUT} "\"${VALUE}\"" PARENT_SCOPE)
+    else()
+        string(HEX "${VALUE}" hex)
+        string(REGEX REPLACE "([0-9a-f][0-9a-f])" "\\\\x\\1" escaped "${hex}")
+        set(${OUT} "\"${escaped}\"" PARENT_SCOPE)
+    endif()
+endfunction()
+
+# The members of the generated code are appended to CODE, which is passed back to the caller by each function.
+
+# Assigns the setting value object JSON ({"b": ...}, {"s": ...}, etc.) to TARGET. A value with more than one type is
+# left empty (and is reported by the evaluation), like in the SDK.
+function(_configcat_embed_setting_value TARGET JSON INDENT PATH)
+    set(found 0)
+    foreach(key b s i d)
+        _configcat_embed_get(value type "${JSON}" ${key})
+        if(NOT type STREQUAL "")
+            math(EXPR found "${found} + 1")
+            set(valueKey ${key})
+            set(valueType ${type})
+            set(valueText "${value}")
+        endif()
+    endforeach()
+    if(found EQUAL 0)
+        _configcat_embed_fail("${PATH}" "the setting value is of an unsupported type")
+    elseif(found GREATER 1)
+        return()
+    endif()
+
+    if(valueKey STREQUAL "b" AND valueType STREQUAL "BOOLEAN")
+        if(valueText)
+            set(literal "true")
+        else()
+            set(literal "false")
+        endif()
+    elseif(valueKey STREQUAL "s" AND valueType STREQUAL "STRING")
+        _configcat_embed_literal(literal "${valueText}")
+        set(literal "std::string(${literal})")
+    elseif(valueKey STREQUAL "i" AND valueType STREQUAL "NUMBER" AND valueText MATCHES "^-?[0-9]+$")
+        set(literal "int32_t(${valueText})")
+    elseif(valueKey STREQUAL "d" AND valueType STREQUAL "NUMBER")
+        set(literal "double(${valueText})")
+    else()
+        _configcat_embed_fail("${PATH}" "the setting value '${valueKey}' is of type ${valueType}")
+    endif()
+    string(APPEND CODE "${INDENT}${TARGET} = ${literal};\n")
+    set(CODE "${CODE}" PARENT_SCOPE)
+endfunction()
+
+# The value ("v") and the variation ID ("i") of a served value, a percentage option or a setting.
+function(_configcat_embed_value_container TARGET JSON INDENT PATH)
+    _configcat_embed_get(value type "${JSON}" v)
+    if(type STREQUAL "OBJECT")
+        _configcat_embed_setting_value("${TARGET}.value" "${value}" "${INDENT}" "${PATH}.v")
+    elseif(NOT type STREQUAL "")
+        _configcat_embed_fail("${PATH}" "the member 'v' is not an object")
+    endif()
+    _configcat_embed_get(variationId type "${JSON}" i)
+    if(type STREQUAL "STRING")
+        _configcat_embed_literal(literal "${variationId}")
+        string(APPEND CODE "${INDENT}${TARGET}.variationId = std::string(${literal});\n")
+    elseif(NOT type STREQUAL "")
+        _configcat_embed_fail("${PATH}" "the member 'i' is not a string")
+    endif()
+    set(CODE "${CODE}" PARENT_SCOPE)
+endfunction()
+
+function(_configcat_embed_percentage_options TARGET JSON INDENT PATH)
+    string(JSON count LENGTH "${JSON}")
+    if(count EQUAL 0)
+        return()
+    endif()
+    math(EXPR last "${count} - 1")
+    foreach(index RANGE ${last})
+        string(JSON option GET "${JSON}" ${index})
+        _configcat_embed_require(percentage "${option}" p NUMBER "${PATH}[${index}]")
+        string(APPEND CODE "${INDENT}{\n"
+                           "${INDENT}    auto& option = ${TARGET}.emplace_back();\n"
+                           "${INDENT}    option.percentage = uint8_t(${percentage});\n")
+        _configcat_embed_value_container(option "${option}" "${INDENT}    " "${PATH}[${index}]")
+        string(APPEND CODE "${INDENT}}\n")
+    endforeach()
+    set(CODE "${CODE}" PARENT_SCOPE)
+endfunction()
+
+# A user condition, TARGET is the expression of the condition to be filled.
+function(_configcat_embed_user_condition TARGET JSON INDENT PATH)
+    _configcat_embed_require(attribute "${JSON}" a STRING "${PATH}")
+    _configcat_embed_require(comparator "${JSON}" c NUMBER "${PATH}")
+    _configcat_embed_literal(literal "${attribute}")
+    string(APPEND CODE "${INDENT}auto& condition = ${TARGET};\n"
+                       "${INDENT}condition.comparisonAttribute = ${literal};\n"
+                       "${INDENT}condition.comparator = static_cast<UserComparator>(${comparator});\n")
+
+    set(found 0)
+    _configcat_embed_get(value type "${JSON}" s)
+    if(type STREQUAL "STRING")
+        math(EXPR found "${found} + 1")
+        _configcat_embed_literal(literal "${value}")
+        set(comparisonValue "std::string(${literal})")
+    endif()
+    _configcat_embed_get(value type "${JSON}" d)
+    if(type STREQUAL "NUMBER")
+        math(EXPR found "${found} + 1")
+        set(comparisonValue "double(${value})")
+    endif()
+    _configcat_embed_get(list type "${JSON}" l)
+    if(type STREQUAL "ARRAY")
+        math(EXPR found "${found} + 1")
+        set(comparisonValue "std::vector<std::string>{")
+        string(JSON count LENGTH "${list}")
+        if(count GREATER 0)
+            math(EXPR last "${count} - 1")
+            foreach(index RANGE ${last})
+                string(JSON item GET "${list}" ${index})
+                _configcat_embed_literal(literal "${item}")
+                if(index GREATER 0)
+                    string(APPEND comparisonValue ",")
+                endif()
+                string(APPEND comparisonValue " std::string(${literal})")
+            endforeach()
+        endif()
+        string(APPEND comparisonValue " }")
+    endif()
+    # A condition with more than one comparison value is left without one (and is reported by the evaluation).
+    if(found EQUAL 1)
+        string(APPEND CODE "${INDENT}condition.comparisonValue = ${comparisonValue};\n")
+    endif()
+    set(CODE "${CODE}" PARENT_SCOPE)
+endfunction()
+
+# The conditions of a targeting rule.
+function(_configcat_embed_conditions TARGET JSON INDENT PATH)
+    string(JSON count LENGTH "${JSON}")
+    if(count EQUAL 0)
+        return()
+    endif()
+    math(EXPR last "${count} - 1")
+    foreach(index RANGE ${last})
+        string(JSON container GET "${JSON}" ${index})
+        set(conditionPath "${PATH}[${index}]")
+        _configcat_embed_get(userCondition userType "${container}" u)
+        _configcat_embed_get(prerequisiteCondition prerequisiteType "${container}" p)
+        _configcat_embed_get(segmentCondition segmentType "${container}" s)
+        set(found 0)
+        foreach(type "${userType}" "${prerequisiteType}" "${segmentType}")
+            if(NOT type STREQUAL "")
+                math(EXPR found "${found} + 1")
+            endif()
+        endforeach()
+
+        string(APPEND CODE "${INDENT}{\n")
+        set(element "${TARGET}.emplace_back().condition")
+        if(NOT found EQUAL 1)
+            # Left empty like in the SDK, the evaluation reports it.
+            string(APPEND CODE "${INDENT}    ${TARGET}.emplace_back();\n")
+        elseif(userType STREQUAL "OBJECT")
+            _configcat_embed_user_condition("${element}.emplace<UserCondition>()" "${userCondition}" "${INDENT}    " "${conditionPath}.u")
+        elseif(prerequisiteType STREQUAL "OBJECT")
+            _configcat_embed_require(flagKey "${prerequisiteCondition}" f STRING "${conditionPath}.p")
+            _configcat_embed_require(comparator "${prerequisiteCondition}" c NUMBER "${conditionPath}.p")
+            _configcat_embed_literal(literal "${flagKey}")
+            string(APPEND CODE "${INDENT}    auto& condition = ${element}.emplace<PrerequisiteFlagCondition>();\n"
+                               "${INDENT}    condition.prerequisiteFlagKey = ${literal};\n"
+                               "${INDENT}    condition.comparator = static_cast<PrerequisiteFlagComparator>(${comparator});\n")
+            _configcat_embed_get(value type "${prerequisiteCondition}" v)
+            if(type STREQUAL "OBJECT")
+                _configcat_embed_setting_value(condition.comparisonValue "${value}" "${INDENT}    " "${conditionPath}.p.v")
+            endif()
+        elseif(segmentType STREQUAL "OBJECT")
+            _configcat_embed_require(segmentIndex "${segmentCondition}" s NUMBER "${conditionPath}.s")
+            _configcat_embed_require(comparator "${segmentCondition}" c NUMBER "${conditionPath}.s")
+            string(APPEND CODE "${INDENT}    auto& condition = ${element}.emplace<SegmentCondition>();\n"
+                               "${INDENT}    condition.segmentIndex = ${segmentIndex};\n"
+                               "${INDENT}    condition.comparator = static_cast<SegmentComparator>(${comparator});\n")
+        else()
+            _configcat_embed_fail("${conditionPath}" "the condition is not an object")
+        endif()
+        string(APPEND CODE "${INDENT}}\n")
+    endforeach()
+    set(CODE "${CODE}" PARENT_SCOPE)
+endfunction()
+
+function(_configcat_embed_targeting_rules TARGET JSON INDENT PATH)
+    string(JSON count LENGTH "${JSON}")
+    if(count EQUAL 0)
+        return()
+    endif()
+    math(EXPR last "${count} - 1")
+    foreach(index RANGE ${last})
+        string(JSON rule GET "${JSON}" ${index})
+        set(rulePath "${PATH}[${index}]")
+        string(APPEND CODE "${INDENT}{\n"
+                           "${INDENT}    auto& rule = ${TARGET}.emplace_back();\n")
+        _configcat_embed_get(conditions type "${rule}" c)
+        if(type STREQUAL "ARRAY")
+            _configcat_embed_conditions(rule.conditions "${conditions}" "${INDENT}    " "${rulePath}.c")
+        endif()
+        _configcat_embed_get(simpleValue simpleType "${rule}" s)
+        _configcat_embed_get(percentageOptions percentageType "${rule}" p)
+        if(simpleType STREQUAL "OBJECT" AND percentageType STREQUAL "")
+            string(APPEND CODE "${INDENT}    auto& then = rule.then.emplace<SettingValueContainer>();\n")
+            _configcat_embed_value_container(then "${simpleValue}" "${INDENT}    " "${rulePath}.s")
+        elseif(percentageType STREQUAL "ARRAY" AND simpleType STREQUAL "")
+            string(APPEND CODE "${INDENT}    auto& options = rule.then.emplace<PercentageOptions>();\n")
+            _configcat_embed_percentage_options(options "${percentageOptions}" "${INDENT}    " "${rulePath}.p")
+        endif()
+        string(APPEND CODE "${INDENT}}\n")
+    endforeach()
+    set(CODE "${CODE}" PARENT_SCOPE)
+endfunction()
+
+function(_configcat_embed_preferences JSON INDENT)
+    string(APPEND CODE "${INDENT}{\n"
+                       "${INDENT}    auto& preferences = config->preferences.emplace();\n")
+    _configcat_embed_get(baseUrl type "${JSON}" u)
+    if(type STREQUAL "STRING")
+        _configcat_embed_literal(literal "${baseUrl}")
+        string(APPEND CODE "${INDENT}    preferences.baseUrl = ${literal};\n")
+    endif()
+    _configcat_embed_get(redirectMode type "${JSON}" r)
+    if(type STREQUAL "NUMBER")
+        string(APPEND CODE "${INDENT}    preferences.redirectMode = static_cast<RedirectMode>(${redirectMode});\n")
+    endif()
+    _configcat_embed_get(salt type "${JSON}" s)
+    if(type STREQUAL "STRING")
+        _configcat_embed_literal(literal "${salt}")
+        string(APPEND CODE "${INDENT}    preferences.salt = std::make_shared<std::string>(${literal});\n")
+    endif()
+    string(APPEND CODE "${INDENT}}\n")
+    set(CODE "${CODE}" PARENT_SCOPE)
+endfunction()
+
+function(_configcat_embed_segments JSON INDENT)
+    string(APPEND CODE "${INDENT}config->segments = std::make_shared<Segments>();\n")
+    string(JSON count LENGTH "${JSON}")
+    if(count GREATER 0)
+        math(EXPR last "${count} - 1")
+        foreach(index RANGE ${last})
+            string(JSON segment GET "${JSON}" ${index})
+            _configcat_embed_require(name "${segment}" n STRING "s[${index}]")
+            _configcat_embed_literal(literal "${name}")
+            string(APPEND CODE "${INDENT}{\n"
+                               "${INDENT}    auto& segment = config->segments->emplace_back();\n"
+                               "${INDENT}    segment.name = std::string(${literal});\n")
+            _configcat_embed_get(conditions type "${segment}" r)
+            if(type STREQUAL "ARRAY")
+                string(JSON conditionCount LENGTH "${conditions}")
+                if(conditionCount GREATER 0)
+                    math(EXPR lastCondition "${conditionCount} - 1")
+                    foreach(conditionIndex RANGE ${lastCondition})
+                        string(JSON condition GET "${conditions}" ${conditionIndex})
+                        string(APPEND CODE "${INDENT}    {\n")
+                        _configcat_embed_user_condition("segment.conditions.emplace_back()" "${condition}" "${INDENT}        "
+                                                        "s[${index}].r[${conditionIndex}]")
+                        string(APPEND CODE "${INDENT}    }\n")
+                    endforeach()
+                endif()
+            endif()
+            string(APPEND CODE "${INDENT}}\n")
+        endforeach()
+    endif()
+    set(CODE "${CODE}" PARENT_SCOPE)
+endfunction()
+
+function(_configcat_embed_settings JSON INDENT)
+    string(JSON count LENGTH "${JSON}")
+    string(APPEND CODE "${INDENT}config->settings = std::make_shared<Settings>();\n"
+                       "${INDENT}config->settings->reserve(${count});\n")
+    if(count GREATER 0)
+        math(EXPR last "${count} - 1")
+        foreach(index RANGE ${last})
+            string(JSON key MEMBER "${JSON}" ${index})
+            string(JSON setting GET "${JSON}" "${key}")
+            set(settingPath "f.${key}")
+            _configcat_embed_require(type "${setting}" t NUMBER "${settingPath}")
+            _configcat_embed_literal(literal "${key}")
+            string(APPEND CODE "${INDENT}{\n"
+                               "${INDENT}    auto& setting = (*config->settings)[${literal}];\n"
+                               "${INDENT}    setting.type = static_cast<SettingType>(${type});\n")
+            _configcat_embed_get(attribute attributeType "${setting}" a)
+            if(attributeType STREQUAL "STRING")
+                _configcat_embed_literal(literal "${attribute}")
+                string(APPEND CODE "${INDENT}    setting.percentageOptionsAttribute = ${literal};\n")
+            endif()
+            _configcat_embed_get(rules rulesType "${setting}" r)
+            if(rulesType STREQUAL "ARRAY")
+                _configcat_embed_targeting_rules(setting.targetingRules "${rules}" "${INDENT}    " "${settingPath}.r")
+            endif()
+            _configcat_embed_get(options optionsType "${setting}" p)
+            if(optionsType STREQUAL "ARRAY")
+                _configcat_embed_percentage_options(setting.percentageOptions "${options}" "${INDENT}    " "${settingPath}.p")
+            endif()
+            _configcat_embed_value_container(setting "${setting}" "${INDENT}    " "${settingPath}")
+            string(APPEND CODE "${INDENT}}\n")
+        endforeach()
+    endif()
+    set(CODE "${CODE}" PARENT_SCOPE)
+endfunction()
+
+file(READ "${CONFIGCAT_EMBED_JSON_FILE}" JSON_CONTENT)
+string(JSON ROOT_TYPE ERROR_VARIABLE JSON_ERROR TYPE "${JSON_CONTENT}")
+if(JSON_ERROR)
+    message(FATAL_ERROR "Invalid config JSON ${CONFIGCAT_EMBED_JSON_FILE}: ${JSON_ERROR}")
+elseif(NOT ROOT_TYPE STREQUAL "OBJECT")
+    message(FATAL_ERROR "Invalid config JSON ${CONFIGCAT_EMBED_JSON_FILE}: the root is not an object")
+endif()
+
+set(CODE "")
+_configcat_embed_get(PREFERENCES TYPE "${JSON_CONTENT}" p)
+if(TYPE STREQUAL "OBJECT")
+    _configcat_embed_preferences("${PREFERENCES}" "    ")
+endif()
+_configcat_embed_get(SEGMENTS TYPE "${JSON_CONTENT}" s)
+if(TYPE STREQUAL "ARRAY")
+    _configcat_embed_segments("${SEGMENTS}" "    ")
+endif()
+_configcat_embed_get(SETTINGS TYPE "${JSON_CONTENT}" f)
+if(TYPE STREQUAL "OBJECT")
+    _configcat_embed_settings("${SETTINGS}" "    ")
+endif()
+
+file(WRITE "${CONFIGCAT_EMBED_HEADER_FILE}"
+"// Generated by configcat_embed_config from ${CONFIGCAT_EMBED_JSON_FILE}, do not edit.
+#pragma once
+
+#include \"configcat/embeddedconfig.h\"
+
+extern const configcat::EmbeddedConfig ${CONFIGCAT_EMBED_NAME};
+")
+
+file(WRITE "${CONFIGCAT_EMBED_SOURCE_FILE}"
+"// Generated by configcat_embed_config from ${CONFIGCAT_EMBED_JSON_FILE}, do not edit.
+#include \"${CONFIGCAT_EMBED_NAME}.h\"
+
+namespace {
+
+std::shared_ptr<configcat::Config> build() {
+    using namespace configcat;
+
+    auto config = std::make_shared<Config>();
+${CODE}    return config;
+}
+
+} // namespace
+
+const configcat::EmbeddedConfig ${CONFIGCAT_EMBED_NAME}(build);
+")
@@ -0,0 +1,38 @@
+# configcat_embed_config(<target> <name> <json-file>)
+#
+# Compiles the config JSON snapshot (e.g. a downloaded config_v6.json) into <target> as the `configcat::EmbeddedConfig <name>`
+# object, declared in the generated `<name>.h` header (on the include path of <target>):
+#
+#   #include "<name>.h"
+#   options.initialConfig = <name>.config();
+#
+# The JSON is decoded at build time into the code building the config model, so the snapshot needs no parsing at
+# runtime. It's regenerated when the JSON file changes. Requires CMake 3.19 or later.
+function(configcat_embed_config TARGET NAME JSON_FILE)
+    if(CMAKE_VERSION VERSION_LESS 3.19)
+        message(FATAL_ERROR "configcat_embed_config requires CMake 3.19 or later.")
+    endif()
+
+    get_filename_component(JSON_FILE "${JSON_FILE}" ABSOLUTE)
+    set(OUTPUT_DIR "${CMAKE_CURRENT_BINARY_DIR}/configcat_embedded")
+    set(HEADER_FILE "${OUTPUT_DIR}/${NAME}.h")
+    set(SOURCE_FILE "${OUTPUT_DIR}/${NAME}.cpp")
+
+    add_custom_command(
+        OUTPUT "${HEADER_FILE}" "${SOURCE_FILE}"
+        COMMAND "${CMAKE_COMMAND}"
+            -DCONFIGCAT_EMBED_NAME=${NAME}
+            -DCONFIGCAT_EMBED_JSON_FILE=${JSON_FILE}
+            -DCONFIGCAT_EMBED_HEADER_FILE=${HEADER_FILE}
+            -DCONFIGCAT_EMBED_SOURCE_FILE=${SOURCE_FILE}
+            -P "${CONFIGCAT_EMBED_CONFIG_SCRIPT}"
+        DEPENDS "${JSON_FILE}" "${CONFIGCAT_EMBED_CONFIG_SCRIPT}"
+        COMMENT "Embedding ConfigCat config snapshot ${NAME}"
+        VERBATIM
+    )
+
+    target_sources(${TARGET} PRIVATE "${HEADER_FILE}" "${SOURCE_FILE}")
+    target_include_directories(${TARGET} PRIVATE "${OUTPUT_DIR}")
+endfunction()
+
+set(CONFIGCAT_EMBED_CONFIG_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/configcat-embed-config-generate.cmake" CACHE INTERNAL "")
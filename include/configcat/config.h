@@ -5,6 +5,7 @@
 #include <optional>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
 #include <vector>
@@ -197,6 +198,9 @@ public:
     }
 };
 
+// The strings of the config model are plain `std::string`s, they are not interned in a per-config pool. They are part
+// of the public API, and most of them (attribute names, variation IDs, short comparison values) fit in the small string
+// buffer, so referring to pooled strings would take up more memory than the duplicates do (see `Config::memoryUsage`).
 struct SettingValueContainer {
     static constexpr char kValue[] = "v";
     static constexpr char kVariationId[] = "i";
@@ -283,6 +287,8 @@ struct Segment {
 using Segments = std::vector<Segment>;
 
 struct Config;
+struct ConfigDiff;
+struct LazySetting;
 class RolloutEvaluator;
 
 struct Setting : public SettingValueContainer {
@@ -301,11 +307,21 @@ struct Setting : public SettingValueContainer {
     inline bool hasInvalidType() const { return type < SettingType::Boolean || SettingType::Double < type; }
     SettingType getTypeChecked() const;
 
+    /**
+     * Returns the fully decoded setting.
+     * When the config was parsed with lazy setting decoding (see `ConfigCatOptions::lazySettingDecoding`), only the type
+     * of the setting is available up front. The rest is decoded (thread-safely) on the first call and cached afterwards.
+     * Otherwise, it returns the setting itself.
+     */
+    const Setting& getDecoded() const;
+
 protected:
     friend struct Config;
+    friend struct ConfigDiff;
     friend class RolloutEvaluator;
     std::shared_ptr<std::string> configJsonSalt;
     std::shared_ptr<Segments> segments;
+    std::shared_ptr<LazySetting> lazySetting;
 };
 
 using Settings = std::unordered_map<std::string, Setting>;
@@ -344,6 +360,31 @@ struct Preferences {
     Preferences& operator=(Preferences&& other) noexcept = default;
 };
 
+/**
+ * Estimated heap memory held by a parsed config, in bytes (see `Config::memoryUsage`).
+ */
+struct ConfigMemoryUsage {
+    /** The settings with their targeting rules, conditions, percentage options and values (excluding the strings). */
+    size_t settings = 0;
+    /** The segments with their conditions (excluding the strings). */
+    size_t segments = 0;
+    /** The character data of the strings: keys, attribute names, variation IDs, comparison values, salt, etc. */
+    size_t strings = 0;
+    /** The arrays of the list comparison values (their strings are counted in `strings`). */
+    size_t comparisonLists = 0;
+    /** The lookup table: the hash table of the settings by key. */
+    size_t indexes = 0;
+    /**
+     * The config.json referenced for lazy setting decoding (see `ConfigCatOptions::lazySettingDecoding`).
+     * Its text is counted only when no one else holds it, otherwise it's shared with the cached entry (see `MemoryStats::configJsonString`).
+     */
+    size_t lazySource = 0;
+
+    inline size_t total() const { return settings + segments + strings + comparisonLists + indexes + lazySource; }
+
+    ConfigMemoryUsage& operator+=(const ConfigMemoryUsage& other);
+};
+
 /**
  * Details of a ConfigCat config.
  */
@@ -364,7 +405,13 @@ struct Config {
     static const std::shared_ptr<const Config> empty;
 
     std::string toJson();
-    static std::shared_ptr<Config> fromJson(const std::string& jsonString, bool tolerant = false);
+    // When `lazySettingDecoding` is true, only the keys and types of the settings are decoded up front (see `Setting::getDecoded`).
+    // When `configArena` is true, the JSON DOM built by the parse is allocated from a monotonic arena (see `ConfigCatOptions::configArena`).
+    static std::shared_ptr<Config> fromJson(const std::string& jsonString, bool tolerant = false, bool lazySettingDecoding = false,
+                                            bool configArena = false);
+    // Same as above, but the lazily decoded settings reference the given text instead of a copy of it.
+    static std::shared_ptr<Config> fromJson(const std::shared_ptr<const std::string>& jsonString, bool lazySettingDecoding,
+                                            bool configArena = false);
     static std::shared_ptr<Config> fromFile(const std::string& filePath, bool tolerant = true);
 
     std::optional<Preferences> preferences;
@@ -373,6 +420,12 @@ struct Config {
 
     std::shared_ptr<Segments> getSegmentsOrEmpty() const { return segments ? segments : std::make_shared<Segments>(); }
     std::shared_ptr<Settings> getSettingsOrEmpty() const { return settings ? settings : std::make_shared<Settings>(); }
+    // The settings with all their members decoded. When the config was parsed with lazy setting decoding, it decodes the
+    // settings which are not decoded yet and returns copies of them, otherwise it's the same as `getSettingsOrEmpty`.
+    std::shared_ptr<Settings> getDecodedSettingsOrEmpty() const;
+
+    // Estimates the heap memory held by the config. Lazily decoded settings are counted as decoded so far.
+    ConfigMemoryUsage memoryUsage() const;
 
     Config() {}
 
@@ -395,7 +448,43 @@ struct Config {
 
     Config& operator=(Config&& other) noexcept = default;
 private:
+    friend class EmbeddedConfig;
+    friend class StreamingConfigParser;
+
+    static std::shared_ptr<Config> fromJsonLazy(const std::shared_ptr<const std::string>& jsonString, bool configArena);
     void fixupSaltAndSegments();
+    // Decode a member of the config.json object and a single setting of its settings object (the key and the value are
+    // given as JSON texts). Used by the parsing which decodes the members as they are downloaded.
+    void decodeMember(std::string_view keyJson, std::string_view valueJson, bool configArena);
+    void decodeSetting(std::string_view keyJson, std::string_view valueJson, bool configArena);
+};
+
+/**
+ * Structural difference between two versions of a ConfigCat config.
+ */
+struct ConfigDiff {
+    /** Keys of the settings which are present only in the new config. */
+    std::vector<std::string> addedKeys;
+    /** Keys of the settings which are present only in the old config. */
+    std::vector<std::string> removedKeys;
+    /**
+     * Keys of the settings which are present in both configs but their definition changed
+     * or they depend on a changed segment or prerequisite flag (directly or indirectly).
+     */
+    std::vector<std::string> modifiedKeys;
+    /** Names of the segments which were added, removed or changed. */
+    std::vector<std::string> changedSegments;
+
+    /**
+     * Computes the difference between the two configs.
+     * NOTE: when the configs were parsed with lazy setting decoding, the settings may need to be decoded to find the dependencies.
+     */
+    static ConfigDiff compute(const Config& oldConfig, const Config& newConfig);
+
+    inline bool empty() const { return addedKeys.empty() && removedKeys.empty() && modifiedKeys.empty() && changedSegments.empty(); }
+
+    /** Returns true if the setting with the specified key was added, removed or modified. */
+    bool contains(const std::string& key) const;
 };
 
 } // namespace configcat
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <chrono>
+#include <functional>
+#include <future>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -9,6 +12,9 @@
 #include "configcatoptions.h"
 #include "refreshresult.h"
 #include "evaluationdetails.h"
+#include "metrics.h"
+#include "evaluationprofile.h"
+#include "memorystats.h"
 
 
 namespace configcat {
@@ -19,7 +25,12 @@ class ConfigFetcher;
 class RolloutEvaluator;
 class FlagOverrides;
 class ConfigService;
+class MetricsRegistry;
+class EvaluationProfiler;
+class Tracer;
 struct SettingResult;
+struct EvaluateContext;
+struct EvaluateResult;
 
 class ConfigCatClient {
 public:
@@ -41,6 +52,13 @@ public:
     // Returns count of [ConfigCatClient] instances.
     static size_t instanceCount();
 
+    // Sets the maximum number of worker threads of the process-wide scheduler which runs the auto-polling of all
+    // [ConfigCatClient] instances (default: 2, at most 16). Together with its timer thread, the scheduler uses at most
+    // `workerCount + 1` threads regardless of the number of clients. It starts with a single worker and adds more when the
+    // polls of several clients are due at once, the added ones exit when they're idle for a minute.
+    // Takes effect when the scheduler is started, i.e. call it before creating the first auto-polling client.
+    static void setPollingWorkerCount(size_t workerCount);
+
     /**
      * Gets a value from the configuration identified by the given `key`.
      *
@@ -94,6 +112,12 @@ public:
     // Initiates a force refresh synchronously on the cached configuration.
     RefreshResult forceRefresh();
 
+    // Initiates a force refresh asynchronously on the cached configuration.
+    // The callback is invoked on the thread completing the HTTP request, which is the I/O thread of the engine with
+    // `HttpTransportOptions::sharedFetchEngine`, and the calling thread when the HttpSessionAdapter doesn't override
+    // `getAsync` (i.e. this call blocks then like `forceRefresh`).
+    void forceRefreshAsync(const std::function<void(RefreshResult)>& callback);
+
     // Sets the default user.
     inline void setDefaultUser(const std::shared_ptr<ConfigCatUser>& user) {
         defaultUser = user;
@@ -113,6 +137,29 @@ public:
     // true when the SDK is configured not to initiate HTTP requests, otherwise false.
     bool isOffline() const;
 
+    // Waits until the client is ready (i.e. the first config acquisition finished) or the timeout expires.
+    // Returns true when the client is ready.
+    bool waitForReady(std::chrono::milliseconds timeout) const;
+
+    // Returns a future which becomes ready when the client is ready.
+    std::shared_future<void> readyFuture() const;
+
+    // Invokes the callback when the client is ready, or immediately when it's already ready.
+    // Unlike the `onClientReady` hook, the callback is invoked even when it's registered after the initialization.
+    void onReady(const std::function<void()>& callback);
+
+    // Returns a snapshot of the metrics collected by the client, which is empty unless
+    // `ConfigCatOptions::collectMetrics` is enabled.
+    MetricsSnapshot metrics() const;
+
+    // Returns the per-flag evaluation statistics collected so far (see `EvaluationProfile::toReport` for a readable
+    // summary), which is empty unless `ConfigCatOptions::profileEvaluations` is enabled.
+    EvaluationProfile evaluationProfile() const;
+
+    // Estimates the memory held by the client for the config of its SDK key (see `MemoryStats::toString` for a readable
+    // breakdown). The flag overrides are not included.
+    MemoryStats memoryStats() const;
+
     // Gets the Hooks object for subscribing events.
     inline std::shared_ptr<Hooks> getHooks() { return hooks; }
 
@@ -139,12 +186,19 @@ private:
                                           const std::shared_ptr<Settings>& settings,
                                           double fetchTime) const;
 
+    // Runs the rollout evaluator, and records the evaluation in the metrics and the trace (when enabled).
+    EvaluateResult evaluateSetting(const std::optional<Value>& defaultValue, EvaluateContext& context, std::optional<Value>& returnValue) const;
+    EvaluateResult evaluateSettingWithMetrics(const std::optional<Value>& defaultValue, EvaluateContext& context, std::optional<Value>& returnValue) const;
+
     std::shared_ptr<Hooks> hooks;
     std::shared_ptr<ConfigCatLogger> logger;
     std::shared_ptr<ConfigCatUser> defaultUser;
     std::unique_ptr<RolloutEvaluator> rolloutEvaluator;
     std::shared_ptr<OverrideDataSource> overrideDataSource;
     std::unique_ptr<ConfigService> configService;
+    std::shared_ptr<MetricsRegistry> metricsRegistry;
+    std::shared_ptr<EvaluationProfiler> evaluationProfiler;
+    std::shared_ptr<Tracer> tracer;
 
     static inline std::mutex& getInstancesMutex() {
         static std::mutex instancesMutex;
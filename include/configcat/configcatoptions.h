@@ -1,8 +1,13 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <string>
 #include <map>
 #include <functional>
+#include <unordered_map>
 #include <vector>
 #include <mutex>
 #include <exception>
@@ -16,9 +21,21 @@
 #include "log.h"
 #include "evaluationdetails.h"
 #include "proxyauthentication.h"
+#include "tracing.h"
 
 namespace configcat {
 
+// The details of a completed config fetch, passed to the `onFetchCompleted` hook.
+struct FetchCompletedInfo {
+    enum class Result { fetched, notModified, failed };
+
+    Result result = Result::failed;
+    long statusCode = 0;                   // 0 when there was no HTTP response
+    std::chrono::nanoseconds duration{0};  // the whole fetch, including the redirects and the parsing of the config JSON
+    std::optional<ResponseTiming> timing;  // of the last HTTP request, when the HttpSessionAdapter measures it
+    std::optional<std::string> errorMessage;
+};
+
 // Hooks for events sent by `ConfigCatClient`.
 class Hooks {
 public:
@@ -34,6 +51,7 @@ public:
         }
         if (onFlagEvaluated) {
             onFlagEvaluatedCallbacks.push_back(onFlagEvaluated);
+            flagEvaluatedSubscribed = true;
         }
         if (onError) {
             onErrorCallbacks.push_back(onError);
@@ -45,14 +63,60 @@ public:
         onClientReadyCallbacks.push_back(callback);
     }
 
+    // With `ConfigCatOptions::lazySettingDecoding`, the settings are decoded for the subscribers (see `Config::getDecodedSettingsOrEmpty`),
+    // after the client has released its locks.
     void addOnConfigChanged(const std::function<void(std::shared_ptr<const Settings>)>& callback) {
         std::lock_guard<std::mutex> lock(mutex);
         onConfigChangedCallbacks.push_back(callback);
     }
 
+    // Identifies a subscription of `addOnConfigChangedWithDiff` or `addOnFlagChanged`, so it can be removed later.
+    using SubscriptionId = uint64_t;
+
+    // Subscribes to config changes, the callback receives the new settings together with what changed compared to the previous config.
+    SubscriptionId addOnConfigChangedWithDiff(const std::function<void(std::shared_ptr<const Settings>, const ConfigDiff&)>& callback) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto id = ++lastSubscriptionId;
+        onConfigChangedWithDiffCallbacks.emplace(id, callback);
+        return id;
+    }
+
+    // Removes a subscription of `addOnConfigChangedWithDiff`. Returns false when there's no such subscription.
+    // A notification being delivered on another thread may still reach the callback.
+    bool removeOnConfigChangedWithDiff(SubscriptionId id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return onConfigChangedWithDiffCallbacks.erase(id) > 0;
+    }
+
+    // Subscribes to the changes of a single feature flag or setting.
+    // The callback is called with the key when the setting is added, removed or modified (see `ConfigDiff::modifiedKeys`).
+    SubscriptionId addOnFlagChanged(const std::string& key, const std::function<void(const std::string&)>& callback) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto id = ++lastSubscriptionId;
+        onFlagChangedCallbacks[key].emplace(id, callback);
+        return id;
+    }
+
+    // Removes a subscription of `addOnFlagChanged`. Returns false when there's no such subscription.
+    // A notification being delivered on another thread may still reach the callback.
+    bool removeOnFlagChanged(SubscriptionId id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = onFlagChangedCallbacks.begin(); it != onFlagChangedCallbacks.end(); ++it) {
+            if (it->second.erase(id) > 0) {
+                // Without subscribers, the diffs are not computed (see `invokeOnConfigChanged`).
+                if (it->second.empty()) {
+                    onFlagChangedCallbacks.erase(it);
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
     void addOnFlagEvaluated(const std::function<void(const EvaluationDetailsBase&)>& callback) {
         std::lock_guard<std::mutex> lock(mutex);
         onFlagEvaluatedCallbacks.push_back(callback);
+        flagEvaluatedSubscribed = true;
     }
 
     void addOnError(const std::function<void(const std::string&, const std::exception_ptr&)>& callback) {
@@ -60,6 +124,12 @@ public:
         onErrorCallbacks.push_back(callback);
     }
 
+    // Subscribes to the completion of the config fetches (successful or not), e.g. to monitor where the time goes.
+    void addOnFetchCompleted(const std::function<void(const FetchCompletedInfo&)>& callback) {
+        std::lock_guard<std::mutex> lock(mutex);
+        onFetchCompletedCallbacks.push_back(callback);
+    }
+
     void invokeOnClientReady() {
         std::lock_guard<std::mutex> lock(mutex);
         for (auto& callback : onClientReadyCallbacks) {
@@ -74,6 +144,72 @@ public:
         }
     }
 
+    // Queues the config change when there's anybody to notify. The change is delivered by `invokeOnConfigDiffs`, which the
+    // caller calls once it has released its own locks, as decoding the settings and computing the diff are not free.
+    void invokeOnConfigChanged(const std::shared_ptr<const Config>& oldConfig, const std::shared_ptr<const Config>& newConfig) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!onConfigChangedCallbacks.empty() || !onConfigChangedWithDiffCallbacks.empty() || !onFlagChangedCallbacks.empty()) {
+            pendingConfigDiffs.emplace_back(oldConfig, newConfig);
+        }
+    }
+
+    // Notifies the config change, the diff and the flag change subscribers of the config changes queued by
+    // `invokeOnConfigChanged`, in the order of the changes. Neither the settings are decoded, nor the diffs are computed,
+    // nor the subscribers are called under the lock.
+    void invokeOnConfigDiffs() {
+        std::unique_lock<std::mutex> lock(mutex);
+        // The changes queued meanwhile are delivered by the call in progress (which may be the caller itself, from a subscriber).
+        if (deliveringConfigDiffs) {
+            return;
+        }
+
+        deliveringConfigDiffs = true;
+        while (!pendingConfigDiffs.empty()) {
+            const auto [oldConfig, newConfig] = std::move(pendingConfigDiffs.front());
+            pendingConfigDiffs.pop_front();
+            // Computing the diff is not free, so let's not do it when nobody is interested in it.
+            const bool diffSubscribed = !onConfigChangedWithDiffCallbacks.empty() || !onFlagChangedCallbacks.empty();
+            lock.unlock();
+
+            const auto diff = diffSubscribed ? ConfigDiff::compute(*oldConfig, *newConfig) : ConfigDiff();
+
+            lock.lock();
+            const auto changedCallbacks = onConfigChangedCallbacks;
+            const auto diffCallbacks = onConfigChangedWithDiffCallbacks;
+            std::vector<std::pair<std::string, std::map<SubscriptionId, std::function<void(const std::string&)>>>> flagChangedCallbacks;
+            for (const auto* keys : { &diff.addedKeys, &diff.removedKeys, &diff.modifiedKeys }) {
+                for (const auto& key : *keys) {
+                    if (const auto it = onFlagChangedCallbacks.find(key); it != onFlagChangedCallbacks.end()) {
+                        flagChangedCallbacks.emplace_back(key, it->second);
+                    }
+                }
+            }
+            lock.unlock();
+
+            const auto settings = changedCallbacks.empty() && diffCallbacks.empty() ? nullptr : newConfig->getDecodedSettingsOrEmpty();
+            for (auto& callback : changedCallbacks) {
+                callback(settings);
+            }
+            for (auto& [_, callback] : diffCallbacks) {
+                callback(settings, diff);
+            }
+            for (auto& [key, callbacks] : flagChangedCallbacks) {
+                for (auto& [_, callback] : callbacks) {
+                    callback(key);
+                }
+            }
+
+            lock.lock();
+        }
+        deliveringConfigDiffs = false;
+    }
+
+    // Whether there's any onFlagEvaluated subscriber. It doesn't lock, so the evaluations can cheaply skip building the
+    // evaluation details which nobody would receive.
+    bool hasOnFlagEvaluated() const {
+        return flagEvaluatedSubscribed;
+    }
+
     void invokeOnFlagEvaluated(const EvaluationDetailsBase& details) {
         std::lock_guard<std::mutex> lock(mutex);
         for (auto& callback : onFlagEvaluatedCallbacks) {
@@ -88,20 +224,91 @@ public:
         }
     }
 
+    void invokeOnFetchCompleted(const FetchCompletedInfo& info) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& callback : onFetchCompletedCallbacks) {
+            callback(info);
+        }
+    }
+
     void clear() {
         std::lock_guard<std::mutex> lock(mutex);
         onClientReadyCallbacks.clear();
         onConfigChangedCallbacks.clear();
+        onConfigChangedWithDiffCallbacks.clear();
+        onFlagChangedCallbacks.clear();
+        pendingConfigDiffs.clear();
         onFlagEvaluatedCallbacks.clear();
+        flagEvaluatedSubscribed = false;
         onErrorCallbacks.clear();
+        onFetchCompletedCallbacks.clear();
     }
 
 private:
     std::mutex mutex;
     std::vector<std::function<void()>> onClientReadyCallbacks;
     std::vector<std::function<void(std::shared_ptr<const Settings>)>> onConfigChangedCallbacks;
+    // Keyed by the subscription ids, which are increasing, so the callbacks are called in the order of subscription.
+    SubscriptionId lastSubscriptionId = 0;
+    std::map<SubscriptionId, std::function<void(std::shared_ptr<const Settings>, const ConfigDiff&)>> onConfigChangedWithDiffCallbacks;
+    std::unordered_map<std::string, std::map<SubscriptionId, std::function<void(const std::string&)>>> onFlagChangedCallbacks;
+    std::deque<std::pair<std::shared_ptr<const Config>, std::shared_ptr<const Config>>> pendingConfigDiffs;
+    bool deliveringConfigDiffs = false;
     std::vector<std::function<void(const EvaluationDetailsBase&)>> onFlagEvaluatedCallbacks;
+    std::atomic<bool> flagEvaluatedSubscribed{false};
     std::vector<std::function<void(const std::string&, const std::exception_ptr&)>> onErrorCallbacks;
+    std::vector<std::function<void(const FetchCompletedInfo&)>> onFetchCompletedCallbacks;
+};
+
+// Tuning options of the built-in HTTP transport (based on libcurl).
+// These are ignored when a custom `httpSessionAdapter` is provided.
+struct HttpTransportOptions {
+    // Accept compressed responses using all the encodings the linked libcurl supports (e.g. gzip, deflate, br).
+    bool compression = false;
+
+    // Request HTTP/2 for HTTPS connections, falls back to HTTP/1.1 when the server doesn't support it.
+    // When disabled, the HTTP version is left to the libcurl default.
+    bool http2 = false;
+
+    // Reuse the connection (and the TLS session) of the previous fetch, so subsequent fetches can skip the handshakes.
+    // This is the libcurl default. When disabled, every fetch opens a fresh connection that is closed after the fetch.
+    bool connectionReuse = true;
+
+    // The number of seconds an idle connection is kept for reuse (0 means the libcurl default, which is 118 seconds).
+    // Set this to a value greater than the polling interval to reuse the connection between polls.
+    uint32_t maxIdleConnectionSeconds = 0;
+
+    // Send TCP keep-alive probes on idle connections.
+    bool tcpKeepAlive = false;
+    uint32_t tcpKeepAliveIdleSeconds = 60;
+    uint32_t tcpKeepAliveIntervalSeconds = 30;
+
+    // Run the fetches on the process-wide fetch engine instead of a blocking transfer per client.
+    // The engine performs the fetches of all the clients (that enable this option) on a single I/O thread, multiplexes them
+    // over shared HTTP/2 connections and shares the DNS and TLS session caches between them.
+    // Recommended when many clients (e.g. one per SDK key) live in the same process.
+    bool sharedFetchEngine = false;
+};
+
+// Retry behaviour of the fetches on transient failures (the ConfigCat CDN can't be reached or responds with a server error).
+struct FetchRetryOptions {
+    // Randomizes the auto polling interval and the retry delays below by up to ± this fraction of them (e.g. 0.1 means ±10%),
+    // so a fleet of clients started at the same time doesn't poll in lock-step (0 means no jitter).
+    double jitter = 0.0;
+
+    // After a transient failure, the next fetch is attempted `initialBackoffMs` later at the earliest, and the delay doubles
+    // with each further consecutive failure up to `maxBackoffMs`. In the meantime the cached config is served, also in lazy
+    // loading mode which would retry on every evaluation otherwise. In auto polling mode the polling interval is the lower
+    // bound of the delay. Explicit refreshes are not delayed (0 means the backoff is disabled).
+    uint32_t initialBackoffMs = 0;
+    uint32_t maxBackoffMs = 300000;
+
+    // The number of consecutive transient failures that open the circuit breaker (0 means the breaker is disabled).
+    // While the breaker is open, the cached config is served without trying the network, even on explicit refreshes.
+    // After `circuitBreakerOpenMs` a single probe fetch is let through (half-open): the breaker closes when it succeeds,
+    // and opens again when it fails.
+    uint32_t circuitBreakerThreshold = 0;
+    uint32_t circuitBreakerOpenMs = 60000;
 };
 
 // Configuration options for ConfigCatClient.
@@ -120,6 +327,17 @@ struct ConfigCatOptions {
     // The number of milliseconds to wait for the server to respond before giving up.
     uint32_t readTimeoutMs = 5000; // milliseconds (0 means it never times out during transfer)
 
+    // Hedged fetching: when the response doesn't arrive within this many milliseconds, the same request is sent to
+    // `hedgeBaseUrl` as well, and the first valid response is used (0 means hedging is disabled).
+    // With the built-in transport, enabling hedging turns on `HttpTransportOptions::sharedFetchEngine` for the fetches.
+    uint32_t hedgeDelayMs = 0;
+
+    // The base url of the hedged request. When empty, the EU CDN is used with `DataGovernance::Global`, while there's no
+    // hedging with `DataGovernance::EuOnly` or a custom `baseUrl`.
+    // A custom `httpSessionAdapter` must support concurrent requests to be used with hedging, and it should override
+    // `getAsync`, as the hedged request is started on a worker of the shared polling scheduler.
+    std::string hedgeBaseUrl;
+
     // The polling mode.
     std::shared_ptr<PollingMode> pollingMode = PollingMode::autoPoll();
 
@@ -129,6 +347,12 @@ struct ConfigCatOptions {
     // Feature flag and setting overrides.
     std::shared_ptr<FlagOverrides> flagOverrides;
 
+    // Config to evaluate from until the first config is fetched (or loaded from the cache), e.g. a snapshot embedded into the
+    // binary with the `configcat_embed_config` CMake function (see `EmbeddedConfig`). Unlike `flagOverrides`, it's replaced
+    // by the downloaded config. When it's set, the client doesn't wait for the first fetch: in auto polling mode the polling
+    // takes care of it, in lazy loading mode the first evaluation starts it in the background.
+    std::shared_ptr<const Config> initialConfig;
+
     // Proxy addresses. e.g. { "https": "your_proxy_ip:your_proxy_port" }
     std::map<std::string, std::string> proxies; // Protocol, Proxy url
 
@@ -138,6 +362,12 @@ struct ConfigCatOptions {
     // Custom `HttpSessionAdapter` used by the HTTP calls.
     std::shared_ptr<HttpSessionAdapter> httpSessionAdapter;
 
+    // Tuning options of the built-in HTTP transport.
+    HttpTransportOptions httpTransport;
+
+    // Backoff, jitter and circuit breaker settings of the fetches.
+    FetchRetryOptions fetchRetry;
+
     /// The default user, used as fallback when there's no user parameter is passed to the getValue() method.
     std::shared_ptr<ConfigCatUser> defaultUser;
 
@@ -149,6 +379,47 @@ struct ConfigCatOptions {
 
     /// Indicates whether the SDK should be initialized in offline mode or not.
     bool offline = false;
+
+    /// Indicates whether the settings of the downloaded or cached config.json should be decoded lazily.
+    /// When enabled, only the keys and types of the settings are decoded when loading the config.json, the rest of a setting
+    /// is decoded the first time it's evaluated. Recommended for very large configs of which only a few settings are used.
+    bool lazySettingDecoding = false;
+
+    /// Indicates whether the downloaded config.json should be parsed while it's being downloaded, instead of after the download.
+    /// Shortens the time to the fetched config by overlapping the parse with the transfer, mostly noticeable with large configs.
+    /// The settings are decoded one by one as they arrive, so the DOM of the whole config.json is not built either.
+    /// Requires an `HttpSessionAdapter` supporting `getStreamingAsync` (like the built-in one), and has no effect together
+    /// with `lazySettingDecoding`.
+    bool streamingParse = false;
+
+    /// Indicates whether the JSON DOM built while parsing a config.json should be allocated from a monotonic arena.
+    /// When enabled, the thousands of temporary DOM nodes are carved out of a few large blocks, which are released in one step
+    /// when the parse ends, instead of being allocated and freed one by one. The parsed config itself is made of standard
+    /// containers and strings, so it's allocated from the heap either way.
+    bool configArena = false;
+
+    /// Indicates whether the evaluations made before the client is ready wait for the initialization in auto polling mode
+    /// (for `maxInitWaitTimeInSeconds` at most). When disabled, those evaluations return the cached values (or the default
+    /// values when there's nothing in the cache) immediately. Use `ConfigCatClient::waitForReady()` or
+    /// `ConfigCatClient::onReady()` to wait for the initialization explicitly.
+    bool waitForInitOnEvaluation = true;
+
+    /// Indicates whether the client should collect metrics (evaluation counts and latency, errors, fetch and cache statistics).
+    /// The collected metrics are available through `ConfigCatClient::metrics()`.
+    bool collectMetrics = false;
+
+    /// Indicates whether the client should profile the evaluations per feature flag or setting (evaluation count, time spent,
+    /// targeting rules and conditions visited, matched rules, SHA computations). The collected statistics are available
+    /// through `ConfigCatClient::evaluationProfile()`. Adds some overhead to each evaluation, meant for diagnostics.
+    bool profileEvaluations = false;
+
+    /// Receives the spans of the internal operations of the client (config fetches, HTTP requests, parsing, cache access,
+    /// snapshot swaps), e.g. a `FileSpanExporter` writing a trace file which can be viewed as a timeline.
+    /// Tracing is disabled when not set.
+    std::shared_ptr<SpanExporter> spanExporter;
+
+    /// The ratio of the evaluations traced when `spanExporter` is set, between 0 (none, the default) and 1 (all of them).
+    double traceEvaluationSampleRate = 0;
 };
 
 } // namespace configcat
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include "config.h"
+
+namespace configcat {
+
+// A config JSON snapshot compiled into the binary by the `configcat_embed_config` CMake function.
+// Pass `config()` as `ConfigCatOptions::initialConfig` to evaluate from the snapshot until the first fetch completes.
+class EmbeddedConfig {
+public:
+    // `build` is the generated code creating the config model of the snapshot, the JSON is decoded at build time.
+    explicit EmbeddedConfig(std::shared_ptr<Config> (*build)()) : build(build) {}
+
+    EmbeddedConfig(const EmbeddedConfig&) = delete;
+    EmbeddedConfig& operator=(const EmbeddedConfig&) = delete;
+
+    // Returns the snapshot. It's built on the first call only, so the clients of the process share the instance.
+    std::shared_ptr<const Config> config() const;
+
+private:
+    std::shared_ptr<Config> (*build)();
+    mutable std::once_flag buildFlag;
+    mutable std::shared_ptr<const Config> builtConfig;
+};
+
+} // namespace configcat
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace configcat {
+
+// The evaluation statistics of a single feature flag or setting.
+struct FlagProfile {
+    std::string key;
+    uint64_t evaluations = 0;
+    std::chrono::nanoseconds totalTime{0};
+
+    // The work done by the evaluations, including the prerequisite flags and segments they depend on.
+    uint64_t targetingRulesVisited = 0;
+    uint64_t conditionsVisited = 0;
+    uint64_t shaComputations = 0;
+
+    // The number of evaluations per matched targeting rule (by index), -1 counts the evaluations where no rule matched.
+    std::map<int, uint64_t> matchedRules;
+
+    inline std::chrono::nanoseconds averageTime() const {
+        return evaluations > 0 ? totalTime / static_cast<std::chrono::nanoseconds::rep>(evaluations) : std::chrono::nanoseconds(0);
+    }
+};
+
+// A point-in-time copy of the statistics collected by the evaluation profiler (see `ConfigCatOptions::profileEvaluations`).
+struct EvaluationProfile {
+    // Sorted by total time in descending order, so the most expensive flags come first.
+    std::vector<FlagProfile> flags;
+
+    // Renders a human-readable report of the top `top` flags by total time and by evaluation count.
+    std::string toReport(size_t top = 10) const;
+};
+
+} // namespace configcat
@@ -1,7 +1,15 @@
 #pragma once
 
+#include <chrono>
 #include <string>
 #include <map>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <vector>
 #include <stdint.h>
 #include "proxyauthentication.h"
 
@@ -14,6 +22,18 @@ enum class ResponseErrorCode : int {
     InternalError = 3
 };
 
+// The timing breakdown of a request. Like the libcurl timers, the times are measured from the start of the request,
+// e.g. the TLS handshake took `tlsHandshake - connect` and the server responded in `firstByte - tlsHandshake`.
+struct ResponseTiming {
+    std::chrono::microseconds nameLookup{0};   // the name resolution was completed
+    std::chrono::microseconds connect{0};      // the TCP connection was established
+    std::chrono::microseconds tlsHandshake{0}; // the TLS handshake was completed (0 for plain HTTP)
+    std::chrono::microseconds firstByte{0};    // the first byte of the response was received
+    std::chrono::microseconds total{0};
+    uint64_t downloadedBytes = 0;              // the size of the body as received (before decompression)
+    bool connectionReused = false;             // an existing connection was used, so there was no lookup, connect or handshake
+};
+
 struct Response {
     long statusCode = 0;
     std::string text;
@@ -21,17 +41,143 @@ struct Response {
 
     ResponseErrorCode errorCode = ResponseErrorCode::OK;
     std::string error;
+
+    // Filled by the adapters which can measure it (like the built-in one), also for the failed requests when possible.
+    std::optional<ResponseTiming> timing;
+};
+
+// Signals the cancellation of an asynchronous request.
+class CancellationToken {
+public:
+    bool isCancelled() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return cancelled;
+    }
+
+    // Cancels the token and invokes the registered callbacks (only the first call has effect).
+    void cancel() {
+        std::vector<std::function<void()>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (cancelled) {
+                return;
+            }
+            cancelled = true;
+            callbacks.swap(onCancelledCallbacks);
+        }
+        for (const auto& callback : callbacks) {
+            callback();
+        }
+    }
+
+    // Registers a callback to be invoked on cancellation. It's invoked immediately when the token is already cancelled.
+    void onCancelled(const std::function<void()>& callback) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!cancelled) {
+                onCancelledCallbacks.push_back(callback);
+                return;
+            }
+        }
+        callback();
+    }
+
+private:
+    mutable std::mutex mutex;
+    bool cancelled = false;
+    std::vector<std::function<void()>> onCancelledCallbacks;
 };
 
+using ResponseCallback = std::function<void(Response)>;
+using BodyChunkCallback = std::function<void(const char* data, size_t size)>;
+
+// The HTTP transport of the SDK. Implementations must override at least one of `get` and `getAsync`,
+// the default implementation of each is built on the other (and they throw `std::logic_error` when neither is overridden).
 class HttpSessionAdapter {
 public:
     virtual bool init(uint32_t connectTimeoutMs, uint32_t readTimeoutMs) = 0;
+
+    // Performs the request and blocks until it's completed.
     virtual Response get(const std::string& url,
                          const std::map<std::string, std::string>& header,
                          const std::map<std::string, std::string>& proxies,
-                         const std::map<std::string, ProxyAuthentication>& proxyAuthentications) = 0;
+                         const std::map<std::string, ProxyAuthentication>& proxyAuthentications) {
+        if (defaultGetAsyncCaller() == this) {
+            throw std::logic_error("The HttpSessionAdapter must override either `get` or `getAsync`.");
+        }
+        return getFuture(url, header, proxies, proxyAuthentications, std::make_shared<CancellationToken>()).get();
+    }
+
+    // Starts the request and invokes `callback` exactly once with the response, on any thread (even on the calling one
+    // before returning). The arguments are only valid during the call, implementations must copy what they need later.
+    // When `cancellationToken` gets cancelled, the request should be completed with `ResponseErrorCode::RequestCancelled`.
+    // Override this to drive the fetches from a non-blocking HTTP stack (e.g. an existing event loop).
+    // The default implementation performs the blocking `get` on the calling thread.
+    virtual void getAsync(const std::string& url,
+                          const std::map<std::string, std::string>& header,
+                          const std::map<std::string, std::string>& proxies,
+                          const std::map<std::string, ProxyAuthentication>& proxyAuthentications,
+                          const std::shared_ptr<CancellationToken>& cancellationToken,
+                          const ResponseCallback& callback) {
+        if (cancellationToken && cancellationToken->isCancelled()) {
+            Response response;
+            response.errorCode = ResponseErrorCode::RequestCancelled;
+            response.error = "Request was cancelled.";
+            callback(response);
+            return;
+        }
+
+        const auto previousCaller = defaultGetAsyncCaller();
+        defaultGetAsyncCaller() = this;
+        Response response;
+        try {
+            response = get(url, header, proxies, proxyAuthentications);
+        } catch (...) {
+            defaultGetAsyncCaller() = previousCaller;
+            throw;
+        }
+        defaultGetAsyncCaller() = previousCaller;
+        callback(std::move(response));
+    }
+
+    // Same as `getAsync`, but the body of a successful (2xx) response may be passed to `onBodyChunk` piece by piece as it
+    // arrives, so it can be processed while it's being downloaded. When the body is streamed this way, it must be streamed
+    // completely before `callback` is invoked, and `Response::text` is left empty.
+    // The default implementation doesn't stream, it falls back to `getAsync`.
+    virtual void getStreamingAsync(const std::string& url,
+                                   const std::map<std::string, std::string>& header,
+                                   const std::map<std::string, std::string>& proxies,
+                                   const std::map<std::string, ProxyAuthentication>& proxyAuthentications,
+                                   const std::shared_ptr<CancellationToken>& cancellationToken,
+                                   const BodyChunkCallback&,
+                                   const ResponseCallback& callback) {
+        getAsync(url, header, proxies, proxyAuthentications, cancellationToken, callback);
+    }
+
+    // Starts the request and returns the future of its response.
+    std::future<Response> getFuture(const std::string& url,
+                                    const std::map<std::string, std::string>& header,
+                                    const std::map<std::string, std::string>& proxies,
+                                    const std::map<std::string, ProxyAuthentication>& proxyAuthentications,
+                                    const std::shared_ptr<CancellationToken>& cancellationToken) {
+        auto promise = std::make_shared<std::promise<Response>>();
+        auto future = promise->get_future();
+        getAsync(url, header, proxies, proxyAuthentications, cancellationToken, [promise](Response response) {
+            promise->set_value(std::move(response));
+        });
+        return future;
+    }
+
     virtual void close() = 0;
     virtual ~HttpSessionAdapter() = default;
+
+private:
+    // The adapter whose default `getAsync` is calling `get` on the current thread. When it reaches the default `get`,
+    // neither of them is overridden and they would call each other endlessly.
+    static const HttpSessionAdapter*& defaultGetAsyncCaller() {
+        static thread_local const HttpSessionAdapter* caller = nullptr;
+        return caller;
+    }
 };
 
 } // namespace configcat
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "config.h"
+
+namespace configcat {
+
+// The estimated memory held by a client for its config, in bytes (see `ConfigCatClient::memoryStats`).
+struct MemoryStats {
+    // The parsed config in use.
+    ConfigMemoryUsage config;
+    // The config.json of the config in use, kept for writing it to the cache.
+    size_t configJsonString = 0;
+    // The last content read from the cache, kept for detecting when it changes.
+    size_t cachedEntryString = 0;
+
+    // The configs replaced by a newer one which are still referenced, e.g. by evaluations in progress
+    // or by `onConfigChanged` hook subscribers holding onto them.
+    size_t retiredSnapshots = 0;
+    ConfigMemoryUsage retiredSnapshotsMemory;
+
+    inline size_t totalBytes() const {
+        return config.total() + configJsonString + cachedEntryString + retiredSnapshotsMemory.total();
+    }
+
+    // Renders a human-readable breakdown.
+    std::string toString() const;
+};
+
+} // namespace configcat
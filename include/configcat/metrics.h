@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace configcat {
+
+// Distribution of the observed durations (in seconds), following the Prometheus histogram model.
+struct HistogramSnapshot {
+    // The upper bounds of the buckets in ascending order, the last bucket (+Inf) is implicit.
+    std::vector<double> upperBounds;
+    // The number of observations per bucket (not cumulative), it has one more item than `upperBounds` for the +Inf bucket.
+    std::vector<uint64_t> bucketCounts;
+    uint64_t count = 0;
+    double sum = 0;
+};
+
+// A point-in-time copy of the metrics collected by a ConfigCatClient (see `ConfigCatOptions::collectMetrics`).
+struct MetricsSnapshot {
+    // The number of evaluations per setting key and variation ID (the variation ID is empty when the value has none).
+    std::map<std::string, std::map<std::string, uint64_t>> evaluations;
+    // The number of errors per log event ID (e.g. 1001 for evaluating a missing setting).
+    std::map<int, uint64_t> errors;
+    HistogramSnapshot evaluationLatency;
+
+    uint64_t fetchesModified = 0;    // 200 OK, a new config was downloaded
+    uint64_t fetchesNotModified = 0; // 304 Not Modified
+    uint64_t fetchesFailed = 0;
+    HistogramSnapshot fetchLatency;
+
+    // The age of the config in use based on its fetch time, NaN when there's no config yet.
+    double configAgeSeconds = std::numeric_limits<double>::quiet_NaN();
+    HistogramSnapshot cacheReadLatency;
+    HistogramSnapshot cacheWriteLatency;
+
+    inline uint64_t fetches() const { return fetchesModified + fetchesNotModified + fetchesFailed; }
+
+    // Renders the metrics in the Prometheus text exposition format (version 0.0.4), with metric names prefixed by `prefix`.
+    std::string toPrometheusText(const std::string& prefix = "configcat") const;
+};
+
+} // namespace configcat
@@ -26,8 +26,13 @@ public:
      * Creates a configured lazy loading polling configuration.
      *
      * [cacheRefreshIntervalInSeconds] sets how long the cache will store its value before fetching the latest from the network again.
+     * [staleWhileRevalidate] when enabled, an expired config is still served immediately while a single refresh runs in the background.
+     * [maxStalenessInSeconds] sets how long (beyond the cache refresh interval) an expired config can be served with [staleWhileRevalidate],
+     * a config older than that is refreshed synchronously. 0 means no limit.
      */
-    static std::shared_ptr<PollingMode> lazyLoad(uint32_t cacheRefreshIntervalInSeconds = 60);
+    static std::shared_ptr<PollingMode> lazyLoad(uint32_t cacheRefreshIntervalInSeconds = 60,
+                                                 bool staleWhileRevalidate = false,
+                                                 uint32_t maxStalenessInSeconds = 0);
 
     // Creates a configured manual polling configuration.
     static std::shared_ptr<PollingMode> manualPoll();
@@ -65,11 +70,15 @@ public:
     static constexpr char kIdentifier[] = "l";
 
     const uint32_t cacheRefreshIntervalInSeconds;
+    const bool staleWhileRevalidate;
+    const uint32_t maxStalenessInSeconds;
     const char* getPollingIdentifier() const override { return kIdentifier; }
 
 private:
-    LazyLoadingMode(uint32_t cacheRefreshIntervalInSeconds):
-    cacheRefreshIntervalInSeconds(cacheRefreshIntervalInSeconds) {
+    LazyLoadingMode(uint32_t cacheRefreshIntervalInSeconds, bool staleWhileRevalidate, uint32_t maxStalenessInSeconds):
+    cacheRefreshIntervalInSeconds(cacheRefreshIntervalInSeconds),
+    staleWhileRevalidate(staleWhileRevalidate),
+    maxStalenessInSeconds(maxStalenessInSeconds) {
     }
 };
 
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace configcat {
+
+// A timed internal operation of the SDK (e.g. a config fetch or a cache read), see `ConfigCatOptions::spanExporter`.
+struct Span {
+    // The operations: "configcat.fetch_if_older", "configcat.http_fetch", "configcat.parse", "configcat.cache_read",
+    // "configcat.cache_write", "configcat.snapshot_swap" and "configcat.evaluate".
+    std::string name;
+
+    // The spans of an operation (e.g. the HTTP fetch and the parse triggered by a refresh) share the trace ID,
+    // and the nested ones refer to the enclosing span by `parentSpanId` (which is 0 for the root span).
+    uint64_t traceIdHigh = 0;
+    uint64_t traceIdLow = 0;
+    uint64_t spanId = 0;
+    uint64_t parentSpanId = 0;
+
+    std::chrono::system_clock::time_point startTime;
+    std::chrono::nanoseconds duration{0};
+    // A small number identifying the thread which started the span (not the OS thread ID).
+    uint32_t threadId = 0;
+
+    std::map<std::string, std::string> attributes;
+};
+
+// Receives the completed spans. Implementations must be thread-safe, the spans are exported on the threads which
+// complete them (including the evaluating threads, when the evaluations are sampled).
+class SpanExporter {
+public:
+    virtual void exportSpan(const Span& span) = 0;
+    virtual void flush() {}
+    virtual ~SpanExporter() = default;
+};
+
+// Writes the spans into a file, in batches of `batchSize` spans. Call `flush` (or destroy the exporter) to write out
+// the spans of the last, incomplete batch.
+class FileSpanExporter : public SpanExporter {
+public:
+    enum class Format {
+        // Chrome trace event format (JSON array of complete events), viewable in chrome://tracing or https://ui.perfetto.dev.
+        // The closing bracket is written on destruction, but the viewers load the file without it too.
+        chromeTrace,
+        // OTLP/JSON, one `ExportTraceServiceRequest` object per line (as written by the file exporter of the
+        // OpenTelemetry Collector), so the file can be replayed to any OTLP-compatible backend.
+        otlpJson
+    };
+
+    explicit FileSpanExporter(const std::string& path, Format format = Format::chromeTrace, size_t batchSize = 256);
+    ~FileSpanExporter() override;
+
+    void exportSpan(const Span& span) override;
+    void flush() override;
+
+private:
+    void writeBatch();
+
+    const Format format;
+    const size_t batchSize;
+    std::mutex exporterMutex;
+    std::ofstream file;
+    std::vector<Span> batch;
+    bool firstEvent = true;
+};
+
+} // namespace configcat
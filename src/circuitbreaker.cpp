@@ -0,0 +1,79 @@
+#include "circuitbreaker.h"
+#include "configcat/configcatoptions.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace std;
+
+namespace configcat {
+
+CircuitBreaker::CircuitBreaker(const FetchRetryOptions& options)
+    : jitter(clamp(options.jitter, 0.0, 1.0))
+    , initialBackoffMs(options.initialBackoffMs)
+    , maxBackoffMs(max(options.maxBackoffMs, options.initialBackoffMs))
+    , threshold(options.circuitBreakerThreshold)
+    , openMs(options.circuitBreakerOpenMs) {
+}
+
+bool CircuitBreaker::allowRequest(Clock::time_point now, bool ignoreBackoff) {
+    switch (state) {
+        case State::open:
+            if (now < retryTime) {
+                return false;
+            }
+            // Only one fetch runs at a time, so the fetch started now is the single probe.
+            state = State::halfOpen;
+            return true;
+        case State::halfOpen:
+            return true;
+        default:
+            return ignoreBackoff || now >= retryTime;
+    }
+}
+
+bool CircuitBreaker::recordSuccess() {
+    const bool recovered = state != State::closed;
+    state = State::closed;
+    consecutiveFailures = 0;
+    retryTime = Clock::time_point();
+    return recovered;
+}
+
+bool CircuitBreaker::recordFailure(Clock::time_point now) {
+    ++consecutiveFailures;
+
+    // A failed probe reopens the breaker right away.
+    if (threshold > 0 && (state == State::halfOpen || consecutiveFailures >= threshold)) {
+        const bool opened = state != State::open;
+        state = State::open;
+        retryTime = now + applyJitter(chrono::milliseconds(openMs));
+        return opened;
+    }
+
+    if (initialBackoffMs > 0) {
+        // initialBackoffMs * 2^(failures - 1), the shift is limited to not overflow.
+        const uint64_t backoffMs = min<uint64_t>(uint64_t(initialBackoffMs) << min<uint32_t>(consecutiveFailures - 1, 32), maxBackoffMs);
+        retryTime = now + applyJitter(chrono::milliseconds(backoffMs));
+    }
+    return false;
+}
+
+chrono::milliseconds CircuitBreaker::retryDelay(Clock::time_point now) const {
+    if (now >= retryTime) {
+        return chrono::milliseconds(0);
+    }
+    return chrono::ceil<chrono::milliseconds>(retryTime - now);
+}
+
+chrono::milliseconds CircuitBreaker::applyJitter(chrono::milliseconds delay) const {
+    if (jitter <= 0.0 || delay.count() == 0) {
+        return delay;
+    }
+
+    thread_local mt19937 generator(random_device{}());
+    uniform_real_distribution<double> distribution(1.0 - jitter, 1.0 + jitter);
+    return chrono::milliseconds(static_cast<int64_t>(delay.count() * distribution(generator)));
+}
+
+} // namespace configcat
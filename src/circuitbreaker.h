@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace configcat {
+
+struct FetchRetryOptions;
+
+// Tracks the consecutive transient fetch failures to space out the retries (exponential backoff with jitter), and to stop
+// hitting the network for a while when the failures keep coming (circuit breaker). When the open period of the breaker
+// elapses, it goes half-open and lets a single probe fetch through, which either closes or reopens it.
+// Not thread-safe, it's guarded by the fetch mutex of `ConfigService`.
+class CircuitBreaker {
+public:
+    enum class State { closed, open, halfOpen };
+    using Clock = std::chrono::steady_clock;
+
+    explicit CircuitBreaker(const FetchRetryOptions& options);
+
+    // Whether a fetch can be started at `now`. An open breaker turns half-open when its open period has elapsed.
+    // With `ignoreBackoff` (explicit refreshes) only an open breaker prevents the fetch.
+    bool allowRequest(Clock::time_point now, bool ignoreBackoff = false);
+
+    // Returns true when the breaker gets closed by the success.
+    bool recordSuccess();
+
+    // Returns true when the breaker gets opened by the failure.
+    bool recordFailure(Clock::time_point now);
+
+    // The time left until the next fetch is allowed (zero when it's allowed right away).
+    std::chrono::milliseconds retryDelay(Clock::time_point now) const;
+
+    // Randomizes the delay by the configured jitter.
+    std::chrono::milliseconds applyJitter(std::chrono::milliseconds delay) const;
+
+    State getState() const { return state; }
+    uint32_t getConsecutiveFailures() const { return consecutiveFailures; }
+
+private:
+    const double jitter;
+    const uint32_t initialBackoffMs;
+    const uint32_t maxBackoffMs;
+    const uint32_t threshold;
+    const uint32_t openMs;
+
+    State state = State::closed;
+    uint32_t consecutiveFailures = 0;
+    Clock::time_point retryTime; // no fetch before this, except for explicit refreshes when the breaker is closed
+};
+
+} // namespace configcat
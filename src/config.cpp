@@ -1,17 +1,26 @@
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <mutex>
+#include <unordered_set>
 #include <nlohmann/json.hpp>
 
 #include "configcat/config.h"
+#include "memoryusage.h"
+#include "parsearena.h"
 #include "utils.h"
 
 using namespace std;
-using json = nlohmann::json;
+
+// The DOM of the config.json is allocated from the parse arena when there's one (see DomAllocationScope).
+using json = nlohmann::basic_json<std::map, std::vector, std::string, bool, std::int64_t, std::uint64_t, double, configcat::ArenaAllocator>;
 
 namespace nlohmann {
     // nlohmann::json std::optional serialization
     template <typename T>
     struct adl_serializer<optional<T>> {
-        static void to_json(json& j, const optional<T>& opt) {
+        template <typename BasicJsonType>
+        static void to_json(BasicJsonType& j, const optional<T>& opt) {
             if (opt) {
                 j = *opt;
             } else {
@@ -19,11 +28,12 @@ namespace nlohmann {
             }
         }
 
-        static void from_json(const json& j, optional<T>& opt) {
+        template <typename BasicJsonType>
+        static void from_json(const BasicJsonType& j, optional<T>& opt) {
             if (j.is_null()) {
                 opt = nullopt;
             } else {
-                opt = optional{ j.get<T>() };
+                opt = optional{ j.template get<T>() };
             }
         }
     };
@@ -54,6 +64,249 @@ string Value::toString() const {
     }, *this);
 }
 
+#pragma region Lazy setting decoding
+
+// Shared by the lazily decoded settings of a config.
+struct LazyConfigSource {
+    // Shared with the config entry the config was parsed for.
+    shared_ptr<const string> jsonString;
+    // Guards the decoded settings, so they can be inspected (see `Config::memoryUsage`) while others are decoded.
+    mutex decodeMutex;
+    // The DOMs of the settings are allocated from parse arenas (see `ConfigCatOptions::configArena`).
+    bool configArena = false;
+};
+
+struct LazySetting {
+    shared_ptr<LazyConfigSource> source;
+    // The range of the setting's JSON object within the source JSON.
+    size_t begin = 0;
+    size_t end = 0;
+
+    once_flag decodeFlag;
+    unique_ptr<Setting> decoded;
+};
+
+namespace {
+
+// Minimal JSON scanner which locates the members of JSON objects without decoding their values.
+// The values are validated while they are skipped, but their content is checked only when they are decoded.
+class JsonScanner {
+public:
+    explicit JsonScanner(const string& text, size_t pos = 0) : text(text), pos(pos) {}
+
+    // Calls `onMember(key, valueBegin, valueEnd)` for each member of the object starting at the current position.
+    template<typename Callback>
+    void scanObject(Callback&& onMember) {
+        expect('{');
+        if (peek() == '}') {
+            ++pos;
+            return;
+        }
+
+        for (;;) {
+            const auto key = readKey();
+            expect(':');
+            const auto valueBegin = skipWhitespace();
+            skipValue();
+            onMember(key, valueBegin, pos);
+
+            const auto c = next();
+            if (c == '}') return;
+            if (c != ',') fail();
+        }
+    }
+
+    // Calls `onElement(valueBegin, valueEnd)` for each element of the array starting at the current position.
+    template<typename Callback>
+    void scanArray(Callback&& onElement) {
+        expect('[');
+        if (peek() == ']') {
+            ++pos;
+            return;
+        }
+
+        for (;;) {
+            const auto valueBegin = skipWhitespace();
+            skipValue();
+            onElement(valueBegin, pos);
+
+            const auto c = next();
+            if (c == ']') return;
+            if (c != ',') fail();
+        }
+    }
+
+    // Fails if there's anything but whitespace after the current position.
+    void expectEnd() {
+        if (skipWhitespace() != text.size()) fail();
+    }
+
+private:
+    size_t skipWhitespace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n')) ++pos;
+        return pos;
+    }
+
+    char peek() {
+        if (skipWhitespace() >= text.size()) fail();
+        return text[pos];
+    }
+
+    char next() {
+        const auto c = peek();
+        ++pos;
+        return c;
+    }
+
+    void expect(char c) {
+        if (next() != c) fail();
+    }
+
+    string readKey() {
+        const auto begin = skipWhitespace();
+        if (!skipString()) {
+            return text.substr(begin + 1, pos - begin - 2);
+        }
+        return json::parse(text.data() + begin, text.data() + pos).get<string>();
+    }
+
+    // Returns true if the string contains escape sequences.
+    bool skipString() {
+        if (peek() != '"') fail();
+
+        auto hasEscapes = false;
+        for (++pos; pos < text.size(); ++pos) {
+            const auto c = text[pos];
+            if (c == '"') {
+                ++pos;
+                return hasEscapes;
+            } else if (c == '\\') {
+                hasEscapes = true;
+                if (++pos >= text.size()) break;
+                if (text[pos] == 'u') {
+                    for (auto i = 0; i < 4; ++i) {
+                        if (++pos >= text.size() || !isxdigit(static_cast<unsigned char>(text[pos]))) fail();
+                    }
+                } else if (!strchr("\"\\/bfnrt", text[pos])) {
+                    fail();
+                }
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                fail();
+            }
+        }
+        fail();
+    }
+
+    // Skips a value, validating it completely, so a malformed config.json is rejected when it's loaded instead of
+    // when one of its settings is decoded. The nesting is tracked on a stack of its own instead of by recursion.
+    void skipValue() {
+        string containers;
+        for (;;) {
+            const auto c = peek();
+            if (c == '{' || c == '[') {
+                ++pos;
+                const auto close = c == '{' ? '}' : ']';
+                if (peek() != close) {
+                    containers.push_back(close);
+                    if (c == '{') skipMemberKey();
+                    continue;
+                }
+                ++pos;
+            } else if (c == '"') {
+                skipString();
+            } else {
+                skipScalar();
+            }
+
+            // The value is complete, the enclosing containers are continued or closed.
+            for (;;) {
+                if (containers.empty()) return;
+                const auto next = this->next();
+                if (next == ',') {
+                    if (containers.back() == '}') skipMemberKey();
+                    break;
+                }
+                if (next != containers.back()) fail();
+                containers.pop_back();
+            }
+        }
+    }
+
+    void skipMemberKey() {
+        skipString();
+        expect(':');
+    }
+
+    // A number or a literal.
+    void skipScalar() {
+        for (const auto literal : { "true", "false", "null" }) {
+            const auto length = strlen(literal);
+            if (text.compare(pos, length, literal) == 0) {
+                pos += length;
+                return;
+            }
+        }
+
+        if (pos < text.size() && text[pos] == '-') ++pos;
+        if (pos < text.size() && text[pos] == '0') {
+            ++pos;
+        } else if (!skipDigits()) {
+            fail();
+        }
+        if (pos < text.size() && text[pos] == '.') {
+            ++pos;
+            if (!skipDigits()) fail();
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            ++pos;
+            if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) ++pos;
+            if (!skipDigits()) fail();
+        }
+    }
+
+    // Returns true if there was any digit.
+    bool skipDigits() {
+        const auto begin = pos;
+        while (pos < text.size() && isdigit(static_cast<unsigned char>(text[pos]))) ++pos;
+        return pos > begin;
+    }
+
+    [[noreturn]] void fail() const {
+        throw runtime_error(string_format("Config JSON is invalid (unexpected character or end of input at position %zu).", pos));
+    }
+
+    const string& text;
+    size_t pos;
+};
+
+} // namespace
+
+#pragma endregion
+
+#pragma region Parse arena
+
+namespace {
+
+// Scope in which the temporary DOM of a parse is allocated from a parse arena (see `ConfigCatOptions::configArena`).
+// When the option is off, the DOM is allocated from the global heap. The parsed config is allocated from the global
+// heap either way, as it outlives the parse.
+class DomAllocationScope {
+public:
+    DomAllocationScope(bool configArena, size_t jsonSize) {
+        if (configArena) {
+            // The DOM takes up a few times the size of the JSON text.
+            arena.emplace(jsonSize * 4);
+        }
+    }
+
+private:
+    optional<ParseArena> arena;
+};
+
+} // namespace
+
+#pragma endregion
+
 // Config serialization
 
 #pragma region SettingValue
@@ -63,6 +316,14 @@ struct SettingValuePrivate {
         value = nullopt;
         value.unsupportedValue = shared_ptr<SettingValue::UnsupportedValue>(new SettingValue::UnsupportedValue{ j.type_name(), j.dump() });
     }
+
+    static bool isUnsupportedValueEqual(const SettingValue& value1, const SettingValue& value2) {
+        const auto& unsupported1 = value1.unsupportedValue;
+        const auto& unsupported2 = value2.unsupportedValue;
+        return unsupported1 && unsupported2
+            ? unsupported1->type == unsupported2->type && unsupported1->value == unsupported2->value
+            : !unsupported1 && !unsupported2;
+    }
 };
 
 void to_json(json& j, const SettingValue& value) {
@@ -306,7 +567,8 @@ void from_json(const json& j, Segment& segment) {
 
 #pragma region Setting
 
-void to_json(json& j, const Setting& setting) {
+void to_json(json& j, const Setting& lazyOrDecodedSetting) {
+    const auto& setting = lazyOrDecodedSetting.getDecoded();
     j[Setting::kType] = setting.type;
     if (setting.percentageOptionsAttribute) j[Setting::kPercentageOptionsAttribute] = setting.percentageOptionsAttribute;
     if (!setting.targetingRules.empty()) j[Setting::kTargetingRules] = setting.targetingRules;
@@ -322,6 +584,28 @@ void from_json(const json& j, Setting& setting) {
     from_json(j, static_cast<SettingValueContainer&>(setting));
 }
 
+const Setting& Setting::getDecoded() const {
+    if (!lazySetting) {
+        return *this;
+    }
+
+    auto& lazy = *lazySetting;
+    call_once(lazy.decodeFlag, [&] {
+        auto& source = *lazy.source;
+        auto decoded = make_unique<Setting>();
+        {
+            DomAllocationScope scope(source.configArena, lazy.end - lazy.begin);
+            json::parse(source.jsonString->data() + lazy.begin, source.jsonString->data() + lazy.end).get_to(*decoded);
+        }
+        decoded->configJsonSalt = configJsonSalt;
+        decoded->segments = segments;
+
+        lock_guard<mutex> lock(source.decodeMutex);
+        lazy.decoded = std::move(decoded);
+    });
+    return *lazy.decoded;
+}
+
 Setting Setting::fromValue(const SettingValue& value) {
     Setting setting;
     setting.type = value.getSettingType();
@@ -372,16 +656,45 @@ void to_json(json& j, const Config& config) {
 void from_json(const json& j, Config& config) {
     if (auto it = j.find(Config::kPreferences); it != j.end()) it->get_to(config.preferences);
     if (auto it = j.find(Config::kSegments); it != j.end()) it->get_to(*(config.segments = make_shared<Segments>()));
-    if (auto it = j.find(Config::kSettings); it != j.end()) it->get_to(*(config.settings = make_shared<Settings>()));
+    if (auto it = j.find(Config::kSettings); it != j.end()) {
+        config.settings = make_shared<Settings>();
+        config.settings->reserve(it->size());
+        it->get_to(*config.settings);
+    }
 }
 
 const shared_ptr<const Config> Config::empty = make_shared<Config>();
 
+shared_ptr<Settings> Config::getDecodedSettingsOrEmpty() const {
+    // The settings of a config are either all lazy or all decoded.
+    if (!settings || settings->empty() || !settings->begin()->second.lazySetting) {
+        return getSettingsOrEmpty();
+    }
+
+    auto decodedSettings = make_shared<Settings>();
+    decodedSettings->reserve(settings->size());
+    for (const auto& [key, setting] : *settings) {
+        try {
+            decodedSettings->emplace(key, setting.getDecoded());
+        } catch (...) {
+            // An invalid setting is kept as it is, its evaluation reports the error.
+            decodedSettings->emplace(key, setting);
+        }
+    }
+    return decodedSettings;
+}
+
 string Config::toJson() {
     return json(*this).dump();
 }
 
-shared_ptr<Config> Config::fromJson(const string& jsonString, bool tolerant) {
+shared_ptr<Config> Config::fromJson(const string& jsonString, bool tolerant, bool lazySettingDecoding, bool configArena) {
+    // The scanner used for lazy decoding doesn't support comments, so we fall back to eager decoding in tolerant mode.
+    if (lazySettingDecoding && !tolerant) {
+        return fromJsonLazy(make_shared<const string>(jsonString), configArena);
+    }
+
+    DomAllocationScope scope(configArena, jsonString.size());
     json configObj = json::parse(jsonString, nullptr, true, tolerant); // tolerant = ignore comment
     auto config = make_shared<Config>();
     configObj.get_to(*config);
@@ -419,6 +732,94 @@ shared_ptr<Config> Config::fromFile(const string& filePath, bool tolerant) {
     return config;
 }
 
+shared_ptr<Config> Config::fromJson(const shared_ptr<const string>& jsonString, bool lazySettingDecoding, bool configArena) {
+    return lazySettingDecoding ? fromJsonLazy(jsonString, configArena) : fromJson(*jsonString, false, false, configArena);
+}
+
+shared_ptr<Config> Config::fromJsonLazy(const shared_ptr<const string>& jsonString, bool configArena) {
+    auto source = make_shared<LazyConfigSource>();
+    source->jsonString = jsonString;
+    source->configArena = configArena;
+    const auto& text = *source->jsonString;
+
+    auto config = make_shared<Config>();
+    JsonScanner scanner(text);
+    scanner.scanObject([&](const string& key, size_t begin, size_t end) {
+        if (key == Config::kPreferences) {
+            DomAllocationScope scope(configArena, end - begin);
+            json::parse(text.data() + begin, text.data() + end).get_to(config->preferences);
+        } else if (key == Config::kSegments) {
+            DomAllocationScope scope(configArena, end - begin);
+            json::parse(text.data() + begin, text.data() + end).get_to(*(config->segments = make_shared<Segments>()));
+        } else if (key == Config::kSettings) {
+            auto& settings = *(config->settings = make_shared<Settings>());
+            JsonScanner(text, begin).scanObject([&](const string& key, size_t begin, size_t end) {
+                Setting setting;
+                JsonScanner(text, begin).scanObject([&](const string& key, size_t begin, size_t end) {
+                    if (key == Setting::kType) {
+                        setting.type = static_cast<SettingType>(stoi(text.substr(begin, end - begin)));
+                    }
+                });
+
+                auto lazySetting = make_shared<LazySetting>();
+                lazySetting->source = source;
+                lazySetting->begin = begin;
+                lazySetting->end = end;
+                setting.lazySetting = lazySetting;
+
+                settings[key] = std::move(setting);
+            });
+        }
+    });
+    scanner.expectEnd();
+
+    config->fixupSaltAndSegments();
+    return config;
+}
+
+namespace {
+
+string decodeKey(string_view keyJson) {
+    // Most keys have no escape sequences, those are taken as they are.
+    if (keyJson.size() >= 2 && keyJson.find('\\') == string_view::npos) {
+        return string(keyJson.substr(1, keyJson.size() - 2));
+    }
+    return json::parse(keyJson.begin(), keyJson.end()).get<string>();
+}
+
+} // namespace
+
+void Config::decodeMember(string_view keyJson, string_view valueJson, bool configArena) {
+    const auto key = decodeKey(keyJson);
+    if (key != kPreferences && key != kSegments && key != kSettings) {
+        return;
+    }
+
+    DomAllocationScope scope(configArena, valueJson.size());
+    const auto value = json::parse(valueJson.begin(), valueJson.end());
+    if (key == kPreferences) {
+        value.get_to(preferences);
+    } else if (key == kSegments) {
+        value.get_to(*(segments = make_shared<Segments>()));
+    } else {
+        value.get_to(*(settings = make_shared<Settings>()));
+    }
+}
+
+void Config::decodeSetting(string_view keyJson, string_view valueJson, bool configArena) {
+    if (!settings) {
+        settings = make_shared<Settings>();
+    }
+
+    auto key = decodeKey(keyJson);
+    Setting setting;
+    {
+        DomAllocationScope scope(configArena, valueJson.size());
+        json::parse(valueJson.begin(), valueJson.end()).get_to(setting);
+    }
+    (*settings)[std::move(key)] = std::move(setting);
+}
+
 void Config::fixupSaltAndSegments() {
     if (settings && !settings->empty()) {
         auto configJsonSalt = preferences ? preferences->salt : nullptr;
@@ -432,4 +833,434 @@ void Config::fixupSaltAndSegments() {
 
 #pragma endregion
 
+#pragma region ConfigDiff
+
+namespace {
+
+// Structural comparison of the config model (cheaper than comparing the serialized forms).
+bool equals(const SettingValue& value1, const SettingValue& value2);
+bool equals(const SettingValueContainer& container1, const SettingValueContainer& container2);
+bool equals(const PercentageOption& option1, const PercentageOption& option2);
+bool equals(const UserCondition& condition1, const UserCondition& condition2);
+bool equals(const PrerequisiteFlagCondition& condition1, const PrerequisiteFlagCondition& condition2);
+bool equals(const SegmentCondition& condition1, const SegmentCondition& condition2);
+bool equals(const ConditionContainer& container1, const ConditionContainer& container2);
+bool equals(const TargetingRule& rule1, const TargetingRule& rule2);
+bool equals(const Segment& segment1, const Segment& segment2);
+
+template<typename T>
+bool equals(const T& value1, const T& value2) {
+    return value1 == value2;
+}
+
+template<typename T>
+bool equals(const vector<T>& values1, const vector<T>& values2) {
+    return values1.size() == values2.size()
+        && equal(values1.begin(), values1.end(), values2.begin(), [](const T& value1, const T& value2) { return equals(value1, value2); });
+}
+
+template<typename... Types>
+bool equals(const one_of<Types...>& variant1, const one_of<Types...>& variant2) {
+    return variant1.index() == variant2.index() && visit([&variant2](const auto& alt1) {
+        using T = decay_t<decltype(alt1)>;
+        if constexpr (is_same_v<T, nullopt_t>) {
+            return true;
+        } else {
+            return equals(alt1, get<T>(variant2));
+        }
+    }, variant1);
+}
+
+bool equals(const SettingValue& value1, const SettingValue& value2) {
+    using Base = one_of<bool, string, int32_t, double>;
+    return equals(static_cast<const Base&>(value1), static_cast<const Base&>(value2))
+        && SettingValuePrivate::isUnsupportedValueEqual(value1, value2);
+}
+
+bool equals(const SettingValueContainer& container1, const SettingValueContainer& container2) {
+    return equals(container1.value, container2.value) && container1.variationId == container2.variationId;
+}
+
+bool equals(const PercentageOption& option1, const PercentageOption& option2) {
+    return option1.percentage == option2.percentage
+        && equals(static_cast<const SettingValueContainer&>(option1), static_cast<const SettingValueContainer&>(option2));
+}
+
+bool equals(const UserCondition& condition1, const UserCondition& condition2) {
+    return condition1.comparisonAttribute == condition2.comparisonAttribute
+        && condition1.comparator == condition2.comparator
+        && equals(condition1.comparisonValue, condition2.comparisonValue);
+}
+
+bool equals(const PrerequisiteFlagCondition& condition1, const PrerequisiteFlagCondition& condition2) {
+    return condition1.prerequisiteFlagKey == condition2.prerequisiteFlagKey
+        && condition1.comparator == condition2.comparator
+        && equals(condition1.comparisonValue, condition2.comparisonValue);
+}
+
+bool equals(const SegmentCondition& condition1, const SegmentCondition& condition2) {
+    return condition1.segmentIndex == condition2.segmentIndex && condition1.comparator == condition2.comparator;
+}
+
+bool equals(const ConditionContainer& container1, const ConditionContainer& container2) {
+    return equals(container1.condition, container2.condition);
+}
+
+bool equals(const TargetingRule& rule1, const TargetingRule& rule2) {
+    return equals(rule1.conditions, rule2.conditions) && equals(rule1.then, rule2.then);
+}
+
+bool equals(const Segment& segment1, const Segment& segment2) {
+    return segment1.name == segment2.name && equals(segment1.conditions, segment2.conditions);
+}
+
+bool settingEquals(const Setting& setting1, const Setting& setting2, const LazySetting* lazySetting1, const LazySetting* lazySetting2) {
+    if (setting1.type != setting2.type) {
+        return false;
+    }
+
+    // Comparing the raw JSON of lazily decoded settings spares decoding them.
+    if (lazySetting1 && lazySetting2) {
+        const auto& text1 = *lazySetting1->source->jsonString;
+        const auto& text2 = *lazySetting2->source->jsonString;
+        return text1.compare(lazySetting1->begin, lazySetting1->end - lazySetting1->begin,
+                             text2, lazySetting2->begin, lazySetting2->end - lazySetting2->begin) == 0;
+    }
+
+    const auto& decoded1 = setting1.getDecoded();
+    const auto& decoded2 = setting2.getDecoded();
+    return equals(static_cast<const SettingValueContainer&>(decoded1), static_cast<const SettingValueContainer&>(decoded2))
+        && decoded1.percentageOptionsAttribute == decoded2.percentageOptionsAttribute
+        && equals(decoded1.targetingRules, decoded2.targetingRules)
+        && equals(decoded1.percentageOptions, decoded2.percentageOptions);
+}
+
+// The segments and the prerequisite flags referenced by the conditions of a setting's targeting rules.
+struct SettingReferences {
+    vector<int32_t> segmentIndexes;
+    vector<string> prerequisiteFlagKeys;
+};
+
+// Lazily decoded settings are scanned in their raw JSON, so that the settings which didn't change are not decoded.
+// Returns nullopt when the raw JSON is invalid.
+optional<SettingReferences> getReferences(const Setting& setting, const LazySetting* lazySetting) {
+    SettingReferences references;
+    if (lazySetting) {
+        const auto& text = *lazySetting->source->jsonString;
+        try {
+            JsonScanner(text, lazySetting->begin).scanObject([&](const string& key, size_t begin, size_t) {
+                if (key != Setting::kTargetingRules) return;
+                JsonScanner(text, begin).scanArray([&](size_t begin, size_t) {
+                    JsonScanner(text, begin).scanObject([&](const string& key, size_t begin, size_t) {
+                        if (key != TargetingRule::kConditions) return;
+                        JsonScanner(text, begin).scanArray([&](size_t begin, size_t) {
+                            JsonScanner(text, begin).scanObject([&](const string& key, size_t begin, size_t) {
+                                if (key == ConditionContainer::kSegmentCondition) {
+                                    JsonScanner(text, begin).scanObject([&](const string& key, size_t begin, size_t end) {
+                                        if (key == SegmentCondition::kSegmentIndex) {
+                                            references.segmentIndexes.push_back(stoi(text.substr(begin, end - begin)));
+                                        }
+                                    });
+                                } else if (key == ConditionContainer::kPrerequisiteFlagCondition) {
+                                    JsonScanner(text, begin).scanObject([&](const string& key, size_t begin, size_t end) {
+                                        if (key == PrerequisiteFlagCondition::kPrerequisiteFlagKey) {
+                                            references.prerequisiteFlagKeys.push_back(json::parse(text.data() + begin, text.data() + end).get<string>());
+                                        }
+                                    });
+                                }
+                            });
+                        });
+                    });
+                });
+            });
+        } catch (...) {
+            return nullopt;
+        }
+        return references;
+    }
+
+    for (const auto& targetingRule : setting.targetingRules) {
+        for (const auto& conditionContainer : targetingRule.conditions) {
+            const auto& condition = conditionContainer.condition;
+            if (const auto segmentConditionPtr = get_if<SegmentCondition>(&condition)) {
+                references.segmentIndexes.push_back(segmentConditionPtr->segmentIndex);
+            } else if (const auto prerequisiteFlagConditionPtr = get_if<PrerequisiteFlagCondition>(&condition)) {
+                references.prerequisiteFlagKeys.push_back(prerequisiteFlagConditionPtr->prerequisiteFlagKey);
+            }
+        }
+    }
+    return references;
+}
+
+} // namespace
+
+ConfigDiff ConfigDiff::compute(const Config& oldConfig, const Config& newConfig) {
+    ConfigDiff diff;
+
+    const auto oldSettings = oldConfig.getSettingsOrEmpty();
+    const auto newSettings = newConfig.getSettingsOrEmpty();
+    const auto oldSegments = oldConfig.getSegmentsOrEmpty();
+    const auto newSegments = newConfig.getSegmentsOrEmpty();
+
+    // Segments are referenced by their index, so we compare them position by position.
+    vector<bool> isSegmentChanged(max(oldSegments->size(), newSegments->size()), false);
+    for (size_t i = 0; i < isSegmentChanged.size(); ++i) {
+        if (i >= oldSegments->size() || i >= newSegments->size()) {
+            isSegmentChanged[i] = true;
+            diff.changedSegments.push_back(i < newSegments->size() ? (*newSegments)[i].name : (*oldSegments)[i].name);
+        } else if (!equals((*oldSegments)[i], (*newSegments)[i])) {
+            isSegmentChanged[i] = true;
+            diff.changedSegments.push_back((*newSegments)[i].name);
+        }
+    }
+
+    // Sensitive comparison values are hashed with the config salt, so a salt change affects all settings.
+    const auto oldSalt = oldConfig.preferences && oldConfig.preferences->salt ? *oldConfig.preferences->salt : string();
+    const auto newSalt = newConfig.preferences && newConfig.preferences->salt ? *newConfig.preferences->salt : string();
+    const auto isSaltChanged = oldSalt != newSalt;
+
+    unordered_set<string> changedKeys;
+    vector<const pair<const string, Setting>*> unchangedSettings;
+
+    for (const auto& [key, _] : *oldSettings) {
+        if (newSettings->find(key) == newSettings->end()) {
+            diff.removedKeys.push_back(key);
+            changedKeys.insert(key);
+        }
+    }
+
+    for (const auto& entry : *newSettings) {
+        const auto& [key, newSetting] = entry;
+        const auto it = oldSettings->find(key);
+        if (it == oldSettings->end()) {
+            diff.addedKeys.push_back(key);
+            changedKeys.insert(key);
+        } else if (isSaltChanged || !settingEquals(it->second, newSetting, it->second.lazySetting.get(), newSetting.lazySetting.get())) {
+            diff.modifiedKeys.push_back(key);
+            changedKeys.insert(key);
+        } else {
+            unchangedSettings.push_back(&entry);
+        }
+    }
+
+    // Settings whose definition didn't change may still be affected by changed segments or prerequisite flags.
+    if (!changedKeys.empty() || !diff.changedSegments.empty()) {
+        vector<pair<const string*, SettingReferences>> candidates;
+        for (const auto entry : unchangedSettings) {
+            const auto& [key, setting] = *entry;
+            auto references = getReferences(setting, setting.lazySetting.get());
+            if (!references) {
+                // We can't tell what the setting references, so let's report it rather than miss a change.
+                diff.modifiedKeys.push_back(key);
+                changedKeys.insert(key);
+            } else if (!references->segmentIndexes.empty() || !references->prerequisiteFlagKeys.empty()) {
+                candidates.emplace_back(&key, std::move(*references));
+            }
+        }
+
+        auto found = true;
+        while (found) {
+            found = false;
+            for (auto& [key, references] : candidates) {
+                if (!key) continue;
+
+                const auto isAffected = any_of(references.segmentIndexes.begin(), references.segmentIndexes.end(), [&](int32_t index) {
+                        return index >= 0 && static_cast<size_t>(index) < isSegmentChanged.size() && isSegmentChanged[index];
+                    })
+                    || any_of(references.prerequisiteFlagKeys.begin(), references.prerequisiteFlagKeys.end(), [&](const string& flagKey) {
+                        return changedKeys.count(flagKey) > 0;
+                    });
+
+                if (isAffected) {
+                    diff.modifiedKeys.push_back(*key);
+                    changedKeys.insert(*key);
+                    key = nullptr;
+                    found = true;
+                }
+            }
+        }
+    }
+
+    sort(diff.addedKeys.begin(), diff.addedKeys.end());
+    sort(diff.removedKeys.begin(), diff.removedKeys.end());
+    sort(diff.modifiedKeys.begin(), diff.modifiedKeys.end());
+
+    return diff;
+}
+
+bool ConfigDiff::contains(const std::string& key) const {
+    return find(addedKeys.begin(), addedKeys.end(), key) != addedKeys.end()
+        || find(removedKeys.begin(), removedKeys.end(), key) != removedKeys.end()
+        || find(modifiedKeys.begin(), modifiedKeys.end(), key) != modifiedKeys.end();
+}
+
+#pragma endregion
+
+#pragma region ConfigMemoryUsage
+
+ConfigMemoryUsage& ConfigMemoryUsage::operator+=(const ConfigMemoryUsage& other) {
+    settings += other.settings;
+    segments += other.segments;
+    strings += other.strings;
+    comparisonLists += other.comparisonLists;
+    indexes += other.indexes;
+    lazySource += other.lazySource;
+    return *this;
+}
+
+namespace {
+
+// Walks the objects of a config. The shared objects (segments, the salt and the lazy source) are referenced from many
+// places, they are counted only on the first visit.
+class MemoryUsageCounter {
+public:
+    explicit MemoryUsageCounter(ConfigMemoryUsage& usage) : usage(usage) {}
+
+    void addString(const string& s) {
+        usage.strings += stringHeapBytes(s);
+    }
+
+    void addSalt(const shared_ptr<string>& salt) {
+        if (salt && visited.insert(salt.get()).second) {
+            usage.strings += kSharedControlBlockBytes + sizeof(string) + stringHeapBytes(*salt);
+        }
+    }
+
+    void addSegments(const shared_ptr<Segments>& segments) {
+        if (!segments || !visited.insert(segments.get()).second) {
+            return;
+        }
+
+        usage.segments += kSharedControlBlockBytes + sizeof(Segments) + segments->capacity() * sizeof(Segment);
+        for (const auto& segment : *segments) {
+            addString(segment.name);
+            usage.segments += segment.conditions.capacity() * sizeof(UserCondition);
+            for (const auto& condition : segment.conditions) {
+                addUserCondition(condition);
+            }
+        }
+    }
+
+    void addLazySetting(const LazySetting& lazySetting) {
+        usage.settings += kSharedControlBlockBytes + sizeof(LazySetting);
+
+        auto& source = *lazySetting.source;
+        // The decoded setting is published under the lock.
+        lock_guard<mutex> lock(source.decodeMutex);
+        if (visited.insert(&source).second) {
+            usage.lazySource += kSharedControlBlockBytes + sizeof(LazyConfigSource);
+            // The text is counted by the config entry holding it too (the estimate tolerates a concurrent release).
+            if (source.jsonString.use_count() == 1) {
+                usage.lazySource += stringHeapBytes(*source.jsonString);
+            }
+        }
+        if (lazySetting.decoded) {
+            usage.settings += sizeof(Setting);
+            addSettingBody(*lazySetting.decoded);
+        }
+    }
+
+    // Counts the heap memory held by the setting, but not the setting object itself.
+    void addSettingBody(const Setting& setting) {
+        addValueContainer(setting);
+        if (setting.percentageOptionsAttribute) {
+            addString(*setting.percentageOptionsAttribute);
+        }
+
+        usage.settings += setting.targetingRules.capacity() * sizeof(TargetingRule);
+        for (const auto& targetingRule : setting.targetingRules) {
+            usage.settings += targetingRule.conditions.capacity() * sizeof(ConditionContainer);
+            for (const auto& conditionContainer : targetingRule.conditions) {
+                if (const auto userCondition = get_if<UserCondition>(&conditionContainer.condition)) {
+                    addUserCondition(*userCondition);
+                } else if (const auto prerequisiteFlagCondition = get_if<PrerequisiteFlagCondition>(&conditionContainer.condition)) {
+                    addString(prerequisiteFlagCondition->prerequisiteFlagKey);
+                    addValue(prerequisiteFlagCondition->comparisonValue);
+                }
+            }
+
+            if (const auto simpleValue = get_if<SettingValueContainer>(&targetingRule.then)) {
+                addValueContainer(*simpleValue);
+            } else if (const auto percentageOptions = get_if<PercentageOptions>(&targetingRule.then)) {
+                addPercentageOptions(*percentageOptions);
+            }
+        }
+
+        addPercentageOptions(setting.percentageOptions);
+    }
+
+private:
+    void addValue(const SettingValue& value) {
+        if (const auto text = get_if<string>(&value)) {
+            addString(*text);
+        }
+    }
+
+    void addValueContainer(const SettingValueContainer& container) {
+        addValue(container.value);
+        if (container.variationId) {
+            addString(*container.variationId);
+        }
+    }
+
+    void addPercentageOptions(const PercentageOptions& percentageOptions) {
+        usage.settings += percentageOptions.capacity() * sizeof(PercentageOption);
+        for (const auto& percentageOption : percentageOptions) {
+            addValueContainer(percentageOption);
+        }
+    }
+
+    void addUserCondition(const UserCondition& condition) {
+        addString(condition.comparisonAttribute);
+        if (const auto text = get_if<string>(&condition.comparisonValue)) {
+            addString(*text);
+        } else if (const auto list = get_if<vector<string>>(&condition.comparisonValue)) {
+            usage.comparisonLists += list->capacity() * sizeof(string);
+            for (const auto& item : *list) {
+                addString(item);
+            }
+        }
+    }
+
+    ConfigMemoryUsage& usage;
+    unordered_set<const void*> visited;
+};
+
+} // namespace
+
+ConfigMemoryUsage Config::memoryUsage() const {
+    ConfigMemoryUsage usage;
+    MemoryUsageCounter counter(usage);
+
+    usage.settings += kSharedControlBlockBytes + sizeof(Config);
+    if (preferences) {
+        if (preferences->baseUrl) {
+            counter.addString(*preferences->baseUrl);
+        }
+        counter.addSalt(preferences->salt);
+    }
+    counter.addSegments(segments);
+
+    if (settings) {
+        usage.settings += kSharedControlBlockBytes + sizeof(Settings) + settings->size() * sizeof(Settings::value_type);
+        usage.indexes += hashTableIndexBytes(*settings);
+        for (const auto& [key, setting] : *settings) {
+            counter.addString(key);
+            // The settings of a config share these, but a config may be accounted through its settings only
+            // (e.g. when just the settings of a replaced config are still in use).
+            counter.addSalt(setting.configJsonSalt);
+            counter.addSegments(setting.segments);
+            if (setting.lazySetting) {
+                counter.addLazySetting(*setting.lazySetting);
+            } else {
+                counter.addSettingBody(setting);
+            }
+        }
+    }
+
+    return usage;
+}
+
+#pragma endregion
+
 } // namespace configcat
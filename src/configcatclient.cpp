@@ -7,9 +7,12 @@
 #include "configcat/log.h"
 #include "rolloutevaluator.h"
 #include "configservice.h"
+#include "pollscheduler.h"
 #include "configcat/flagoverrides.h"
 #include "configcat/overridedatasource.h"
 #include "configcatlogger.h"
+#include "metricsregistry.h"
+#include "tracer.h"
 #include "configcat/consolelogger.h"
 
 using namespace std;
@@ -105,14 +108,27 @@ size_t ConfigCatClient::instanceCount() {
     return instances.size();
 }
 
+void ConfigCatClient::setPollingWorkerCount(size_t workerCount) {
+    PollScheduler::setWorkerCount(workerCount);
+}
+
 ConfigCatClient::ConfigCatClient(const std::string& sdkKey, const ConfigCatOptions& options) {
     hooks = options.hooks ? options.hooks : make_shared<Hooks>();
+    if (options.collectMetrics) {
+        metricsRegistry = make_shared<MetricsRegistry>();
+    }
     logger = make_shared<ConfigCatLogger>(
-        options.logger ? options.logger : make_shared<ConsoleLogger>(), hooks
+        options.logger ? options.logger : make_shared<ConsoleLogger>(), hooks, metricsRegistry
     );
 
     defaultUser = options.defaultUser;
-    rolloutEvaluator = make_unique<RolloutEvaluator>(logger);
+    if (options.spanExporter) {
+        tracer = make_shared<Tracer>(options.spanExporter, options.traceEvaluationSampleRate);
+    }
+    if (options.profileEvaluations) {
+        evaluationProfiler = make_shared<EvaluationProfiler>();
+    }
+    rolloutEvaluator = make_unique<RolloutEvaluator>(logger, evaluationProfiler);
     if (options.flagOverrides) {
         overrideDataSource = options.flagOverrides->createDataSource(logger);
     }
@@ -120,7 +136,7 @@ ConfigCatClient::ConfigCatClient(const std::string& sdkKey, const ConfigCatOptio
     auto configCache = options.configCache ? options.configCache : make_shared<NullConfigCache>();
 
     if (!overrideDataSource || overrideDataSource->getBehaviour() != LocalOnly) {
-        configService = make_unique<ConfigService>(sdkKey, logger, hooks, configCache, options);
+        configService = make_unique<ConfigService>(sdkKey, logger, hooks, configCache, options, metricsRegistry, tracer);
     }
 }
 
@@ -137,6 +153,8 @@ SettingResult ConfigCatClient::getSettings() const {
                 auto settingResult = configService ? configService->getSettings() : SettingResult{nullptr, kDistantPast};
                 auto remote = settingResult.settings;
                 auto local = overrideDataSource->getOverrides();
+                // The copies of lazily decoded remote settings share their decoding with the originals, and the merged
+                // settings are only read through the evaluation (which decodes them), so they're not decoded here.
                 auto result = make_shared<Settings>();
                 if (remote) {
                     for (auto& it : *remote) {
@@ -221,6 +239,20 @@ EvaluationDetails<std::optional<Value>> ConfigCatClient::getValueDetails(const s
     return _getValueDetails<optional<Value>>(key, nullopt, user);
 }
 
+template<typename ValueType>
+static ValueType toValueType(std::optional<Value>&& returnValue) {
+    if constexpr (is_same_v<ValueType, bool> || is_same_v<ValueType, string> || is_same_v<ValueType, int32_t> || is_same_v<ValueType, double>) {
+        // RolloutEvaluator::evaluate makes sure that this variant access is always valid.
+        return std::get<ValueType>(std::move(*returnValue));
+    } else if constexpr (is_same_v<ValueType, Value>) {
+        return std::move(*returnValue);
+    } else if constexpr (is_same_v<ValueType, optional<Value>>) {
+        return std::move(returnValue);
+    } else {
+        static_assert(always_false_v<ValueType>, "Unsupported value type.");
+    }
+}
+
 template<typename ValueType>
 EvaluationDetails<ValueType> ConfigCatClient::_getValueDetails(const std::string& key, const ValueType& defaultValue, const std::shared_ptr<ConfigCatUser>& user) const {
     try {
@@ -313,7 +345,8 @@ std::optional<KeyValue> ConfigCatClient::getKeyAndValue(const std::string& varia
             return nullopt;
         }
 
-        for (const auto& [key, setting] : *settings) {
+        for (const auto& [key, lazyOrDecodedSetting] : *settings) {
+            const auto& setting = lazyOrDecodedSetting.getDecoded();
             const auto settingType = setting.getTypeChecked();
 
             if (setting.variationId == variationId) {
@@ -446,8 +479,17 @@ ValueType ConfigCatClient::_getValue(const std::string& key, const ValueType& de
         }
 
         const auto& effectiveUser = user ? user : defaultUser;
-        auto details = evaluate<ValueType>(key, defaultValue, effectiveUser, setting->second, settings, fetchTime);
 
+        // The evaluation details (which copy the matched targeting rule or percentage option) are only built
+        // when there's somebody to receive them.
+        if (!hooks->hasOnFlagEvaluated()) {
+            EvaluateContext evaluateContext(key, setting->second, effectiveUser, settings);
+            std::optional<Value> returnValue;
+            evaluateSetting(defaultValue, evaluateContext, returnValue);
+            return toValueType<ValueType>(std::move(returnValue));
+        }
+
+        auto details = evaluate<ValueType>(key, defaultValue, effectiveUser, setting->second, settings, fetchTime);
         return std::move(details.value);
     }
     catch (...) {
@@ -474,22 +516,10 @@ EvaluationDetails<ValueType> ConfigCatClient::evaluate(const std::string& key,
                                                        double fetchTime) const {
     EvaluateContext evaluateContext(key, setting, effectiveUser, settings);
     std::optional<Value> returnValue;
-    auto evaluateResult = rolloutEvaluator->evaluate(defaultValue, evaluateContext, returnValue);
-
-    ValueType value;
-    if constexpr (is_same_v<ValueType, bool> || is_same_v<ValueType, string> || is_same_v<ValueType, int32_t> || is_same_v<ValueType, double>) {
-        // RolloutEvaluator::evaluate makes sure that this variant access is always valid.
-        value = std::get<ValueType>(*returnValue);
-    } else if constexpr (is_same_v<ValueType, Value>) {
-        value = *returnValue;
-    } else if constexpr (is_same_v<ValueType, optional<Value>>) {
-        value = returnValue;
-    } else {
-        static_assert(always_false_v<ValueType>, "Unsupported value type.");
-    }
+    auto evaluateResult = evaluateSetting(defaultValue, evaluateContext, returnValue);
 
     EvaluationDetails<ValueType> details(key,
-                                 value,
+                                 toValueType<ValueType>(std::move(returnValue)),
                                  evaluateResult.selectedValue.variationId,
                                  time_point<system_clock, duration<double>>(duration<double>(fetchTime)),
                                  effectiveUser,
@@ -502,6 +532,31 @@ EvaluationDetails<ValueType> ConfigCatClient::evaluate(const std::string& key,
     return details;
 }
 
+EvaluateResult ConfigCatClient::evaluateSetting(const std::optional<Value>& defaultValue, EvaluateContext& context, std::optional<Value>& returnValue) const {
+    if (tracer && tracer->sampleEvaluation()) {
+        auto span = tracer->startSpan("configcat.evaluate");
+        span.setAttribute("key", context.key);
+        auto evaluateResult = evaluateSettingWithMetrics(defaultValue, context, returnValue);
+        if (const auto& variationId = evaluateResult.selectedValue.variationId) {
+            span.setAttribute("variation_id", *variationId);
+        }
+        return evaluateResult;
+    }
+
+    return evaluateSettingWithMetrics(defaultValue, context, returnValue);
+}
+
+EvaluateResult ConfigCatClient::evaluateSettingWithMetrics(const std::optional<Value>& defaultValue, EvaluateContext& context, std::optional<Value>& returnValue) const {
+    if (!metricsRegistry) {
+        return rolloutEvaluator->evaluate(defaultValue, context, returnValue);
+    }
+
+    const auto start = steady_clock::now();
+    auto evaluateResult = rolloutEvaluator->evaluate(defaultValue, context, returnValue);
+    metricsRegistry->recordEvaluation(context.key, evaluateResult.selectedValue.variationId, steady_clock::now() - start);
+    return evaluateResult;
+}
+
 RefreshResult ConfigCatClient::forceRefresh() {
     try {
         return configService
@@ -515,6 +570,29 @@ RefreshResult ConfigCatClient::forceRefresh() {
     }
 }
 
+void ConfigCatClient::forceRefreshAsync(const std::function<void(RefreshResult)>& callback) {
+    // An exception thrown by the callback itself must not lead to invoking it again.
+    auto invoked = make_shared<atomic<bool>>(false);
+    try {
+        if (configService) {
+            configService->refreshAsync([callback, invoked](RefreshResult result) {
+                *invoked = true;
+                callback(std::move(result));
+            });
+        } else {
+            *invoked = true;
+            callback(RefreshResult{"Client is configured to use the LocalOnly override behavior or has been closed, which prevents making HTTP requests."});
+        }
+    } catch (...) {
+        auto ex = std::current_exception();
+        LogEntry logEntry(logger, LOG_LEVEL_ERROR, 1003, ex);
+        logEntry << "Error occurred in the `forceRefreshAsync` method.";
+        if (!*invoked) {
+            callback(RefreshResult{logEntry.getMessage(), ex});
+        }
+    }
+}
+
 void ConfigCatClient::setOnline() {
     if (configService) {
         configService->setOnline();
@@ -536,5 +614,51 @@ bool ConfigCatClient::isOffline() const {
     return true;
 }
 
+bool ConfigCatClient::waitForReady(std::chrono::milliseconds timeout) const {
+    return readyFuture().wait_for(timeout) == future_status::ready;
+}
+
+shared_future<void> ConfigCatClient::readyFuture() const {
+    if (configService) {
+        return configService->getReadyFuture();
+    }
+
+    // Without a config service (LocalOnly override behavior or closed client) the client is always ready.
+    promise<void> readyPromise;
+    readyPromise.set_value();
+    return readyPromise.get_future().share();
+}
+
+MetricsSnapshot ConfigCatClient::metrics() const {
+    if (!metricsRegistry) {
+        return {};
+    }
+
+    auto snapshot = metricsRegistry->snapshot();
+    if (configService) {
+        const auto fetchTime = configService->getConfigFetchTime();
+        if (fetchTime != kDistantPast) {
+            snapshot.configAgeSeconds = get_utcnowseconds_since_epoch() - fetchTime;
+        }
+    }
+    return snapshot;
+}
+
+EvaluationProfile ConfigCatClient::evaluationProfile() const {
+    return evaluationProfiler ? evaluationProfiler->profile() : EvaluationProfile();
+}
+
+MemoryStats ConfigCatClient::memoryStats() const {
+    return configService ? configService->getMemoryStats() : MemoryStats();
+}
+
+void ConfigCatClient::onReady(const std::function<void()>& callback) {
+    if (configService) {
+        configService->onReady(callback);
+    } else {
+        callback();
+    }
+}
+
 } // namespace configcat
 
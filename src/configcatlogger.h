@@ -6,20 +6,28 @@
 #include "configcat/configcatoptions.h"
 #include "configcat/configcatuser.h"
 #include "configcat/config.h"
+#include "metricsregistry.h"
 #include "utils.h"
 
 namespace configcat {
 
 class ConfigCatLogger {
 public:
-    ConfigCatLogger(const std::shared_ptr<ILogger>& logger, const std::shared_ptr<Hooks>& hooks):
+    ConfigCatLogger(const std::shared_ptr<ILogger>& logger, const std::shared_ptr<Hooks>& hooks,
+                    const std::shared_ptr<MetricsRegistry>& metrics = nullptr):
         logger(logger),
-        hooks(hooks) {
+        hooks(hooks),
+        metrics(metrics) {
     }
 
     void log(LogLevel level, int eventId, const std::string& message, const std::exception_ptr& exception = nullptr) {
-        if (hooks && level == LOG_LEVEL_ERROR) {
-            hooks->invokeOnError(message, exception);
+        if (level == LOG_LEVEL_ERROR) {
+            if (hooks) {
+                hooks->invokeOnError(message, exception);
+            }
+            if (metrics) {
+                metrics->recordError(eventId);
+            }
         }
 
         if (isEnabled(level)) {
@@ -32,6 +40,7 @@ public:
 private:
     std::shared_ptr<ILogger> logger;
     std::shared_ptr<Hooks> hooks;
+    std::shared_ptr<MetricsRegistry> metrics;
 };
 
 class LogEntry {
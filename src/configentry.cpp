@@ -11,7 +11,8 @@ namespace configcat {
 
 const shared_ptr<const ConfigEntry> ConfigEntry::empty = make_shared<ConfigEntry>(Config::empty, "empty");
 
-shared_ptr<const ConfigEntry> ConfigEntry::fromString(const string& text) {
+shared_ptr<const ConfigEntry> ConfigEntry::fromString(const string& text, bool lazySettingDecoding, const shared_ptr<const ConfigEntry>& previousEntry,
+                                                     bool configArena) {
     if (text.empty())
         return ConfigEntry::empty;
 
@@ -31,16 +32,20 @@ shared_ptr<const ConfigEntry> ConfigEntry::fromString(const string& text) {
 
     auto eTag = text.substr(fetchTimeIndex + 1, eTagIndex - fetchTimeIndex - 1);
 
-    auto configJsonString = text.substr(eTagIndex + 1);
+    auto configJson = make_shared<const string>(text.substr(eTagIndex + 1));
+    if (previousEntry && previousEntry != ConfigEntry::empty && previousEntry->configJsonString() == *configJson) {
+        return make_shared<ConfigEntry>(previousEntry->config, eTag, previousEntry->configJson, fetchTime / 1000.0);
+    }
+
     try {
-        return make_shared<ConfigEntry>(Config::fromJson(configJsonString), eTag, configJsonString, fetchTime / 1000.0);
+        return make_shared<ConfigEntry>(Config::fromJson(configJson, lazySettingDecoding, configArena), eTag, configJson, fetchTime / 1000.0);
     } catch (...) {
-        throw invalid_argument("Invalid config JSON: " + configJsonString + ". " + unwrap_exception_message(current_exception()));
+        throw invalid_argument("Invalid config JSON: " + *configJson + ". " + unwrap_exception_message(current_exception()));
     }
 }
 
 string ConfigEntry::serialize() const {
-    return to_string(static_cast<uint64_t>(floor(fetchTime * 1000))) + "\n" + eTag + "\n" + configJsonString;
+    return to_string(static_cast<uint64_t>(floor(fetchTime * 1000))) + "\n" + eTag + "\n" + *configJson;
 }
 
 } // namespace configcat
@@ -25,18 +25,33 @@ struct ConfigEntry {
                 double fetchTime = kDistantPast):
             config(config),
             eTag(eTag),
-            configJsonString(configJsonString),
+            configJson(std::make_shared<const std::string>(configJsonString)),
+            fetchTime(fetchTime) {
+    }
+    ConfigEntry(const std::shared_ptr<const Config>& config,
+                const std::string& eTag,
+                const std::shared_ptr<const std::string>& configJson,
+                double fetchTime):
+            config(config),
+            eTag(eTag),
+            configJson(configJson),
             fetchTime(fetchTime) {
     }
     ConfigEntry(const ConfigEntry&) = delete; // Disable copy
 
-    static std::shared_ptr<const ConfigEntry> fromString(const std::string& text);
+    // When the config json is identical to the one of `previousEntry`, its parsed config is reused.
+    static std::shared_ptr<const ConfigEntry> fromString(const std::string& text, bool lazySettingDecoding = false,
+                                                         const std::shared_ptr<const ConfigEntry>& previousEntry = nullptr,
+                                                         bool configArena = false);
     std::string serialize() const;
 
     std::shared_ptr<const Config> config;
     std::string eTag;
-    std::string configJsonString;
+    // Shared with the lazily decoded settings of the config (if any), so the text is held only once.
+    std::shared_ptr<const std::string> configJson;
     double fetchTime;
+
+    inline const std::string& configJsonString() const { return *configJson; }
 };
 
 } // namespace configcat
@@ -1,11 +1,15 @@
 #include <assert.h>
+#include <mutex>
 
 #include "configfetcher.h"
 #include "configcat/log.h"
 #include "configcat/configcatoptions.h"
 #include "configcat/timeutils.h"
 #include "configcatlogger.h"
+#include "pollscheduler.h"
 #include "curlnetworkadapter.h"
+#include "tracer.h"
+#include "streamingconfigparser.h"
 #include "version.h"
 #include "platform.h"
 
@@ -13,7 +17,103 @@ using namespace std;
 
 namespace configcat {
 
-ConfigFetcher::ConfigFetcher(const string& sdkKey, const shared_ptr<ConfigCatLogger>& logger, const string& mode, const ConfigCatOptions& options):
+struct ConfigFetcher::HedgeState : enable_shared_from_this<HedgeState> {
+    static constexpr size_t kPrimary = 0;
+    static constexpr size_t kHedge = 1;
+
+    // The requests don't depend on the fetcher, as the losing one may outlive the fetch.
+    shared_ptr<HttpSessionAdapter> adapters[2];
+    string urls[2];
+    map<string, string> requestHeader;
+    map<string, string> proxies;
+    map<string, ProxyAuthentication> proxyAuthentications;
+    shared_ptr<CancellationToken> cancellationTokens[2] = { make_shared<CancellationToken>(), make_shared<CancellationToken>() };
+
+    mutex stateMutex;
+    bool started[2] = { false, false };
+    optional<Response> responses[2];
+    optional<size_t> winner;
+    bool finished = false;
+    // Invoked once, with the winning response (or with the primary failure).
+    ResponseCallback onFinished;
+    // Invoked when both requests are completed.
+    function<void()> onIdle;
+    // Starts the hedged request after the hedge delay, it's cancelled when the fetch finishes or it's cancelled earlier.
+    shared_ptr<PollScheduler> scheduler;
+    shared_ptr<PollScheduler::Timer> hedgeTimer;
+
+    static bool isValid(const Response& response) {
+        return response.errorCode == ResponseErrorCode::OK
+            && ((response.statusCode >= 200 && response.statusCode <= 204) || response.statusCode == 304);
+    }
+
+    // The request has to be marked started before.
+    void startRequest(size_t index) {
+        auto self = shared_from_this();
+        adapters[index]->getAsync(urls[index], requestHeader, proxies, proxyAuthentications, cancellationTokens[index],
+            [self, index](Response response) {
+                self->complete(index, std::move(response));
+            });
+    }
+
+    void complete(size_t index, Response response) {
+        const bool valid = isValid(response);
+        ResponseCallback finishedCallback;
+        optional<Response> result;
+        function<void()> idleCallback;
+        shared_ptr<PollScheduler::Timer> timer;
+        {
+            lock_guard<mutex> lock(stateMutex);
+            responses[index] = std::move(response);
+            if (valid && !winner) {
+                winner = index;
+            }
+            if (!finished && (winner || (responses[kPrimary] && (!started[kHedge] || responses[kHedge])))) {
+                finished = true;
+                finishedCallback.swap(onFinished);
+                result = responses[winner.value_or(kPrimary)];
+                timer.swap(hedgeTimer);
+            }
+            if (isIdle()) {
+                idleCallback.swap(onIdle);
+            }
+        }
+        // The hedged request is not needed anymore when the fetch finished before the hedge delay elapsed.
+        if (timer) {
+            scheduler->cancel(timer);
+        }
+        // The first valid response wins, the other request is not needed anymore.
+        if (valid) {
+            cancellationTokens[1 - index]->cancel();
+        }
+        if (finishedCallback) {
+            finishedCallback(std::move(*result));
+        }
+        if (idleCallback) {
+            idleCallback();
+        }
+    }
+
+    void cancel() {
+        shared_ptr<PollScheduler::Timer> timer;
+        {
+            lock_guard<mutex> lock(stateMutex);
+            timer.swap(hedgeTimer);
+        }
+        if (timer) {
+            scheduler->cancel(timer);
+        }
+        cancellationTokens[kPrimary]->cancel();
+        cancellationTokens[kHedge]->cancel();
+    }
+
+    bool isIdle() const {
+        return (!started[kPrimary] || responses[kPrimary]) && (!started[kHedge] || responses[kHedge]);
+    }
+};
+
+ConfigFetcher::ConfigFetcher(const string& sdkKey, const shared_ptr<ConfigCatLogger>& logger, const string& mode, const ConfigCatOptions& options,
+                             const shared_ptr<Tracer>& tracer):
     sdkKey(sdkKey),
     logger(logger),
     mode(mode),
@@ -21,7 +121,12 @@ ConfigFetcher::ConfigFetcher(const string& sdkKey, const shared_ptr<ConfigCatLog
     readTimeoutMs(options.readTimeoutMs),
     proxies(options.proxies),
     proxyAuthentications(options.proxyAuthentications),
-    httpSessionAdapter(options.httpSessionAdapter) {
+    httpSessionAdapter(options.httpSessionAdapter),
+    cancellationToken(make_shared<CancellationToken>()),
+    lazySettingDecoding(options.lazySettingDecoding),
+    streamingParse(options.streamingParse && !options.lazySettingDecoding),
+    configArena(options.configArena),
+    tracer(tracer) {
     urlIsCustom = !options.baseUrl.empty();
     url = urlIsCustom
         ? options.baseUrl
@@ -30,9 +135,29 @@ ConfigFetcher::ConfigFetcher(const string& sdkKey, const shared_ptr<ConfigCatLog
             : kEuOnlyBaseUrl;
     userAgent = string("ConfigCat-Cpp/") + mode + "-" + CONFIGCAT_VERSION;
 
+    hedgeDelayMs = options.hedgeDelayMs;
+    hedgeBaseUrl = !options.hedgeBaseUrl.empty() || urlIsCustom || options.dataGovernance != DataGovernance::Global
+        ? options.hedgeBaseUrl
+        : kEuOnlyBaseUrl;
+    if (hedgeDelayMs > 0 && !hedgeBaseUrl.empty()) {
+        hedgeSessionAdapter = httpSessionAdapter;
+        hedgeScheduler = PollScheduler::getInstance();
+    }
+
 #ifndef CONFIGCAT_EXTERNAL_NETWORK_ADAPTER_ENABLED
     if (!httpSessionAdapter) {
-        httpSessionAdapter = make_shared<CurlNetworkAdapter>();
+        if (hedgeDelayMs > 0 && !hedgeBaseUrl.empty()) {
+            // Both requests run on the shared fetch engine, so the hedged one doesn't block the scheduler starting it.
+            if (!options.httpTransport.sharedFetchEngine) {
+                LOG_DEBUG << "Hedged fetching is enabled, the requests are performed on the shared fetch engine.";
+            }
+            auto transportOptions = options.httpTransport;
+            transportOptions.sharedFetchEngine = true;
+            httpSessionAdapter = make_shared<CurlNetworkAdapter>(transportOptions);
+            hedgeSessionAdapter = make_shared<CurlNetworkAdapter>(transportOptions);
+        } else {
+            httpSessionAdapter = make_shared<CurlNetworkAdapter>(options.httpTransport);
+        }
     }
 #endif
 
@@ -40,47 +165,81 @@ ConfigFetcher::ConfigFetcher(const string& sdkKey, const shared_ptr<ConfigCatLog
         LOG_ERROR(0) << "Cannot initialize httpSessionAdapter.";
         assert(false);
     }
+    if (hedgeSessionAdapter && hedgeSessionAdapter != httpSessionAdapter && !hedgeSessionAdapter->init(connectTimeoutMs, readTimeoutMs)) {
+        LOG_ERROR(0) << "Cannot initialize the HttpSessionAdapter of the hedged requests.";
+        hedgeSessionAdapter.reset();
+    }
 }
 
 ConfigFetcher::~ConfigFetcher() {
 }
 
 void ConfigFetcher::close() {
+    cancellationToken->cancel();
+    shared_ptr<HedgeState> hedgeState;
+    {
+        lock_guard<mutex> lock(hedgeStateMutex);
+        hedgeState = currentHedgeState;
+    }
+    if (hedgeState) {
+        hedgeState->cancel();
+    }
     if (httpSessionAdapter) {
         httpSessionAdapter->close();
     }
+    if (hedgeSessionAdapter && hedgeSessionAdapter != httpSessionAdapter) {
+        hedgeSessionAdapter->close();
+    }
+}
+
+FetchResponse ConfigFetcher::fetchConfiguration(const std::string& eTag, const std::shared_ptr<const ConfigEntry>& previousEntry) {
+    promise<FetchResponse> responsePromise;
+    auto responseFuture = responsePromise.get_future();
+    fetchConfigurationAsync(eTag, previousEntry, [&responsePromise](FetchResponse response) {
+        responsePromise.set_value(std::move(response));
+    });
+    return responseFuture.get();
 }
 
-FetchResponse ConfigFetcher::fetchConfiguration(const std::string& eTag) {
-    return executeFetch(eTag, 2);
+void ConfigFetcher::fetchConfigurationAsync(const std::string& eTag, const std::shared_ptr<const ConfigEntry>& previousEntry, const FetchCallback& callback) {
+    executeFetchAsync(eTag, previousEntry, 2, callback);
 }
 
-FetchResponse ConfigFetcher::executeFetch(const std::string& eTag, int executeCount) {
-    auto response = fetch(eTag);
+void ConfigFetcher::executeFetchAsync(const std::string& eTag, const std::shared_ptr<const ConfigEntry>& previousEntry, int executeCount, const FetchCallback& callback) {
+    fetchAsync(eTag, previousEntry, [this, eTag, previousEntry, executeCount, callback](FetchResponse response) {
+        if (shouldRedirect(response, executeCount)) {
+            executeFetchAsync(eTag, previousEntry, executeCount - 1, callback);
+        } else {
+            callback(std::move(response));
+        }
+    });
+}
+
+bool ConfigFetcher::shouldRedirect(const FetchResponse& response, int executeCount) {
     auto& preferences = response.entry && response.entry->config ? response.entry->config->preferences : nullopt;
 
     // If there wasn't a config change or there were no preferences in the config, we return the response
-    if (!response.isFetched() || !preferences) {
-        return response;
+    if (response.status != Status::fetched || !preferences) {
+        return false;
     }
 
     const auto& baseUrl = preferences->baseUrl.value_or("");
     // If the preferences url is the same as the last called one, just return the response.
     if (!baseUrl.empty() && url == baseUrl) {
-        return response;
+        return false;
     }
 
     // If the url is overridden, and the redirect parameter is not ForceRedirect,
     // the SDK should not redirect the calls, and it just has to return the response.
     if (urlIsCustom && preferences->redirectMode != RedirectMode::Force) {
-        return response;
+        return false;
     }
 
     // The next call should use the preferences url provided in the config json
     url = baseUrl;
 
     if (preferences->redirectMode == RedirectMode::No) {
-        return response;
+        return false;
     }
 
     // Try to download again with the new url
@@ -92,19 +251,40 @@ FetchResponse ConfigFetcher::executeFetch(const std::string& eTag, int executeCo
     }
 
     if (executeCount > 0) {
-        return executeFetch(eTag, executeCount - 1);
+        return true;
     }
 
     LOG_ERROR(1104) << "Redirection loop encountered while trying to fetch config JSON. Please contact us at https://configcat.com/support/";
-    return response;
+    return false;
 }
 
-FetchResponse ConfigFetcher::fetch(const std::string& eTag) {
+// Ends the span of an HTTP request with the details of its response.
+static void endHttpSpan(const shared_ptr<TraceSpan>& span, const Response& response) {
+    if (!span) {
+        return;
+    }
+    span->setAttribute("http.status_code", to_string(response.statusCode));
+    if (!response.error.empty()) {
+        span->setAttribute("error", response.error);
+    }
+    if (const auto& timing = response.timing) {
+        span->setAttribute("http.name_lookup_us", to_string(timing->nameLookup.count()));
+        span->setAttribute("http.connect_us", to_string(timing->connect.count()));
+        span->setAttribute("http.tls_handshake_us", to_string(timing->tlsHandshake.count()));
+        span->setAttribute("http.first_byte_us", to_string(timing->firstByte.count()));
+        span->setAttribute("http.downloaded_bytes", to_string(timing->downloadedBytes));
+        span->setAttribute("http.connection_reused", timing->connectionReused ? "true" : "false");
+    }
+    span->end();
+}
+
+void ConfigFetcher::fetchAsync(const std::string& eTag, const std::shared_ptr<const ConfigEntry>& previousEntry, const FetchCallback& callback) {
     if (!httpSessionAdapter) {
         auto error = "HttpSessionAdapter is not provided.";
         LOG_ERROR(0) << error;
         assert(false);
-        return FetchResponse(failure, ConfigEntry::empty, error, nullptr, true);
+        callback(FetchResponse(failure, ConfigEntry::empty, error, nullptr, true));
+        return;
     }
 
     string requestUrl(url + "/configuration-files/" + sdkKey + "/" + kConfigJsonName);
@@ -116,7 +296,113 @@ FetchResponse ConfigFetcher::fetch(const std::string& eTag) {
         requestHeader.insert({kIfNoneMatchHeaderName, eTag});
     }
 
-    auto response = httpSessionAdapter->get(requestUrl, requestHeader, proxies, proxyAuthentications);
+    // The response may arrive on another thread, where the processing continues as part of the same operation.
+    shared_ptr<TraceSpan> httpSpan;
+    const auto parentContext = Tracer::activeContext();
+    if (tracer) {
+        httpSpan = make_shared<TraceSpan>(tracer->startSpan("configcat.http_fetch"));
+        httpSpan->setAttribute("http.url", requestUrl);
+    }
+
+    if (hedgeSessionAdapter && hedgeBaseUrl != url) {
+        auto hedgeUrl = hedgeBaseUrl + "/configuration-files/" + sdkKey + "/" + kConfigJsonName;
+        hedgedGetAsync(requestUrl, hedgeUrl, requestHeader,
+            [this, previousEntry, callback, httpSpan, parentContext](Response response) {
+                endHttpSpan(httpSpan, response);
+                Tracer::ActiveScope activeScope(parentContext);
+                callback(processResponse(response, previousEntry));
+            });
+        return;
+    }
+
+    if (streamingParse) {
+        auto streamingParser = make_shared<StreamingConfigParser>(configArena);
+        httpSessionAdapter->getStreamingAsync(requestUrl, requestHeader, proxies, proxyAuthentications, cancellationToken,
+            [streamingParser](const char* data, size_t size) {
+                streamingParser->append(data, size);
+            },
+            [this, previousEntry, callback, streamingParser, httpSpan, parentContext](Response response) {
+                endHttpSpan(httpSpan, response);
+                Tracer::ActiveScope activeScope(parentContext);
+                callback(processResponse(response, previousEntry, streamingParser));
+            });
+        return;
+    }
+
+    httpSessionAdapter->getAsync(requestUrl, requestHeader, proxies, proxyAuthentications, cancellationToken,
+        [this, previousEntry, callback, httpSpan, parentContext](Response response) {
+            endHttpSpan(httpSpan, response);
+            Tracer::ActiveScope activeScope(parentContext);
+            callback(processResponse(response, previousEntry));
+        });
+}
+
+void ConfigFetcher::hedgedGetAsync(const string& primaryUrl, const string& hedgeUrl, const map<string, string>& requestHeader,
+                                   const ResponseCallback& callback) {
+    auto state = make_shared<HedgeState>();
+    state->adapters[HedgeState::kPrimary] = httpSessionAdapter;
+    state->adapters[HedgeState::kHedge] = hedgeSessionAdapter;
+    state->urls[HedgeState::kPrimary] = primaryUrl;
+    state->urls[HedgeState::kHedge] = hedgeUrl;
+    state->requestHeader = requestHeader;
+    state->proxies = proxies;
+    state->proxyAuthentications = proxyAuthentications;
+    state->onFinished = callback;
+    state->scheduler = hedgeScheduler;
+    state->started[HedgeState::kPrimary] = true;
+
+    shared_ptr<HedgeState> previousState;
+    {
+        lock_guard<mutex> lock(hedgeStateMutex);
+        previousState = currentHedgeState;
+        currentHedgeState = state;
+    }
+    // `close` cancels the current requests, which may have been registered after it.
+    if (cancellationToken->isCancelled()) {
+        state->cancel();
+    }
+
+    auto start = [state, logger = logger, hedgeDelayMs = hedgeDelayMs, hedgeBaseUrl = hedgeBaseUrl] {
+        // The timer is set first, as the primary request may be performed synchronously on this thread.
+        auto timer = state->scheduler->scheduleOnce([state, logger, hedgeDelayMs, hedgeBaseUrl] {
+            {
+                lock_guard<mutex> lock(state->stateMutex);
+                if (state->finished) {
+                    return;
+                }
+                state->started[HedgeState::kHedge] = true;
+            }
+            LOG_DEBUG << "No response within " << hedgeDelayMs << "ms, sending hedged request to " << hedgeBaseUrl << ".";
+            state->startRequest(HedgeState::kHedge);
+        }, chrono::milliseconds(hedgeDelayMs));
+        {
+            lock_guard<mutex> lock(state->stateMutex);
+            state->hedgeTimer = std::move(timer);
+        }
+        state->startRequest(HedgeState::kPrimary);
+    };
+
+    if (previousState) {
+        unique_lock<mutex> lock(previousState->stateMutex);
+        if (!previousState->isIdle()) {
+            // An adapter serves one request at a time, so the requests start when the cancelled loser of the previous fetch finishes.
+            previousState->onIdle = std::move(start);
+            return;
+        }
+    }
+    start();
+}
+
+FetchResponse ConfigFetcher::processResponse(Response& response, const std::shared_ptr<const ConfigEntry>& previousEntry,
+                                             const std::shared_ptr<StreamingConfigParser>& streamingParser) {
+    auto fetchResponse = parseResponse(response, previousEntry, streamingParser);
+    fetchResponse.statusCode = response.statusCode;
+    fetchResponse.timing = response.timing;
+    return fetchResponse;
+}
+
+FetchResponse ConfigFetcher::parseResponse(Response& response, const std::shared_ptr<const ConfigEntry>& previousEntry,
+                                           const std::shared_ptr<StreamingConfigParser>& streamingParser) {
     if (response.errorCode == ResponseErrorCode::TimedOut) {
         LogEntry logEntry = LogEntry(logger, LOG_LEVEL_ERROR, 1102);
         logEntry << "Request timed out while trying to fetch config JSON. "
@@ -154,16 +440,46 @@ FetchResponse ConfigFetcher::fetch(const std::string& eTag) {
                 it = find_caseinsensitive(response.header, kEtagHeaderName);
             }
             string eTag = it != response.header.end() ? it->second : "";
+
+            // A streamed body has been parsed during the download already.
+            shared_ptr<Config> streamedConfig;
+            exception_ptr streamedError;
+            const bool streamed = streamingParser && streamingParser->isStarted();
+            auto parseSpan = tracer ? tracer->startSpan("configcat.parse") : TraceSpan();
+            parseSpan.setAttribute("streamed", streamed ? "true" : "false");
+            if (streamed) {
+                try {
+                    streamedConfig = streamingParser->finish();
+                } catch (...) {
+                    streamedError = current_exception();
+                }
+            }
+            string& text = streamed ? streamingParser->getText() : response.text;
+
+            // The ETag may change even if the content doesn't (e.g. after a CDN cache flush). In such cases we can spare parsing
+            // by reusing the previous config (which also allows the caller to detect that nothing has changed).
+            parseSpan.setAttribute("bytes", to_string(text.size()));
+            if (previousEntry && previousEntry != ConfigEntry::empty && previousEntry->configJsonString() == text) {
+                parseSpan.setAttribute("result", "unchanged");
+                LOG_DEBUG << "Fetch was successful: config content not modified.";
+                return FetchResponse(fetched, make_shared<ConfigEntry>(previousEntry->config, eTag, previousEntry->configJson, get_utcnowseconds_since_epoch()));
+            }
+
             try {
-                auto config = Config::fromJson(response.text);
+                if (streamedError) {
+                    rethrow_exception(streamedError);
+                }
+                const auto configJson = make_shared<const string>(std::move(text));
+                auto config = streamed ? streamedConfig : Config::fromJson(configJson, lazySettingDecoding, configArena);
                 LOG_DEBUG << "Fetch was successful: new config fetched.";
-                return FetchResponse(fetched, make_shared<ConfigEntry>(config, eTag, response.text, get_utcnowseconds_since_epoch()));
+                return FetchResponse(fetched, make_shared<ConfigEntry>(config, eTag, configJson, get_utcnowseconds_since_epoch()));
             } catch (...) {
                 auto ex = current_exception();
                 LogEntry logEntry(logger, LOG_LEVEL_ERROR, 1105, ex);
                 logEntry <<
                     "Fetching config JSON was successful but the HTTP response content was invalid. "
                     "Config JSON parsing failed.";
+                parseSpan.setAttribute("error", logEntry.getMessage());
                 return FetchResponse(failure, ConfigEntry::empty, logEntry.getMessage(), ex, true);
             }
         }
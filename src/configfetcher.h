@@ -4,15 +4,20 @@
 #include <map>
 #include <memory>
 #include <atomic>
+#include <functional>
+#include <mutex>
 
 #include "configcat/proxyauthentication.h"
+#include "configcat/httpsessionadapter.h"
 #include "configentry.h"
 
 namespace configcat {
 
 struct ConfigCatOptions;
 class ConfigCatLogger;
-class HttpSessionAdapter;
+class PollScheduler;
+class StreamingConfigParser;
+class Tracer;
 
 enum Status {
     fetched,
@@ -27,6 +32,10 @@ struct FetchResponse {
     std::exception_ptr errorException;
     bool isTransientError = false;
 
+    // The details of the (last) HTTP response, when there was one.
+    long statusCode = 0;
+    std::optional<ResponseTiming> timing;
+
     FetchResponse(Status status, const std::shared_ptr<const ConfigEntry>& entry,
         const std::optional<std::string>& errorMessage = std::nullopt, const std::exception_ptr& errorException = nullptr, bool isTransientError = false)
         : status(status)
@@ -59,17 +68,38 @@ public:
     static constexpr char kIfNoneMatchHeaderName[] = "If-None-Match";
     static constexpr char kEtagHeaderName[] = "etag";
 
-    ConfigFetcher(const std::string& sdkKey, const std::shared_ptr<ConfigCatLogger>& logger, const std::string& mode, const ConfigCatOptions& options);
+    ConfigFetcher(const std::string& sdkKey, const std::shared_ptr<ConfigCatLogger>& logger, const std::string& mode, const ConfigCatOptions& options,
+                  const std::shared_ptr<Tracer>& tracer = nullptr);
     ~ConfigFetcher();
 
     void close();
 
     // Fetches the current ConfigCat configuration json.
-    FetchResponse fetchConfiguration(const std::string& eTag = "");
+    // When the downloaded config json is identical to the one of `previousEntry`, its parsed config is reused.
+    FetchResponse fetchConfiguration(const std::string& eTag = "", const std::shared_ptr<const ConfigEntry>& previousEntry = nullptr);
+
+    using FetchCallback = std::function<void(FetchResponse)>;
+
+    // Asynchronous variant of `fetchConfiguration`, the callback is invoked on the thread completing the HTTP request
+    // (which is the calling thread in case of a synchronous HttpSessionAdapter).
+    void fetchConfigurationAsync(const std::string& eTag, const std::shared_ptr<const ConfigEntry>& previousEntry, const FetchCallback& callback);
 
 private:
-    FetchResponse executeFetch(const std::string& eTag, int executeCount);
-    FetchResponse fetch(const std::string& eTag);
+    void executeFetchAsync(const std::string& eTag, const std::shared_ptr<const ConfigEntry>& previousEntry, int executeCount, const FetchCallback& callback);
+    bool shouldRedirect(const FetchResponse& response, int executeCount);
+    void fetchAsync(const std::string& eTag, const std::shared_ptr<const ConfigEntry>& previousEntry, const FetchCallback& callback);
+    // The body of a streamed response is taken from the `streamingParser` (see `ConfigCatOptions::streamingParse`).
+    // The body is moved into the config entry, so neither the response nor the parser holds it afterwards.
+    FetchResponse processResponse(Response& response, const std::shared_ptr<const ConfigEntry>& previousEntry,
+                                  const std::shared_ptr<StreamingConfigParser>& streamingParser = nullptr);
+    FetchResponse parseResponse(Response& response, const std::shared_ptr<const ConfigEntry>& previousEntry,
+                                const std::shared_ptr<StreamingConfigParser>& streamingParser);
+
+    struct HedgeState;
+    // Sends the request to `primaryUrl`, and to `hedgeUrl` as well when there's no response within the hedge delay.
+    // The callback is invoked with the first valid response (or with the primary failure), the losing request is cancelled.
+    void hedgedGetAsync(const std::string& primaryUrl, const std::string& hedgeUrl, const std::map<std::string, std::string>& requestHeader,
+                        const ResponseCallback& callback);
 
     std::string sdkKey;
     std::shared_ptr<ConfigCatLogger> logger;
@@ -79,6 +109,19 @@ private:
     std::map<std::string, std::string> proxies; // Protocol, Proxy url
     std::map<std::string, ProxyAuthentication> proxyAuthentications; // Protocol, ProxyAuthentication
     std::shared_ptr<HttpSessionAdapter> httpSessionAdapter;
+    std::shared_ptr<CancellationToken> cancellationToken;
+    // Hedged requests run concurrently with the primary ones, so they need their own adapter (unless a custom one is provided).
+    std::shared_ptr<HttpSessionAdapter> hedgeSessionAdapter;
+    uint32_t hedgeDelayMs = 0;
+    std::string hedgeBaseUrl;
+    // The hedge delay is timed by the shared scheduler, so the hedged fetches don't need threads of their own.
+    std::shared_ptr<PollScheduler> hedgeScheduler;
+    std::mutex hedgeStateMutex;
+    std::shared_ptr<HedgeState> currentHedgeState; // guarded by hedgeStateMutex
+    bool lazySettingDecoding = false;
+    bool streamingParse = false;
+    bool configArena = false;
+    std::shared_ptr<Tracer> tracer;
     bool urlIsCustom = false;
     std::string url;
     std::string userAgent;
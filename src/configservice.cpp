@@ -1,8 +1,13 @@
+#include <algorithm>
+
 #include "configservice.h"
 #include "configcat/configcatoptions.h"
 #include "configcat/timeutils.h"
 #include "configcatlogger.h"
 #include "configfetcher.h"
+#include "memoryusage.h"
+#include "metricsregistry.h"
+#include "tracer.h"
 
 using namespace std;
 using namespace std::this_thread;
@@ -13,14 +18,30 @@ ConfigService::ConfigService(const string& sdkKey,
                              const shared_ptr<ConfigCatLogger>& logger,
                              const std::shared_ptr<Hooks>& hooks,
                              const std::shared_ptr<ConfigCache>& configCache,
-                             const ConfigCatOptions& options):
+                             const ConfigCatOptions& options,
+                             const std::shared_ptr<MetricsRegistry>& metrics,
+                             const std::shared_ptr<Tracer>& tracer):
+    circuitBreaker(options.fetchRetry),
     logger(logger),
     hooks(hooks),
     pollingMode(options.pollingMode ? options.pollingMode : PollingMode::autoPoll()),
     cachedEntry(const_pointer_cast<ConfigEntry>(ConfigEntry::empty)),
-    configCache(configCache) {
+    configCache(configCache),
+    metrics(metrics),
+    tracer(tracer) {
     cacheKey = generateCacheKey(sdkKey);
-    configFetcher = make_unique<ConfigFetcher>(sdkKey, logger, pollingMode->getPollingIdentifier(), options);
+    lazySettingDecoding = options.lazySettingDecoding;
+    configArena = options.configArena;
+    waitForInitOnEvaluation = options.waitForInitOnEvaluation;
+    if (options.initialConfig) {
+        // The initial config is served until the first config is fetched or read from the cache. It's expired from the
+        // beginning, so it never prevents a fetch, and there's no point in waiting for the initialization.
+        cachedEntry = make_shared<ConfigEntry>(options.initialConfig, "", "", kDistantPast);
+        initialEntry = cachedEntry;
+        waitForInitOnEvaluation = false;
+    }
+    readyFuture = readyPromise.get_future().share();
+    configFetcher = make_unique<ConfigFetcher>(sdkKey, logger, pollingMode->getPollingIdentifier(), options, tracer);
     offline = options.offline;
     startTime = chrono::steady_clock::now();
 
@@ -32,35 +53,116 @@ ConfigService::ConfigService(const string& sdkKey,
 }
 
 ConfigService::~ConfigService() {
+    configFetcher->close();
+    stopPoll();
+
+    // The client may be closed by a notification of the service (e.g. in an onReady callback or in a hook fired by a
+    // polling tick), the notifying thread doesn't wait for the work held by itself then. It returns without touching the
+    // service afterwards (see NotificationScope).
+    int heldPollCount = 0;
+    int heldReadyNotifications = 0;
+    bool heldFetch = false;
+    for (auto scope = currentScope(); scope; scope = scope->previous) {
+        if (scope->service == this) {
+            destroyedService() = this;
+            heldPollCount = max(heldPollCount, scope->pollCount);
+            heldReadyNotifications += scope->readyNotifications;
+            heldFetch = heldFetch || scope->fetch;
+        }
+    }
+
+    // An asynchronous HttpSessionAdapter completes the ongoing request (as cancelled) after the close.
     {
-        lock_guard<mutex> lock(initMutex);
-        stopRequested = true;
+        unique_lock<mutex> lock(pollMutex);
+        pollCompleted.wait(lock, [&] { return pendingPollCount <= heldPollCount; });
     }
-    stop.notify_all();
-    configFetcher->close();
-    if (thread && thread->joinable())
-        thread->join();
+    vector<FetchCallback> callbacks;
+    shared_ptr<const ConfigEntry> entry;
+    {
+        unique_lock<mutex> lock(fetchMutex);
+        fetchCompleted.wait(lock, [&] {
+            return (!ongoingFetch || heldFetch) && pendingReadyNotifications <= heldReadyNotifications;
+        });
+        if (heldFetch) {
+            callbacks.swap(pendingFetchCallbacks);
+            entry = cachedEntry;
+        }
+    }
+
+    // The fetch of the notifying thread is not started, the callers waiting for it get the config in use.
+    for (const auto& callback : callbacks) {
+        callback(entry, "The client was closed before the fetch was started.", nullptr);
+    }
+}
+
+ConfigService::NotificationScope::NotificationScope(ConfigService* service) :
+    service(service),
+    previous(currentScope()) {
+    currentScope() = this;
+}
+
+ConfigService::NotificationScope::~NotificationScope() {
+    currentScope() = previous;
+    // Forgotten by the outermost scope of the service, as another service may be created at the same address later.
+    if (destroyedService() != service) {
+        return;
+    }
+    for (auto scope = previous; scope; scope = scope->previous) {
+        if (scope->service == service) {
+            return;
+        }
+    }
+    destroyedService() = nullptr;
+}
+
+ConfigService::NotificationScope*& ConfigService::currentScope() {
+    static thread_local NotificationScope* scope = nullptr;
+    return scope;
+}
+
+const ConfigService*& ConfigService::destroyedService() {
+    static thread_local const ConfigService* service = nullptr;
+    return service;
 }
 
 SettingResult ConfigService::getSettings() {
     auto threshold = kDistantPast;
-    auto preferCached = initialized;
+    bool preferCached = initialized;
     if (pollingMode->getPollingIdentifier() == LazyLoadingMode::kIdentifier) {
         auto& lazyPollingMode = (LazyLoadingMode&)*pollingMode;
         threshold = get_utcnowseconds_since_epoch() - lazyPollingMode.cacheRefreshIntervalInSeconds;
         preferCached = false;
+        if (lazyPollingMode.staleWhileRevalidate) {
+            if (auto staleEntry = getStaleWhileRevalidate(threshold, lazyPollingMode)) {
+                return { staleEntry->config ? staleEntry->config->getSettingsOrEmpty() : nullptr, staleEntry->fetchTime };
+            }
+        }
+        // The initial config is served while the first fetch runs in the background, like a stale config above.
+        if (auto entry = getInitialWhileRevalidate(threshold)) {
+            return { entry->config ? entry->config->getSettingsOrEmpty() : nullptr, entry->fetchTime };
+        }
     } else if (pollingMode->getPollingIdentifier() == AutoPollingMode::kIdentifier && !initialized) {
         auto& autoPollingMode = (AutoPollingMode&)*pollingMode;
         auto elapsedTime = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
         threshold = get_utcnowseconds_since_epoch() - autoPollingMode.autoPollIntervalInSeconds;
-        if (elapsedTime < autoPollingMode.maxInitWaitTimeInSeconds) {
-            unique_lock<mutex> lock(initMutex);
-            chrono::duration<double> timeout(autoPollingMode.maxInitWaitTimeInSeconds - elapsedTime);
-            init.wait_until(lock, chrono::system_clock::now() + timeout, [&]{ return initialized; });
+        if (!waitForInitOnEvaluation) {
+            // Serve the cached config (if any) without waiting for or initiating a fetch, the polling takes care of that.
+            preferCached = true;
+        } else if (elapsedTime < autoPollingMode.maxInitWaitTimeInSeconds) {
+            {
+                unique_lock<mutex> lock(initMutex);
+                chrono::duration<double> timeout(autoPollingMode.maxInitWaitTimeInSeconds - elapsedTime);
+                init.wait_until(lock, chrono::system_clock::now() + timeout, [&]{ return initialized.load(); });
+            }
 
             // Max wait time expired without result, notify subscribers with the cached config.
-            if (!initialized) {
-                setInitialized();
+            if (markInitialized()) {
+                NotificationScope scope(this);
+                notifyReady();
+                if (scope.serviceDestroyed()) {
+                    return { nullptr, kDistantPast };
+                }
+                lock_guard<mutex> lock(fetchMutex);
                 auto config = cachedEntry->config;
                 return { (cachedEntry != ConfigEntry::empty && config) ? config->getSettingsOrEmpty() : nullptr, cachedEntry->fetchTime };
             }
@@ -70,7 +172,8 @@ SettingResult ConfigService::getSettings() {
     // If we are initialized, we prefer the cached results
     auto [ entry, _0, _1 ] = fetchIfOlder(threshold, preferCached);
     auto config = entry->config;
-    return { (cachedEntry != ConfigEntry::empty && config) ? config->getSettingsOrEmpty() : nullptr, entry->fetchTime };
+    // The service may be destroyed by a subscriber notified during the fetch, only the result is used here.
+    return { (entry != ConfigEntry::empty && config) ? config->getSettingsOrEmpty() : nullptr, entry->fetchTime };
 }
 
 RefreshResult ConfigService::refresh() {
@@ -84,6 +187,19 @@ RefreshResult ConfigService::refresh() {
     return { errorMessage, errorException };
 }
 
+void ConfigService::refreshAsync(const std::function<void(RefreshResult)>& callback) {
+    if (offline) {
+        auto offlineWarning = "Client is in offline mode, it cannot initiate HTTP calls.";
+        LOG_WARN(3200) << offlineWarning;
+        callback({ offlineWarning, nullptr });
+        return;
+    }
+
+    fetchIfOlderAsync(kDistantFuture, false, [callback](const shared_ptr<const ConfigEntry>&, const std::optional<std::string>& errorMessage, const std::exception_ptr& errorException) {
+        callback({ errorMessage, errorException });
+    });
+}
+
 void ConfigService::setOnline() {
     if (!offline) {
         return;
@@ -104,21 +220,7 @@ void ConfigService::setOffline() {
 
     offline = true;
     if (pollingMode->getPollingIdentifier() == AutoPollingMode::kIdentifier) {
-        {
-            lock_guard<mutex> lock(initMutex);
-            stopRequested = true;
-        }
-
-        stop.notify_all();
-        if (thread && thread->joinable()) {
-            thread->join();
-            thread.reset();
-        }
-
-        {
-            lock_guard<mutex> lock(initMutex);
-            stopRequested = false;
-        }
+        stopPoll();
     }
     LOG_INFO(5200) << "Switched to OFFLINE mode.";
 }
@@ -127,117 +229,506 @@ string ConfigService::generateCacheKey(const string& sdkKey) {
     return sha1(sdkKey + "_" + ConfigFetcher::kConfigJsonName + "_" + ConfigEntry::kSerializationFormatVersion);
 }
 tuple<shared_ptr<const ConfigEntry>, std::optional<std::string>, std::exception_ptr> ConfigService::fetchIfOlder(double threshold, bool preferCached) {
+    // This is on the path of every evaluation and the callback is mostly invoked synchronously (when the cached config
+    // is fresh enough), so the result is handed over on the stack instead of a promise, which allocates its shared state.
+    struct PendingResult {
+        mutex resultMutex;
+        condition_variable resultCondition;
+        std::optional<tuple<shared_ptr<const ConfigEntry>, std::optional<std::string>, std::exception_ptr>> result;
+    } pending;
+    fetchIfOlderAsync(threshold, preferCached, [&pending](const shared_ptr<const ConfigEntry>& entry, const std::optional<std::string>& errorMessage, const std::exception_ptr& errorException) {
+        lock_guard<mutex> lock(pending.resultMutex);
+        pending.result.emplace(entry, errorMessage, errorException);
+        pending.resultCondition.notify_all();
+    });
+    unique_lock<mutex> lock(pending.resultMutex);
+    pending.resultCondition.wait(lock, [&pending] { return pending.result.has_value(); });
+    return std::move(*pending.result);
+}
+
+ConfigService::FetchCallback ConfigService::endSpanOnCallback(TraceSpan&& span, const FetchCallback& callback) {
+    auto sharedSpan = make_shared<TraceSpan>(std::move(span));
+    return [sharedSpan, callback](const shared_ptr<const ConfigEntry>& entry, const std::optional<std::string>& errorMessage, const std::exception_ptr& errorException) {
+        sharedSpan->end();
+        callback(entry, errorMessage, errorException);
+    };
+}
+
+void ConfigService::fetchIfOlderAsync(double threshold, bool preferCached, const FetchCallback& callback) {
+    shared_ptr<const ConfigEntry> previousEntry;
+    std::optional<std::string> skipMessage;
+    bool startFetch = false;
+    // This runs on each evaluation, so the span is only started when a fetch is involved or the config changes.
+    DeferredSpan span(tracer, "configcat.fetch_if_older");
+    SpanContext fetchContext;
+    bool swappedFromCache = false;
+    bool becameReady = false;
     {
         lock_guard<mutex> lock(fetchMutex);
 
         // Sync up with the cache and use it when it's not expired.
-        auto fromCache = readCache();
+        auto fromCache = readCache(span);
         if (fromCache != ConfigEntry::empty && fromCache->eTag != cachedEntry->eTag) {
+            Tracer::ActiveScope activeScope(span.start());
+            auto swapSpan = tracer ? tracer->startSpan("configcat.snapshot_swap") : TraceSpan();
+            swapSpan.setAttribute("source", "cache");
+            const auto previousConfig = cachedEntry->config;
             cachedEntry = const_pointer_cast<ConfigEntry>(fromCache);
-            hooks->invokeOnConfigChanged(fromCache->config->getSettingsOrEmpty());
+            if (previousConfig != cachedEntry->config) {
+                retireConfig(previousConfig);
+                hooks->invokeOnConfigChanged(previousConfig, cachedEntry->config);
+            }
+            swappedFromCache = true;
         }
 
         // Cache isn't expired
         if (cachedEntry && cachedEntry->fetchTime > threshold) {
-            setInitialized();
-            return { cachedEntry, nullopt, nullptr };
+            becameReady = markInitialized();
+            previousEntry = cachedEntry;
         }
-
         // If we are in offline mode or the caller prefers cached values, do not initiate fetch.
-        if (offline || preferCached) {
-            return { cachedEntry, nullopt, nullptr };
+        else if (offline || preferCached) {
+            previousEntry = cachedEntry;
         }
+        // Backing off after failures, or the circuit breaker is open. Only the explicit refreshes use kDistantFuture,
+        // those are not delayed by the backoff.
+        else if (!circuitBreaker.allowRequest(chrono::steady_clock::now(), threshold == kDistantFuture)) {
+            previousEntry = cachedEntry;
+            skipMessage = circuitBreaker.getState() == CircuitBreaker::State::open
+                ? "The circuit breaker is open after repeated fetch failures, the cached config is used."
+                : "Backing off after a fetch failure, the cached config is used.";
+        } else {
+            // If there's an ongoing fetch running, the callback is invoked with its response.
+            auto& fetchSpan = span.start();
+            fetchSpan.setAttribute("fetch", ongoingFetch ? "joined" : "started");
+            fetchContext = fetchSpan.context();
+            if (!ongoingFetch) {
+                fetchSpanContext = fetchContext;
+            }
+            pendingFetchCallbacks.push_back(fetchSpan ? endSpanOnCallback(std::move(fetchSpan), callback) : callback);
+            if (ongoingFetch) {
+                return;
+            }
 
-        // If there's an ongoing fetch running, we will wait for the ongoing fetch future and use its response.
-        if (!ongoingFetch) {
             // No fetch is running, initiate a new one.
             ongoingFetch = true;
-            // launch::deferred will invoke the function on the first calling thread
-            responseFuture = async(std::launch::deferred, [&]() {
-                auto response = configFetcher->fetchConfiguration(cachedEntry->eTag);
-                ongoingFetch = false;
-                return response;
-            });
+            startFetch = true;
+            fetchStartTime = chrono::steady_clock::now();
+            previousEntry = cachedEntry;
         }
     }
 
-    auto response = responseFuture.get();
+    if (becameReady || swappedFromCache) {
+        NotificationScope scope(this);
+        scope.fetch = startFetch;
+        if (becameReady) {
+            notifyReady();
+        }
+        if (swappedFromCache && !scope.serviceDestroyed()) {
+            hooks->invokeOnConfigDiffs();
+        }
+        // The client was closed by a subscriber. The callbacks of the fetch which is not started are invoked by the
+        // destructor, otherwise the caller gets the config in use without touching the service.
+        if (scope.serviceDestroyed()) {
+            if (!startFetch) {
+                callback(previousEntry, skipMessage, nullptr);
+            }
+            return;
+        }
+    }
 
-    lock_guard<mutex> lock(fetchMutex);
+    if (!startFetch) {
+        if (swappedFromCache) {
+            span.start().setAttribute("fetch", "none");
+        }
+        callback(previousEntry, skipMessage, nullptr);
+        return;
+    }
+
+    // The fetch is started outside of the lock, so a slow (synchronous) request doesn't block the readers of the cached config.
+    Tracer::ActiveScope activeScope(fetchContext);
+    try {
+        configFetcher->fetchConfigurationAsync(previousEntry->eTag, previousEntry, [this](FetchResponse response) {
+            onFetchCompleted(response);
+        });
+    } catch (...) {
+        // The waiting callers must be released even if the fetch could not be started.
+        FetchResponse response(failure, ConfigEntry::empty, "Error occurred while starting the fetch.", current_exception(), true);
+        onFetchCompleted(response);
+    }
+}
+
+void ConfigService::onFetchCompleted(FetchResponse& response) {
+    // Holds the completion of the polling tick whose fetch this is (if any), it's delivered with the callbacks below.
+    NotificationScope scope(this);
+    scope.pollCount = 1;
+    vector<FetchCallback> callbacks;
+    shared_ptr<const ConfigEntry> entry;
+    FetchCompletedInfo fetchCompletedInfo;
+    // Copied, as the service may be destroyed once the lock is released.
+    shared_ptr<Hooks> fetchHooks;
+    bool becameReady = false;
+    {
+        lock_guard<mutex> lock(fetchMutex);
+        // The completion may run on another thread, the spans started here belong to the fetch nevertheless.
+        Tracer::ActiveScope activeScope(fetchSpanContext);
+
+        fetchCompletedInfo.result = response.isFetched() ? FetchCompletedInfo::Result::fetched
+            : response.notModified() ? FetchCompletedInfo::Result::notModified
+            : FetchCompletedInfo::Result::failed;
+        fetchCompletedInfo.statusCode = response.statusCode;
+        fetchCompletedInfo.duration = chrono::steady_clock::now() - fetchStartTime;
+        fetchCompletedInfo.timing = response.timing;
+        fetchCompletedInfo.errorMessage = response.errorMessage;
+
+        if (metrics) {
+            const auto outcome = response.isFetched() ? MetricsRegistry::FetchOutcome::modified
+                : response.notModified() ? MetricsRegistry::FetchOutcome::notModified
+                : MetricsRegistry::FetchOutcome::failed;
+            metrics->recordFetch(outcome, fetchCompletedInfo.duration);
+        }
+
+        if (response.isFetched()) {
+            // The fetcher reuses the current config when the downloaded content is identical, there's no change to report in that case.
+            const auto previousConfig = cachedEntry->config;
+            {
+                auto swapSpan = tracer ? tracer->startSpan("configcat.snapshot_swap") : TraceSpan();
+                swapSpan.setAttribute("source", "fetch");
+                cachedEntry = const_pointer_cast<ConfigEntry>(response.entry);
+            }
+            writeCache(cachedEntry);
+            if (previousConfig != cachedEntry->config) {
+                retireConfig(previousConfig);
+                hooks->invokeOnConfigChanged(previousConfig, cachedEntry->config);
+            }
+        } else if ((response.notModified() || !response.isTransientError) && cachedEntry != ConfigEntry::empty) {
+            cachedEntry->fetchTime = get_utcnowseconds_since_epoch();
+            // The initial config has no config JSON, the cache would be overwritten with an empty config.
+            if (cachedEntry != initialEntry) {
+                writeCache(cachedEntry);
+            }
+        }
+
+        // Only the transient failures count, e.g. an invalid SDK key is not a sign of the CDN having trouble.
+        if (response.isFailed() && response.isTransientError) {
+            if (circuitBreaker.recordFailure(chrono::steady_clock::now())) {
+                LOG_WARN(3203) << "The circuit breaker is open after " << circuitBreaker.getConsecutiveFailures()
+                               << " consecutive fetch failures, the cached config is used until the next probe.";
+            }
+        } else if (circuitBreaker.recordSuccess()) {
+            LOG_INFO(5201) << "The circuit breaker is closed, the fetches are back to normal.";
+        }
+
+        // The ready notification keeps the service alive (see the destructor), as it's delivered outside of the lock.
+        becameReady = markInitialized();
+        if (becameReady) {
+            ++pendingReadyNotifications;
+            scope.readyNotifications = 1;
+        }
+        entry = cachedEntry;
+        fetchHooks = hooks;
+        callbacks.swap(pendingFetchCallbacks);
+        ongoingFetch = false;
+        // Notified under the lock, as the destructor may be waiting for this and the service must outlive the notification.
+        fetchCompleted.notify_all();
+    }
+
+    if (becameReady) {
+        notifyReady();
+        if (!scope.serviceDestroyed()) {
+            lock_guard<mutex> lock(fetchMutex);
+            --pendingReadyNotifications;
+            scope.readyNotifications = 0;
+            fetchCompleted.notify_all();
+        }
+    }
+
+    // The callbacks are invoked even if the client was closed by a subscriber, so the callers waiting for them are released.
+    if (!scope.serviceDestroyed()) {
+        fetchHooks->invokeOnConfigDiffs();
+        fetchHooks->invokeOnFetchCompleted(fetchCompletedInfo);
+    }
 
-    if (response.isFetched()) {
-        cachedEntry = const_pointer_cast<ConfigEntry>(response.entry);
-        writeCache(cachedEntry);
-        hooks->invokeOnConfigChanged(cachedEntry->config->getSettingsOrEmpty());
-    } else if ((response.notModified() || !response.isTransientError) && cachedEntry != ConfigEntry::empty) {
-        cachedEntry->fetchTime = get_utcnowseconds_since_epoch();
-        writeCache(cachedEntry);
+    for (const auto& callback : callbacks) {
+        callback(entry, response.errorMessage, response.errorException);
+    }
+}
+
+shared_ptr<const ConfigEntry> ConfigService::getStaleWhileRevalidate(double threshold, const LazyLoadingMode& lazyPollingMode) {
+    shared_ptr<const ConfigEntry> staleEntry;
+    {
+        lock_guard<mutex> lock(fetchMutex);
+
+        // Nothing to serve yet, or the config is not expired: the regular path applies.
+        if (cachedEntry == ConfigEntry::empty || cachedEntry->fetchTime > threshold || offline) {
+            return nullptr;
+        }
+
+        // Beyond the max staleness the caller has to wait for the fresh config.
+        if (lazyPollingMode.maxStalenessInSeconds > 0 && cachedEntry->fetchTime <= threshold - lazyPollingMode.maxStalenessInSeconds) {
+            return nullptr;
+        }
+
+        staleEntry = cachedEntry;
+    }
+
+    revalidateInBackground();
+    return staleEntry;
+}
+
+shared_ptr<const ConfigEntry> ConfigService::getInitialWhileRevalidate(double threshold) {
+    shared_ptr<const ConfigEntry> entry;
+    {
+        lock_guard<mutex> lock(fetchMutex);
+        if (!initialEntry || cachedEntry != initialEntry || cachedEntry->fetchTime > threshold || offline) {
+            return nullptr;
+        }
+        entry = cachedEntry;
     }
 
-    setInitialized();
-    return { cachedEntry, response.errorMessage, response.errorException };
+    revalidateInBackground();
+    return entry;
+}
+
+void ConfigService::revalidateInBackground() {
+    // Only a single background refresh runs at a time, the callers in the meantime get the stale config.
+    if (!revalidating.exchange(true)) {
+        lock_guard<mutex> lock(pollMutex);
+        if (!pollScheduler) {
+            pollScheduler = PollScheduler::getInstance();
+        }
+        revalidateTimer = pollScheduler->scheduleOnce([this] {
+            NotificationScope scope(this);
+            auto& lazyPollingMode = (LazyLoadingMode&)*pollingMode;
+            fetchIfOlder(get_utcnowseconds_since_epoch() - lazyPollingMode.cacheRefreshIntervalInSeconds);
+            if (!scope.serviceDestroyed()) {
+                revalidating = false;
+            }
+        }, chrono::milliseconds(0));
+    }
 }
 
 void ConfigService::setInitialized() {
-    if (!initialized) {
-        initialized = true;
-        init.notify_all();
-        hooks->invokeOnClientReady();
+    if (markInitialized()) {
+        notifyReady();
     }
 }
 
-shared_ptr<const ConfigEntry> ConfigService::readCache() {
+bool ConfigService::markInitialized() {
+    lock_guard<mutex> lock(initMutex);
+    if (initialized) {
+        return false;
+    }
+    initialized = true;
+    init.notify_all();
+    return true;
+}
+
+void ConfigService::notifyReady() {
+    NotificationScope scope(this);
+    hooks->invokeOnClientReady();
+    if (scope.serviceDestroyed()) {
+        return;
+    }
+
+    vector<function<void()>> callbacks;
+    {
+        lock_guard<mutex> lock(readyMutex);
+        ready = true;
+        callbacks.swap(readyCallbacks);
+    }
+    readyPromise.set_value();
+    for (const auto& callback : callbacks) {
+        callback();
+    }
+}
+
+void ConfigService::onReady(const std::function<void()>& callback) {
+    {
+        lock_guard<mutex> lock(readyMutex);
+        if (!ready) {
+            readyCallbacks.push_back(callback);
+            return;
+        }
+    }
+    callback();
+}
+
+double ConfigService::getConfigFetchTime() {
+    lock_guard<mutex> lock(fetchMutex);
+    return cachedEntry != ConfigEntry::empty ? cachedEntry->fetchTime : kDistantPast;
+}
+
+MemoryStats ConfigService::getMemoryStats() {
+    MemoryStats stats;
+    shared_ptr<const Config> config;
+    vector<shared_ptr<const Config>> retiredConfigs;
+    {
+        lock_guard<mutex> lock(fetchMutex);
+        config = cachedEntry->config;
+        stats.configJsonString = stringHeapBytes(cachedEntry->configJsonString());
+        stats.cachedEntryString = stringHeapBytes(cachedEntryString);
+
+        for (const auto& retired : retiredSnapshots) {
+            if (auto retiredConfig = retired.config.lock()) {
+                retiredConfigs.push_back(retiredConfig);
+            } else if (auto settings = retired.settings.lock()) {
+                auto settingsOnly = make_shared<Config>();
+                settingsOnly->settings = settings;
+                retiredConfigs.push_back(settingsOnly);
+            }
+        }
+    }
+
+    // The configs don't change once they're published (the lazy decoding is synchronized), so they can be measured
+    // without blocking the fetches.
+    if (config && config != Config::empty) {
+        stats.config = config->memoryUsage();
+    }
+    stats.retiredSnapshots = retiredConfigs.size();
+    for (const auto& retiredConfig : retiredConfigs) {
+        stats.retiredSnapshotsMemory += retiredConfig->memoryUsage();
+    }
+    return stats;
+}
+
+void ConfigService::retireConfig(const shared_ptr<const Config>& config) {
+    retiredSnapshots.erase(remove_if(retiredSnapshots.begin(), retiredSnapshots.end(),
+                                     [](const RetiredSnapshot& retired) { return retired.expired(); }),
+                           retiredSnapshots.end());
+    if (config && config != Config::empty) {
+        retiredSnapshots.push_back({ config, config->settings });
+    }
+}
+
+shared_ptr<const ConfigEntry> ConfigService::readCache(DeferredSpan& parentSpan) {
+    // The cache is read on each evaluation, so the span is only started for the reads which load a new entry.
+    DeferredSpan span(tracer, "configcat.cache_read", &parentSpan);
     try {
+        const auto readStart = metrics ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
         auto jsonString = configCache->read(cacheKey);
+        if (metrics) {
+            metrics->recordCacheRead(chrono::steady_clock::now() - readStart);
+        }
         if (jsonString.empty() || jsonString == cachedEntryString) {
             return ConfigEntry::empty;
         }
 
+        span.start();
         cachedEntryString = jsonString;
-        return ConfigEntry::fromString(jsonString);
+        return ConfigEntry::fromString(jsonString, lazySettingDecoding, cachedEntry, configArena);
     } catch (...) {
         LogEntry logEntry(logger, configcat::LOG_LEVEL_ERROR, 2200, current_exception());
         logEntry << "Error occurred while reading the cache.";
+        span.start().setAttribute("error", logEntry.getMessage());
         return ConfigEntry::empty;
     }
 }
 
 void ConfigService::writeCache(const std::shared_ptr<const ConfigEntry>& configEntry) {
+    auto span = tracer ? tracer->startSpan("configcat.cache_write") : TraceSpan();
     try {
+        const auto writeStart = metrics ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
         configCache->write(cacheKey, configEntry->serialize());
+        if (metrics) {
+            metrics->recordCacheWrite(chrono::steady_clock::now() - writeStart);
+        }
     } catch (...) {
         LogEntry logEntry(logger, configcat::LOG_LEVEL_ERROR, 2201, current_exception());
         logEntry << "Error occurred while writing the cache.";
+        span.setAttribute("error", logEntry.getMessage());
     }
 }
 
 void ConfigService::startPoll() {
-    thread = make_unique<std::thread>([this] { run(); });
-};
+    lock_guard<mutex> lock(pollMutex);
+    if (pollTimer) {
+        return;
+    }
 
-void ConfigService::run() {
-    auto& autoPollingMode = (AutoPollingMode&)*pollingMode;
-    fetchIfOlder(get_utcnowseconds_since_epoch() - autoPollingMode.autoPollIntervalInSeconds);
+    // The polling ticks of all the clients run on the shared scheduler instead of a thread per client.
+    if (!pollScheduler) {
+        pollScheduler = PollScheduler::getInstance();
+    }
+    const auto generation = ++pollGeneration;
+    pollTimer = pollScheduler->scheduleOnce([this, generation] { poll(generation); }, chrono::milliseconds(0));
+}
 
+void ConfigService::stopPoll() {
+    shared_ptr<PollScheduler::Timer> timer;
+    shared_ptr<PollScheduler::Timer> backgroundTimer;
     {
-        // Initialization finished
-        lock_guard<mutex> lock(initMutex);
-        setInitialized();
+        lock_guard<mutex> lock(pollMutex);
+        // The fetch of the last tick may still be running, its completion doesn't schedule a new tick anymore.
+        ++pollGeneration;
+        timer.swap(pollTimer);
+        backgroundTimer.swap(revalidateTimer);
     }
-    init.notify_all();
 
-    do {
-        {
-            unique_lock<mutex> lock(initMutex);
-            auto timeout = chrono::seconds(autoPollingMode.autoPollIntervalInSeconds);
-            stop.wait_until(lock, chrono::system_clock::now() + timeout, [&]{ return stopRequested; });
-            if (stopRequested) {
-                break;
-            }
+    // Waits for the ongoing tick (or background refresh), so it can't run after the service is stopped. The timers are
+    // cancelled without the lock, as the tick may complete its fetch (and take the lock) before returning.
+    if (timer) {
+        pollScheduler->cancel(timer);
+    }
+    if (backgroundTimer) {
+        pollScheduler->cancel(backgroundTimer);
+        revalidating = false;
+    }
+}
+
+void ConfigService::poll(uint64_t generation) {
+    {
+        lock_guard<mutex> lock(pollMutex);
+        if (generation != pollGeneration) {
+            return;
         }
+        // Both the tick and the completion of its fetch keep the service alive (see the destructor).
+        pendingPollCount += 2;
+    }
 
-        fetchIfOlder(get_utcnowseconds_since_epoch() - autoPollingMode.autoPollIntervalInSeconds);
-    } while (true);
+    // The tick only starts the fetch and the next tick is scheduled on its completion, so the workers of the scheduler
+    // are not held up by the requests.
+    NotificationScope scope(this);
+    scope.pollCount = 2;
+    auto& autoPollingMode = (AutoPollingMode&)*pollingMode;
+    fetchIfOlderAsync(get_utcnowseconds_since_epoch() - autoPollingMode.autoPollIntervalInSeconds, false,
+        [this, generation](const shared_ptr<const ConfigEntry>&, const std::optional<std::string>&, const std::exception_ptr&) {
+            NotificationScope scope(this);
+            scope.pollCount = 1;
+            if (scope.serviceDestroyed()) {
+                return;
+            }
+            if (!initialized) {
+                // Initialization finished
+                setInitialized();
+                if (scope.serviceDestroyed()) {
+                    return;
+                }
+            }
+
+            const auto delay = nextPollDelay();
+            lock_guard<mutex> lock(pollMutex);
+            if (generation == pollGeneration) {
+                pollTimer = pollScheduler->scheduleOnce([this, generation] { poll(generation); }, delay);
+            }
+            --pendingPollCount;
+            pollCompleted.notify_all();
+        });
+
+    if (scope.serviceDestroyed()) {
+        return;
+    }
+    lock_guard<mutex> lock(pollMutex);
+    --pendingPollCount;
+    // Notified under the lock, as the destructor may be waiting for this and the service must outlive the notification.
+    pollCompleted.notify_all();
+}
+
+chrono::milliseconds ConfigService::nextPollDelay() {
+    auto& autoPollingMode = (AutoPollingMode&)*pollingMode;
+    lock_guard<mutex> lock(fetchMutex);
+    const auto interval = circuitBreaker.applyJitter(chrono::seconds(autoPollingMode.autoPollIntervalInSeconds));
+    return max(interval, circuitBreaker.retryDelay(chrono::steady_clock::now()));
 }
 
 } // namespace configcat
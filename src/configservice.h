@@ -1,15 +1,21 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <string>
 #include <memory>
-#include <thread>
+#include <functional>
 #include <future>
+#include <vector>
 #include <condition_variable>
 #include "configcat/config.h"
+#include "configcat/memorystats.h"
 #include "configcat/refreshresult.h"
 #include "settingresult.h"
+#include "tracer.h"
 #include "configfetcher.h"
+#include "pollscheduler.h"
+#include "circuitbreaker.h"
 
 
 namespace configcat {
@@ -19,7 +25,9 @@ class ConfigCatLogger;
 class ConfigFetcher;
 class ConfigCache;
 class PollingMode;
+class LazyLoadingMode;
 class Hooks;
+class MetricsRegistry;
 
 class ConfigService {
 public:
@@ -27,46 +35,147 @@ public:
                   const std::shared_ptr<ConfigCatLogger>& logger,
                   const std::shared_ptr<Hooks>& hooks,
                   const std::shared_ptr<ConfigCache>& configCache,
-                  const ConfigCatOptions& options);
+                  const ConfigCatOptions& options,
+                  const std::shared_ptr<MetricsRegistry>& metrics = nullptr,
+                  const std::shared_ptr<Tracer>& tracer = nullptr);
     ~ConfigService();
 
     SettingResult getSettings();
     RefreshResult refresh();
+    // The callback is invoked on the thread completing the fetch (which is the calling thread with a synchronous HttpSessionAdapter).
+    void refreshAsync(const std::function<void(RefreshResult)>& callback);
     void setOnline();
     void setOffline();
     bool isOffline() const { return offline; }
+    std::shared_future<void> getReadyFuture() const { return readyFuture; }
+    // Invokes the callback when the service is initialized, or immediately when it's already initialized.
+    void onReady(const std::function<void()>& callback);
+
+    // The fetch time of the config in use (in seconds since the epoch), kDistantPast when there's no fetched config yet.
+    double getConfigFetchTime();
+
+    // Estimates the memory held for the config, including the replaced configs which are still in use.
+    MemoryStats getMemoryStats();
 
     static std::string generateCacheKey(const std::string& sdkKey);
 
 private:
+    // Marks the calling thread as delivering a notification (or running a polling tick) of the service. The client may be
+    // closed by the notified code (e.g. in an onReady callback), then the destructor doesn't wait for the work held by the
+    // scopes of the thread, as it would wait for itself. The notifying code must return without touching the service
+    // then, like the worker of the PollScheduler destroyed by its own task.
+    class NotificationScope {
+    public:
+        explicit NotificationScope(ConfigService* service);
+        ~NotificationScope();
+        NotificationScope(const NotificationScope&) = delete;
+        NotificationScope& operator=(const NotificationScope&) = delete;
+
+        // Whether the service was destroyed on this thread since the scope was entered.
+        bool serviceDestroyed() const { return destroyedService() == service; }
+
+        // The pending work of the service held by the scope.
+        int pollCount = 0;
+        int readyNotifications = 0;
+        bool fetch = false; // the fetch is not started yet
+
+    private:
+        friend class ConfigService;
+
+        ConfigService* service;
+        NotificationScope* previous;
+    };
+
+    // The innermost scope of this thread, and the service destroyed within it.
+    static NotificationScope*& currentScope();
+    static const ConfigService*& destroyedService();
+
+    using FetchCallback = std::function<void(const std::shared_ptr<const ConfigEntry>&, const std::optional<std::string>&, const std::exception_ptr&)>;
+
     // Returns the ConfigEntry object and error message in case of any error.
     std::tuple<std::shared_ptr<const ConfigEntry>, std::optional<std::string>, std::exception_ptr> fetchIfOlder(double threshold, bool preferCached = false);
+    // Invokes the callback with the ConfigEntry object and error message in case of any error.
+    // When a fetch is already in progress, the callback is invoked on its completion.
+    void fetchIfOlderAsync(double threshold, bool preferCached, const FetchCallback& callback);
+    // Wraps the callback, so the span ends when the result of the fetch is delivered to the caller.
+    static FetchCallback endSpanOnCallback(TraceSpan&& span, const FetchCallback& callback);
+    void onFetchCompleted(FetchResponse& response);
+    // Returns the expired config to serve while it's refreshed in the background, or nullptr when the caller has to fetch.
+    std::shared_ptr<const ConfigEntry> getStaleWhileRevalidate(double threshold, const LazyLoadingMode& lazyPollingMode);
+    // Returns the initial config while the first fetch runs in the background, or nullptr when it's replaced already.
+    std::shared_ptr<const ConfigEntry> getInitialWhileRevalidate(double threshold);
+    // Starts a refresh on the poll scheduler, unless one is running already.
+    void revalidateInBackground();
     void setInitialized();
-    std::shared_ptr<const ConfigEntry> readCache();
+    // Sets the initialized flag, returns true for the call which changed it. The caller must call `notifyReady` then,
+    // without holding its locks, so the subscribers can use the client.
+    bool markInitialized();
+    void notifyReady();
+    // Keeps track of the replaced config, so it can be reported while it's kept alive by someone else.
+    void retireConfig(const std::shared_ptr<const Config>& config);
+    // Returns the cache entry if it's different from the last one read. The span of the read is a child of `parentSpan`.
+    std::shared_ptr<const ConfigEntry> readCache(DeferredSpan& parentSpan);
     void writeCache(const std::shared_ptr<const ConfigEntry>& configEntry);
     void startPoll();
-    void run();
+    void stopPoll();
+    // Starts the fetch of an auto polling tick, the next tick is scheduled when it's completed.
+    void poll(uint64_t generation);
+    // The delay until the next auto polling tick, backed off after failures.
+    std::chrono::milliseconds nextPollDelay();
 
     std::chrono::time_point<std::chrono::steady_clock> startTime;
     std::mutex initMutex;
     std::mutex fetchMutex;
     std::condition_variable init;
-    bool initialized = false;
-    std::unique_ptr<std::thread> thread;
-    std::condition_variable stop;
-    bool stopRequested = false;
+    // Written under initMutex (for the `init` waiters), but read without it by the polling and the evaluations.
+    std::atomic<bool> initialized = false;
+    bool waitForInitOnEvaluation = true;
+    std::promise<void> readyPromise;
+    std::shared_future<void> readyFuture;
+    std::mutex readyMutex;
+    bool ready = false;
+    std::vector<std::function<void()>> readyCallbacks;
+    std::mutex pollMutex;
+    std::shared_ptr<PollScheduler> pollScheduler;
+    std::shared_ptr<PollScheduler::Timer> pollTimer;
+    std::shared_ptr<PollScheduler::Timer> revalidateTimer;
+    // Incremented when the polling is (re)started or stopped, the ticks of an earlier polling don't schedule new ones.
+    uint64_t pollGeneration = 0; // guarded by pollMutex
+    int pendingPollCount = 0; // the running ticks and their pending fetches, guarded by pollMutex
+    std::condition_variable pollCompleted;
+    std::atomic<bool> revalidating = false;
     std::atomic<bool> ongoingFetch = false;
+    std::vector<FetchCallback> pendingFetchCallbacks;
+    std::condition_variable fetchCompleted;
+    int pendingReadyNotifications = 0; // guarded by fetchMutex
+    CircuitBreaker circuitBreaker; // guarded by fetchMutex
 
     std::shared_ptr<ConfigCatLogger> logger;
     std::shared_ptr<Hooks> hooks;
     std::shared_ptr<PollingMode> pollingMode;
     std::shared_ptr<ConfigEntry> cachedEntry;
+    // The entry of `ConfigCatOptions::initialConfig` until it's replaced, nullptr when there's no initial config.
+    std::shared_ptr<const ConfigEntry> initialEntry;
     std::string cachedEntryString;
     std::shared_ptr<ConfigCache> configCache;
     std::string cacheKey;
+    bool lazySettingDecoding = false;
+    bool configArena = false;
     std::unique_ptr<ConfigFetcher> configFetcher;
     std::atomic<bool> offline = false;
-    std::shared_future<FetchResponse> responseFuture;
+    std::shared_ptr<MetricsRegistry> metrics;
+    std::chrono::steady_clock::time_point fetchStartTime; // guarded by fetchMutex
+    std::shared_ptr<Tracer> tracer;
+    SpanContext fetchSpanContext; // guarded by fetchMutex
+
+    // The evaluations hold onto the settings only, the hook subscribers onto the whole config.
+    struct RetiredSnapshot {
+        std::weak_ptr<const Config> config;
+        std::weak_ptr<Settings> settings;
+
+        inline bool expired() const { return config.expired() && settings.expired(); }
+    };
+    std::vector<RetiredSnapshot> retiredSnapshots; // guarded by fetchMutex
 };
 
 } // namespace configcat
@@ -0,0 +1,193 @@
+#ifndef CONFIGCAT_EXTERNAL_NETWORK_ADAPTER_ENABLED
+
+#include "curlmultiengine.h"
+#include <future>
+
+using namespace std;
+
+namespace configcat {
+
+weak_ptr<CurlMultiEngine> CurlMultiEngine::instance;
+mutex CurlMultiEngine::instanceMutex;
+
+shared_ptr<CurlMultiEngine> CurlMultiEngine::getInstance() {
+    lock_guard<mutex> lock(instanceMutex);
+    auto engine = instance.lock();
+    if (!engine) {
+        engine = shared_ptr<CurlMultiEngine>(new CurlMultiEngine());
+        instance = engine;
+    }
+    return engine;
+}
+
+CurlMultiEngine::CurlMultiEngine() {
+    multi = curl_multi_init();
+#if LIBCURL_VERSION_NUM >= 0x073E00 // 7.62.0
+    // Requests to the same host share a single HTTP/2 connection instead of opening new ones.
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockShare);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+
+    ioThread = thread([this] { run(); });
+}
+
+CurlMultiEngine::~CurlMultiEngine() {
+    {
+        lock_guard<mutex> lock(transfersMutex);
+        stopRequested = true;
+    }
+    if (ioThread.get_id() == this_thread::get_id()) {
+        // The last reference was released by a completion callback, the I/O thread returns right after this.
+        *destroyedOnIoThread = true;
+        ioThread.detach();
+    } else {
+        wakeup();
+        if (ioThread.joinable()) {
+            ioThread.join();
+        }
+    }
+
+    abortTransfers();
+    curl_multi_cleanup(multi);
+    curl_share_cleanup(share);
+}
+
+void CurlMultiEngine::attach(CURL* easy) {
+    curl_easy_setopt(easy, CURLOPT_SHARE, share);
+#if LIBCURL_VERSION_NUM >= 0x072B00 // 7.43.0
+    // Wait for an ongoing connection to the same host to be able to multiplex instead of opening a new one.
+    curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+#endif
+}
+
+void CurlMultiEngine::performAsync(CURL* easy, CompletionCallback onCompleted) {
+    {
+        lock_guard<mutex> lock(transfersMutex);
+        if (!stopRequested) {
+            pendingTransfers.push_back({easy, std::move(onCompleted)});
+            onCompleted = nullptr;
+        }
+    }
+    if (onCompleted) {
+        onCompleted(CURLE_FAILED_INIT);
+        return;
+    }
+    wakeup();
+}
+
+CURLcode CurlMultiEngine::perform(CURL* easy) {
+    promise<CURLcode> result;
+    auto future = result.get_future();
+    performAsync(easy, [&result](CURLcode code) { result.set_value(code); });
+    return future.get();
+}
+
+void CurlMultiEngine::wakeup() {
+    transfersAdded.notify_one();
+#if LIBCURL_VERSION_NUM >= 0x074400 // 7.68.0
+    curl_multi_wakeup(multi);
+#endif
+}
+
+void CurlMultiEngine::run() {
+    vector<pair<CompletionCallback, CURLcode>> completedTransfers;
+    while (true) {
+        {
+            unique_lock<mutex> lock(transfersMutex);
+            // Without transfers there's nothing to poll, so the thread sleeps until the next one is started.
+            if (activeTransfers.empty()) {
+                transfersAdded.wait(lock, [this] { return stopRequested || !pendingTransfers.empty(); });
+            }
+            if (stopRequested) {
+                break;
+            }
+            for (auto& transfer : pendingTransfers) {
+                const auto result = curl_multi_add_handle(multi, transfer.easy);
+                if (result != CURLM_OK) {
+                    completedTransfers.emplace_back(std::move(transfer.onCompleted), CURLE_FAILED_INIT);
+                    continue;
+                }
+                activeTransfers[transfer.easy] = std::move(transfer.onCompleted);
+            }
+            pendingTransfers.clear();
+        }
+
+        int runningTransfers = 0;
+        curl_multi_perform(multi, &runningTransfers);
+
+        int messagesLeft = 0;
+        while (CURLMsg* message = curl_multi_info_read(multi, &messagesLeft)) {
+            if (message->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            // The message is freed by curl_multi_remove_handle, so its data must be read out first.
+            CURL* easy = message->easy_handle;
+            const CURLcode result = message->data.result;
+            curl_multi_remove_handle(multi, easy);
+            if (const auto it = activeTransfers.find(easy); it != activeTransfers.end()) {
+                completedTransfers.emplace_back(std::move(it->second), result);
+                activeTransfers.erase(it);
+            }
+        }
+
+        if (!completedTransfers.empty()) {
+            // The callbacks run without the lock, so they can start new transfers (e.g. a redirect). They may also release the
+            // last adapter, the engine is kept alive until they return (unless it's being destroyed on another thread already).
+            auto self = weak_from_this().lock();
+            for (auto& [onCompleted, result] : completedTransfers) {
+                onCompleted(result);
+            }
+            completedTransfers.clear();
+
+            bool destroyed = false;
+            destroyedOnIoThread = &destroyed;
+            self.reset();
+            if (destroyed) {
+                return;
+            }
+            destroyedOnIoThread = nullptr;
+        }
+
+        if (activeTransfers.empty()) {
+            continue;
+        }
+#if LIBCURL_VERSION_NUM >= 0x074400 // 7.68.0
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+#else
+        // Without curl_multi_wakeup the new transfers are picked up by the next iteration.
+        curl_multi_wait(multi, nullptr, 0, 50, nullptr);
+#endif
+    }
+}
+
+void CurlMultiEngine::abortTransfers() {
+    // The engine is only destroyed when no adapter references it, so there should be no transfers left at this point.
+    for (auto& [easy, onCompleted] : activeTransfers) {
+        curl_multi_remove_handle(multi, easy);
+        onCompleted(CURLE_ABORTED_BY_CALLBACK);
+    }
+    activeTransfers.clear();
+    for (auto& transfer : pendingTransfers) {
+        transfer.onCompleted(CURLE_ABORTED_BY_CALLBACK);
+    }
+    pendingTransfers.clear();
+}
+
+void CurlMultiEngine::lockShare(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<CurlMultiEngine*>(userptr)->shareMutexes[data].lock();
+}
+
+void CurlMultiEngine::unlockShare(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<CurlMultiEngine*>(userptr)->shareMutexes[data].unlock();
+}
+
+} // namespace configcat
+
+#endif // CONFIGCAT_EXTERNAL_NETWORK_ADAPTER_ENABLED
@@ -0,0 +1,81 @@
+#pragma once
+
+#ifndef CONFIGCAT_EXTERNAL_NETWORK_ADAPTER_ENABLED
+
+#include <curl/curl.h>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace configcat {
+
+// Process-wide fetch engine which performs the transfers of all `CurlNetworkAdapter`s (that opted in) on a single I/O thread
+// using a `curl_multi` handle. Transfers to the same host are multiplexed over shared HTTP/2 connections, and the DNS and TLS
+// session caches are shared between the transfers through a `curl_share` handle.
+// The engine is created on first use and shut down when the last adapter releases it.
+class CurlMultiEngine : public std::enable_shared_from_this<CurlMultiEngine> {
+public:
+    static std::shared_ptr<CurlMultiEngine> getInstance();
+
+    ~CurlMultiEngine();
+
+    CurlMultiEngine(const CurlMultiEngine&) = delete;
+    CurlMultiEngine& operator=(const CurlMultiEngine&) = delete;
+
+    // Configures the easy handle to use the shared caches of the engine.
+    void attach(CURL* easy);
+
+    using CompletionCallback = std::function<void(CURLcode)>;
+
+    // Starts the transfer of the (fully configured) easy handle on the I/O thread and returns without waiting for it.
+    // `onCompleted` is invoked on the I/O thread when the transfer is completed (or on the calling thread when it can't
+    // be started). The easy handle is already removed from the engine by then, so the callback may reuse it.
+    void performAsync(CURL* easy, CompletionCallback onCompleted);
+
+    // Performs the transfer on the I/O thread and blocks until it's completed (for the synchronous `get`).
+    CURLcode perform(CURL* easy);
+
+    // Whether the calling thread is the I/O thread, which must not wait for the completion of a transfer.
+    inline bool isIoThread() const { return std::this_thread::get_id() == ioThread.get_id(); }
+
+private:
+    struct Transfer {
+        CURL* easy;
+        CompletionCallback onCompleted;
+    };
+
+    CurlMultiEngine();
+
+    void run();
+    void wakeup();
+    // Completes the transfers which are still in the engine when it's stopped.
+    void abortTransfers();
+
+    static void lockShare(CURL*, curl_lock_data data, curl_lock_access, void* userptr);
+    static void unlockShare(CURL*, curl_lock_data data, void* userptr);
+
+    static std::weak_ptr<CurlMultiEngine> instance;
+    static std::mutex instanceMutex;
+
+    CURLM* multi = nullptr;
+    CURLSH* share = nullptr;
+    std::mutex shareMutexes[CURL_LOCK_DATA_LAST];
+
+    std::mutex transfersMutex;
+    bool stopRequested = false;
+    std::vector<Transfer> pendingTransfers;
+    // The idle I/O thread waits on it for a transfer to be started or for the engine to be stopped.
+    std::condition_variable transfersAdded;
+    std::unordered_map<CURL*, CompletionCallback> activeTransfers; // accessed only by the I/O thread
+    std::thread ioThread;
+    // Set by the I/O thread while it may release the last reference to the engine (accessed only by the I/O thread).
+    bool* destroyedOnIoThread = nullptr;
+};
+
+} // namespace configcat
+
+#endif // CONFIGCAT_EXTERNAL_NETWORK_ADAPTER_ENABLED
@@ -1,6 +1,7 @@
 #ifndef CONFIGCAT_EXTERNAL_NETWORK_ADAPTER_ENABLED
 
 #include "curlnetworkadapter.h"
+#include "curlmultiengine.h"
 #include <mutex>
 #include <sstream>
 #include <vector>
@@ -47,12 +48,29 @@ int ProgressCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_o
 }
 
 int CurlNetworkAdapter::ProgressFunction(curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
-    return closed ? 1 : 0;  // Return 0 to continue, or 1 to abort
+    const auto cancellationToken = requestCancellationToken.load();
+    return closed || (cancellationToken && cancellationToken->isCancelled()) ? 1 : 0;  // Return 0 to continue, or 1 to abort
 }
 
-static size_t WriteCallback(void *contents, size_t size, size_t nmemb, std::string *userp) {
-    userp->append((char*)contents, size * nmemb);
-    return size * nmemb;
+static size_t WriteCallback(void *contents, size_t size, size_t nmemb, CurlNetworkAdapter::WriteContext *context) {
+    const size_t length = size * nmemb;
+    // Only the body of a successful response is streamed, the rest is collected as usual.
+    if (context->onBodyChunk) {
+        long statusCode = 0;
+        curl_easy_getinfo(context->curl, CURLINFO_RESPONSE_CODE, &statusCode);
+        if (statusCode >= 200 && statusCode < 300) {
+            (*context->onBodyChunk)(static_cast<const char*>(contents), length);
+            return length;
+        }
+    }
+    context->text->append((char*)contents, length);
+    return length;
+}
+
+static size_t HeaderCallback(char* buffer, size_t size, size_t nitems, std::string* headerString) {
+    const size_t length = size * nitems;
+    headerString->append(buffer, length);
+    return length;
 }
 
 std::map<std::string, std::string> ParseHeader(const std::string& headerString) {
@@ -96,36 +114,116 @@ bool CurlNetworkAdapter::init(uint32_t connectTimeoutMs, uint32_t readTimeoutMs)
     curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallback);
     curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
 
+    // Transport setup
+    if (transportOptions.compression) {
+        // Empty string means all the encodings supported by libcurl.
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    }
+
+#if LIBCURL_VERSION_NUM >= 0x072F00 // 7.47.0
+    if (transportOptions.http2) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    }
+#endif
+
+    if (transportOptions.connectionReuse) {
+        // The connection cache of the easy handle keeps the connection alive between requests by default.
+#if LIBCURL_VERSION_NUM >= 0x074100 // 7.65.0
+        if (transportOptions.maxIdleConnectionSeconds > 0) {
+            curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, static_cast<long>(transportOptions.maxIdleConnectionSeconds));
+        }
+#endif
+    } else {
+        curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+        curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+    }
+
+    if (transportOptions.tcpKeepAlive) {
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, static_cast<long>(transportOptions.tcpKeepAliveIdleSeconds));
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, static_cast<long>(transportOptions.tcpKeepAliveIntervalSeconds));
+    }
+
+    if (transportOptions.sharedFetchEngine) {
+        multiEngine = CurlMultiEngine::getInstance();
+        multiEngine->attach(curl);
+    }
+
     return true;
 }
 
-Response CurlNetworkAdapter::get(const std::string& url,
-                                 const std::map<std::string, std::string>& header,
-                                 const std::map<std::string, std::string>& proxies,
-                                 const std::map<std::string, ProxyAuthentication>& proxyAuthentications) {
-    Response response;
-    if (!curl) {
-        response.errorCode = ResponseErrorCode::InternalError;
-        response.error = "CURL is not initialized.";
-        return response;
-    }
+ResponseTiming CurlNetworkAdapter::getTiming(CURL* curl) {
+    ResponseTiming timing;
+#if LIBCURL_VERSION_NUM >= 0x073D00 // 7.61.0
+    const auto getTime = [curl](CURLINFO info) {
+        curl_off_t time = 0;
+        curl_easy_getinfo(curl, info, &time);
+        return std::chrono::microseconds(time);
+    };
 
-    CURLcode res;
-    std::string headerString;
+    timing.nameLookup = getTime(CURLINFO_NAMELOOKUP_TIME_T);
+    timing.connect = getTime(CURLINFO_CONNECT_TIME_T);
+    timing.tlsHandshake = getTime(CURLINFO_APPCONNECT_TIME_T);
+    timing.firstByte = getTime(CURLINFO_STARTTRANSFER_TIME_T);
+    timing.total = getTime(CURLINFO_TOTAL_TIME_T);
+
+    curl_off_t downloadedBytes = 0;
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloadedBytes);
+#else
+    // The older versions report the times in seconds and the size as doubles.
+    const auto getTime = [curl](CURLINFO info) {
+        double time = 0;
+        curl_easy_getinfo(curl, info, &time);
+        return std::chrono::microseconds(static_cast<int64_t>(time * 1000000));
+    };
 
+    timing.nameLookup = getTime(CURLINFO_NAMELOOKUP_TIME);
+    timing.connect = getTime(CURLINFO_CONNECT_TIME);
+    timing.tlsHandshake = getTime(CURLINFO_APPCONNECT_TIME);
+    timing.firstByte = getTime(CURLINFO_STARTTRANSFER_TIME);
+    timing.total = getTime(CURLINFO_TOTAL_TIME);
+
+    double downloadedBytes = 0;
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD, &downloadedBytes);
+#endif
+    timing.downloadedBytes = static_cast<uint64_t>(downloadedBytes);
+
+    // The number of new connections the transfer had to make, 0 means that an existing one was reused
+    // (unless the request failed before getting anywhere).
+    long connectCount = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connectCount);
+    timing.connectionReused = connectCount == 0 && timing.firstByte.count() > 0;
+
+    return timing;
+}
+
+void CurlNetworkAdapter::prepareRequest(const std::string& url,
+                                        const std::map<std::string, std::string>& header,
+                                        const std::map<std::string, std::string>& proxies,
+                                        const std::map<std::string, ProxyAuthentication>& proxyAuthentications,
+                                        WriteContext* writeContext,
+                                        std::string* headerString) {
     // Update header
-    struct curl_slist* headers = NULL;
-    for (const auto& it : header) {
-        headers = curl_slist_append(headers, (it.first + ": " + it.second).c_str());
+    if (!requestHeaderList || header != requestHeader) {
+        struct curl_slist* headers = NULL;
+        for (const auto& it : header) {
+            headers = curl_slist_append(headers, (it.first + ": " + it.second).c_str());
+        }
+
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_slist_free_all(requestHeaderList);
+        requestHeaderList = headers;
+        requestHeader = header;
     }
 
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
 
     // Set the callback function to receive the response
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response.text);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &headerString);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, writeContext);
+    // Without a header function, curl would pass the headers to the write callback, which expects a WriteContext.
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, headerString);
 
     // Proxy setup
     const std::string protocol = url.substr(0, url.find(':'));
@@ -136,9 +234,10 @@ Response CurlNetworkAdapter::get(const std::string& url,
             curl_easy_setopt(curl, CURLOPT_PROXYPASSWORD, proxyAuthentications.at(protocol).password.c_str());
         }
     }
+}
 
-    // Perform the request
-    res = curl_easy_perform(curl);
+void CurlNetworkAdapter::completeResponse(CURLcode res, const std::string& headerString, Response& response) {
+    response.timing = getTiming(curl);
 
     if (res != CURLE_OK) {
         response.error = curl_easy_strerror(res);
@@ -149,26 +248,122 @@ Response CurlNetworkAdapter::get(const std::string& url,
         } else {
             response.errorCode = ResponseErrorCode::InternalError;
         }
-        return response;
+        return;
     }
 
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.statusCode);
 
     // Parse the headers from headerString
     response.header = ParseHeader(headerString);
+}
 
+Response CurlNetworkAdapter::get(const std::string& url,
+                                 const std::map<std::string, std::string>& header,
+                                 const std::map<std::string, std::string>& proxies,
+                                 const std::map<std::string, ProxyAuthentication>& proxyAuthentications) {
+    Response response;
+    if (!curl) {
+        response.errorCode = ResponseErrorCode::InternalError;
+        response.error = "CURL is not initialized.";
+        return response;
+    }
+
+    std::string headerString;
+    WriteContext writeContext{curl, &response.text, requestBodyChunkCallback};
+    prepareRequest(url, header, proxies, proxyAuthentications, &writeContext, &headerString);
+
+    // Perform the request. A request started from a completion callback (e.g. by a hook) is performed right away, as the
+    // I/O thread of the engine can't wait for itself.
+    const CURLcode res = multiEngine && !multiEngine->isIoThread() ? multiEngine->perform(curl) : curl_easy_perform(curl);
+    completeResponse(res, headerString, response);
     return response;
 }
 
+void CurlNetworkAdapter::getAsync(const std::string& url,
+                                  const std::map<std::string, std::string>& header,
+                                  const std::map<std::string, std::string>& proxies,
+                                  const std::map<std::string, ProxyAuthentication>& proxyAuthentications,
+                                  const std::shared_ptr<CancellationToken>& cancellationToken,
+                                  const ResponseCallback& callback) {
+    getStreamingAsync(url, header, proxies, proxyAuthentications, cancellationToken, nullptr, callback);
+}
+
+void CurlNetworkAdapter::getStreamingAsync(const std::string& url,
+                                           const std::map<std::string, std::string>& header,
+                                           const std::map<std::string, std::string>& proxies,
+                                           const std::map<std::string, ProxyAuthentication>& proxyAuthentications,
+                                           const std::shared_ptr<CancellationToken>& cancellationToken,
+                                           const BodyChunkCallback& onBodyChunk,
+                                           const ResponseCallback& callback) {
+    if (cancellationToken && cancellationToken->isCancelled()) {
+        Response response;
+        response.errorCode = ResponseErrorCode::RequestCancelled;
+        response.error = "Request was cancelled.";
+        callback(response);
+        return;
+    }
+
+    if (!multiEngine || !curl || multiEngine->isIoThread()) {
+        // The token is kept alive by the caller during the call.
+        requestCancellationToken = cancellationToken.get();
+        requestBodyChunkCallback = onBodyChunk ? &onBodyChunk : nullptr;
+        auto response = get(url, header, proxies, proxyAuthentications);
+        requestBodyChunkCallback = nullptr;
+        requestCancellationToken = nullptr;
+        callback(response);
+        return;
+    }
+
+    // The request outlives the call, the engine completes it on its I/O thread.
+    struct Request {
+        std::shared_ptr<CancellationToken> cancellationToken;
+        BodyChunkCallback onBodyChunk;
+        ResponseCallback callback;
+        Response response;
+        std::string headerString;
+        WriteContext writeContext;
+    };
+    auto request = std::make_shared<Request>();
+    request->cancellationToken = cancellationToken;
+    request->onBodyChunk = onBodyChunk;
+    request->callback = callback;
+    request->writeContext = {curl, &request->response.text, onBodyChunk ? &request->onBodyChunk : nullptr};
+    {
+        std::lock_guard<std::mutex> lock(transferMutex);
+        transferActive = true;
+    }
+    requestCancellationToken = request->cancellationToken.get();
+    prepareRequest(url, header, proxies, proxyAuthentications, &request->writeContext, &request->headerString);
+
+    multiEngine->performAsync(curl, [this, request](CURLcode res) {
+        completeResponse(res, request->headerString, request->response);
+        requestCancellationToken = nullptr;
+        {
+            // The adapter may be destroyed as soon as the transfer is marked completed, it's not accessed after this.
+            std::lock_guard<std::mutex> lock(transferMutex);
+            transferActive = false;
+            transferCompleted.notify_all();
+        }
+        request->callback(std::move(request->response));
+    });
+}
+
 void CurlNetworkAdapter::close() {
     closed = true;
 }
 
 CurlNetworkAdapter::~CurlNetworkAdapter() {
+    {
+        // The engine may still be performing the transfer of the easy handle, it's aborted by the progress callback.
+        std::unique_lock<std::mutex> lock(transferMutex);
+        closed = true;
+        transferCompleted.wait(lock, [this] { return !transferActive; });
+    }
     if (curl) {
         curl_easy_setopt(curl, CURLOPT_XFERINFODATA, NULL);
         curl_easy_cleanup(curl);
     }
+    curl_slist_free_all(requestHeaderList);
 }
 
 } // configcat
@@ -3,18 +3,22 @@
 #ifndef CONFIGCAT_EXTERNAL_NETWORK_ADAPTER_ENABLED
 
 #include "configcat/httpsessionadapter.h"
+#include "configcat/configcatoptions.h"
 #include <atomic>
+#include <condition_variable>
 #include <curl/curl.h>
 #include <memory>
+#include <mutex>
 
 
 namespace configcat {
 
 class LibCurlResourceGuard;
+class CurlMultiEngine;
 
 class CurlNetworkAdapter : public HttpSessionAdapter {
 public:
-    CurlNetworkAdapter() = default;
+    CurlNetworkAdapter(const HttpTransportOptions& transportOptions = {}) : transportOptions(transportOptions) {}
     ~CurlNetworkAdapter();
 
     bool init(uint32_t connectTimeoutMs, uint32_t readTimeoutMs) override;
@@ -22,16 +26,64 @@ public:
                  const std::map<std::string, std::string>& header,
                  const std::map<std::string, std::string>& proxies,
                  const std::map<std::string, ProxyAuthentication>& proxyAuthentications) override;
+    // With the shared fetch engine, the request is performed on the I/O thread of the engine and the callback is invoked there.
+    // Otherwise it's performed synchronously like `get`, but it can be aborted with the cancellation token as well.
+    void getAsync(const std::string& url,
+                  const std::map<std::string, std::string>& header,
+                  const std::map<std::string, std::string>& proxies,
+                  const std::map<std::string, ProxyAuthentication>& proxyAuthentications,
+                  const std::shared_ptr<CancellationToken>& cancellationToken,
+                  const ResponseCallback& callback) override;
+    // The chunks are passed to `onBodyChunk` from the curl write callback as they are received.
+    void getStreamingAsync(const std::string& url,
+                           const std::map<std::string, std::string>& header,
+                           const std::map<std::string, std::string>& proxies,
+                           const std::map<std::string, ProxyAuthentication>& proxyAuthentications,
+                           const std::shared_ptr<CancellationToken>& cancellationToken,
+                           const BodyChunkCallback& onBodyChunk,
+                           const ResponseCallback& callback) override;
     void close() override;
 
+    // The destination of the body of the current request.
+    struct WriteContext {
+        CURL* curl;
+        std::string* text;
+        const BodyChunkCallback* onBodyChunk;
+    };
+
 private:
     // CURL progress functions
     int ProgressFunction(curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
     friend int ProgressCallback(void* clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
 
+    static ResponseTiming getTiming(CURL* curl);
+
+    // Sets up the easy handle for the request, the write context and the header string must live until it's completed.
+    void prepareRequest(const std::string& url,
+                        const std::map<std::string, std::string>& header,
+                        const std::map<std::string, std::string>& proxies,
+                        const std::map<std::string, ProxyAuthentication>& proxyAuthentications,
+                        WriteContext* writeContext,
+                        std::string* headerString);
+    // Fills the response from the easy handle once the transfer is completed.
+    void completeResponse(CURLcode res, const std::string& headerString, Response& response);
+
+    HttpTransportOptions transportOptions;
     std::shared_ptr<LibCurlResourceGuard> libCurlResourceGuard;
+    // Declared after the resource guard, so the engine is released before libcurl gets cleaned up.
+    std::shared_ptr<CurlMultiEngine> multiEngine;
     CURL* curl = nullptr;
+    // The request headers are mostly the same for each fetch, so the header list is only rebuilt when they change.
+    std::map<std::string, std::string> requestHeader;
+    struct curl_slist* requestHeaderList = nullptr;
     std::atomic<bool> closed = false;
+    std::atomic<CancellationToken*> requestCancellationToken = nullptr;
+    // Set only during a streaming request, the transfers of an adapter don't overlap.
+    const BodyChunkCallback* requestBodyChunkCallback = nullptr;
+    // Whether the engine is performing a transfer of the adapter, which the destructor has to wait for.
+    std::mutex transferMutex;
+    std::condition_variable transferCompleted;
+    bool transferActive = false;
 };
 
 } // configcat
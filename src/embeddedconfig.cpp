@@ -0,0 +1,16 @@
+#include "configcat/embeddedconfig.h"
+
+using namespace std;
+
+namespace configcat {
+
+shared_ptr<const Config> EmbeddedConfig::config() const {
+    call_once(buildFlag, [this] {
+        auto config = build();
+        config->fixupSaltAndSegments();
+        builtConfig = std::move(config);
+    });
+    return builtConfig;
+}
+
+} // namespace configcat
@@ -0,0 +1,121 @@
+#include "evaluationprofiler.h"
+
+#include <algorithm>
+
+#include "utils.h"
+
+using namespace std;
+
+namespace configcat {
+
+namespace {
+
+double perEvaluation(uint64_t total, uint64_t evaluations) {
+    return evaluations > 0 ? static_cast<double>(total) / evaluations : 0;
+}
+
+string formatMatchedRule(const FlagProfile& flag) {
+    const auto top = max_element(flag.matchedRules.begin(), flag.matchedRules.end(),
+                                 [](const auto& a, const auto& b) { return a.second < b.second; });
+    if (top == flag.matchedRules.end()) {
+        return "-";
+    }
+    const auto share = 100 * perEvaluation(top->second, flag.evaluations);
+    return top->first < 0
+        ? string_format("none (%.0f%%)", share)
+        : string_format("#%d (%.0f%%)", top->first, share);
+}
+
+void appendTable(string& report, const string& title, const vector<const FlagProfile*>& flags) {
+    size_t keyWidth = 3;
+    for (const auto flag : flags) {
+        keyWidth = max(keyWidth, flag->key.size());
+    }
+
+    report += title + "\n";
+    report += string_format("  %-*s %10s %11s %9s %11s %11s %9s  %s\n", static_cast<int>(keyWidth), "key",
+                            "evals", "total ms", "avg us", "rules/eval", "conds/eval", "sha/eval", "top match");
+    for (const auto flag : flags) {
+        report += string_format("  %-*s %10llu %11.3f %9.3f %11.2f %11.2f %9.2f  %s\n", static_cast<int>(keyWidth), flag->key.c_str(),
+                                static_cast<unsigned long long>(flag->evaluations),
+                                chrono::duration<double, milli>(flag->totalTime).count(),
+                                chrono::duration<double, micro>(flag->averageTime()).count(),
+                                perEvaluation(flag->targetingRulesVisited, flag->evaluations),
+                                perEvaluation(flag->conditionsVisited, flag->evaluations),
+                                perEvaluation(flag->shaComputations, flag->evaluations),
+                                formatMatchedRule(*flag).c_str());
+    }
+}
+
+} // namespace
+
+void EvaluationProfiler::record(const string& key, const EvaluationCounters& counters, int matchedRuleIndex, chrono::nanoseconds duration) {
+    flags.record([&](map<string, FlagProfile, less<>>& shard) {
+        // Looked up before inserting, so the steady state doesn't allocate.
+        auto it = shard.find(key);
+        if (it == shard.end()) {
+            it = shard.emplace(key, FlagProfile()).first;
+            it->second.key = key;
+        }
+        auto& flag = it->second;
+        ++flag.evaluations;
+        flag.totalTime += duration;
+        flag.targetingRulesVisited += counters.targetingRulesVisited;
+        flag.conditionsVisited += counters.conditionsVisited;
+        flag.shaComputations += counters.shaComputations;
+        ++flag.matchedRules[matchedRuleIndex];
+    });
+}
+
+EvaluationProfile EvaluationProfiler::profile() const {
+    map<string, FlagProfile> merged;
+    flags.forEachShard([&](const map<string, FlagProfile, less<>>& shard) {
+        for (const auto& [key, flag] : shard) {
+            auto& target = merged[key];
+            target.key = key;
+            target.evaluations += flag.evaluations;
+            target.totalTime += flag.totalTime;
+            target.targetingRulesVisited += flag.targetingRulesVisited;
+            target.conditionsVisited += flag.conditionsVisited;
+            target.shaComputations += flag.shaComputations;
+            for (const auto& [ruleIndex, count] : flag.matchedRules) {
+                target.matchedRules[ruleIndex] += count;
+            }
+        }
+    });
+
+    EvaluationProfile profile;
+    profile.flags.reserve(merged.size());
+    for (auto& [_, flag] : merged) {
+        profile.flags.push_back(std::move(flag));
+    }
+    stable_sort(profile.flags.begin(), profile.flags.end(),
+                [](const FlagProfile& a, const FlagProfile& b) { return a.totalTime > b.totalTime; });
+    return profile;
+}
+
+string EvaluationProfile::toReport(size_t top) const {
+    const auto count = min(top, flags.size());
+
+    vector<const FlagProfile*> expensive;
+    expensive.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        expensive.push_back(&flags[i]);
+    }
+
+    vector<const FlagProfile*> hot;
+    hot.reserve(flags.size());
+    for (const auto& flag : flags) {
+        hot.push_back(&flag);
+    }
+    stable_sort(hot.begin(), hot.end(), [](const FlagProfile* a, const FlagProfile* b) { return a->evaluations > b->evaluations; });
+    hot.resize(count);
+
+    string report;
+    appendTable(report, string_format("Top %zu most expensive flags (by total evaluation time, %zu flags profiled):", count, flags.size()), expensive);
+    report += "\n";
+    appendTable(report, string_format("Top %zu hottest flags (by evaluation count):", count), hot);
+    return report;
+}
+
+} // namespace configcat
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <string>
+
+#include "configcat/evaluationprofile.h"
+#include "shardedrecorder.h"
+
+namespace configcat {
+
+// The work done by a single evaluation.
+struct EvaluationCounters {
+    uint32_t targetingRulesVisited = 0;
+    uint32_t conditionsVisited = 0;
+    uint32_t shaComputations = 0;
+};
+
+// Collects the per-flag evaluation statistics of a RolloutEvaluator. Like MetricsRegistry, the recordings go to
+// the shard of the calling thread and the shards are merged only when a profile is taken.
+class EvaluationProfiler {
+public:
+    // `matchedRuleIndex` is -1 when no targeting rule matched.
+    void record(const std::string& key, const EvaluationCounters& counters, int matchedRuleIndex, std::chrono::nanoseconds duration);
+
+    EvaluationProfile profile() const;
+
+private:
+    ShardedRecorder<std::map<std::string, FlagProfile, std::less<>>> flags;
+};
+
+} // namespace configcat
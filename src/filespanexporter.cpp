@@ -0,0 +1,144 @@
+#include "configcat/tracing.h"
+
+#include <nlohmann/json.hpp>
+
+#include "utils.h"
+#include "version.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+namespace configcat {
+
+namespace {
+
+string toHex(uint64_t high, uint64_t low) {
+    return string_format("%016llx%016llx", static_cast<unsigned long long>(high), static_cast<unsigned long long>(low));
+}
+
+string toHex(uint64_t id) {
+    return string_format("%016llx", static_cast<unsigned long long>(id));
+}
+
+int64_t toUnixNanoseconds(chrono::system_clock::time_point time) {
+    return chrono::duration_cast<chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+json toChromeTraceEvent(const Span& span) {
+    json args = json::object();
+    for (const auto& [key, value] : span.attributes) {
+        args[key] = value;
+    }
+    args["trace_id"] = toHex(span.traceIdHigh, span.traceIdLow);
+    args["span_id"] = toHex(span.spanId);
+    if (span.parentSpanId != 0) {
+        args["parent_span_id"] = toHex(span.parentSpanId);
+    }
+
+    // Complete event ("X"), the timestamps are in microseconds.
+    return {
+        {"name", span.name},
+        {"cat", "configcat"},
+        {"ph", "X"},
+        {"ts", toUnixNanoseconds(span.startTime) / 1000.0},
+        {"dur", span.duration.count() / 1000.0},
+        {"pid", 1},
+        {"tid", span.threadId},
+        {"args", args}
+    };
+}
+
+json toOtlpSpan(const Span& span) {
+    json attributes = json::array();
+    for (const auto& [key, value] : span.attributes) {
+        attributes.push_back({{"key", key}, {"value", {{"stringValue", value}}}});
+    }
+    attributes.push_back({{"key", "thread.id"}, {"value", {{"intValue", to_string(span.threadId)}}}});
+
+    const auto startTime = toUnixNanoseconds(span.startTime);
+    json otlpSpan = {
+        {"traceId", toHex(span.traceIdHigh, span.traceIdLow)},
+        {"spanId", toHex(span.spanId)},
+        {"name", span.name},
+        {"kind", span.name == "configcat.http_fetch" ? 3 : 1}, // SPAN_KIND_CLIENT : SPAN_KIND_INTERNAL
+        // 64-bit integers are strings in OTLP/JSON.
+        {"startTimeUnixNano", to_string(startTime)},
+        {"endTimeUnixNano", to_string(startTime + span.duration.count())},
+        {"attributes", attributes}
+    };
+    if (span.parentSpanId != 0) {
+        otlpSpan["parentSpanId"] = toHex(span.parentSpanId);
+    }
+    return otlpSpan;
+}
+
+} // namespace
+
+FileSpanExporter::FileSpanExporter(const string& path, Format format, size_t batchSize)
+    : format(format)
+    , batchSize(batchSize > 0 ? batchSize : 1)
+    , file(path, ios::out | ios::trunc) {
+    if (!file) {
+        throw runtime_error("Cannot open the trace file '" + path + "'.");
+    }
+    if (format == Format::chromeTrace) {
+        file << "[\n";
+    }
+    batch.reserve(this->batchSize);
+}
+
+FileSpanExporter::~FileSpanExporter() {
+    lock_guard<mutex> lock(exporterMutex);
+    writeBatch();
+    if (format == Format::chromeTrace) {
+        file << "\n]\n";
+    }
+}
+
+void FileSpanExporter::exportSpan(const Span& span) {
+    lock_guard<mutex> lock(exporterMutex);
+    batch.push_back(span);
+    if (batch.size() >= batchSize) {
+        writeBatch();
+    }
+}
+
+void FileSpanExporter::flush() {
+    lock_guard<mutex> lock(exporterMutex);
+    writeBatch();
+    file.flush();
+}
+
+void FileSpanExporter::writeBatch() {
+    if (batch.empty()) {
+        return;
+    }
+
+    if (format == Format::chromeTrace) {
+        for (const auto& span : batch) {
+            file << (firstEvent ? "" : ",\n") << toChromeTraceEvent(span).dump();
+            firstEvent = false;
+        }
+    } else {
+        json spans = json::array();
+        for (const auto& span : batch) {
+            spans.push_back(toOtlpSpan(span));
+        }
+        const json request = {
+            {"resourceSpans", json::array({{
+                {"resource", {{"attributes", json::array({
+                    {{"key", "telemetry.sdk.name"}, {"value", {{"stringValue", "configcat-cpp-sdk"}}}},
+                    {{"key", "telemetry.sdk.version"}, {"value", {{"stringValue", CONFIGCAT_VERSION}}}}
+                })}}},
+                {"scopeSpans", json::array({{
+                    {"scope", {{"name", "configcat"}, {"version", CONFIGCAT_VERSION}}},
+                    {"spans", spans}
+                }})}
+            }})}
+        };
+        file << request.dump() << "\n";
+    }
+    batch.clear();
+}
+
+} // namespace configcat
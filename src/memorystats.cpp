@@ -0,0 +1,35 @@
+#include "configcat/memorystats.h"
+
+#include "utils.h"
+
+using namespace std;
+
+namespace configcat {
+
+namespace {
+
+void appendUsage(string& text, const ConfigMemoryUsage& usage) {
+    text += string_format("  settings:         %zu\n", usage.settings);
+    text += string_format("  segments:         %zu\n", usage.segments);
+    text += string_format("  strings:          %zu\n", usage.strings);
+    text += string_format("  comparison lists: %zu\n", usage.comparisonLists);
+    text += string_format("  indexes:          %zu\n", usage.indexes);
+    text += string_format("  lazy source:      %zu\n", usage.lazySource);
+}
+
+} // namespace
+
+string MemoryStats::toString() const {
+    string text = string_format("Total: %zu bytes\n", totalBytes());
+    text += string_format("Config in use: %zu bytes\n", config.total());
+    appendUsage(text, config);
+    text += string_format("Config JSON string: %zu bytes\n", configJsonString);
+    text += string_format("Cached entry string: %zu bytes\n", cachedEntryString);
+    text += string_format("Retired snapshots still referenced: %zu (%zu bytes)\n", retiredSnapshots, retiredSnapshotsMemory.total());
+    if (retiredSnapshots > 0) {
+        appendUsage(text, retiredSnapshotsMemory);
+    }
+    return text;
+}
+
+} // namespace configcat
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Helpers for estimating the heap memory held by the standard containers (see `ConfigCatClient::memoryStats`).
+// The figures are estimates: the allocator's own bookkeeping and the implementation-specific details of the containers
+// are approximated, but they are stable enough to compare configs and to track the growth over time.
+
+namespace configcat {
+
+// The reference counts (and the vtable pointer) of a `std::make_shared` allocation.
+constexpr size_t kSharedControlBlockBytes = sizeof(void*) + 2 * sizeof(int);
+
+// The character data allocated by the string, 0 when the string fits in its small string buffer.
+inline size_t stringHeapBytes(const std::string& s) {
+    const auto data = s.data();
+    const auto object = reinterpret_cast<const char*>(&s);
+    const bool isInline = object <= data && data < object + sizeof(std::string);
+    return isInline ? 0 : s.capacity() + 1;
+}
+
+// The bucket array and the per-node links of the hash table, i.e. its memory without the elements themselves.
+template<typename Map>
+size_t hashTableIndexBytes(const Map& map) {
+    // Each node holds the next pointer and the cached hash code besides the element.
+    return map.bucket_count() * sizeof(void*) + map.size() * (sizeof(void*) + sizeof(size_t));
+}
+
+} // namespace configcat
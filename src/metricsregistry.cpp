@@ -0,0 +1,214 @@
+#include "metricsregistry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "utils.h"
+
+using namespace std;
+
+namespace configcat {
+
+namespace {
+
+// Bucket upper bounds in seconds.
+const vector<double> kEvaluationLatencyBounds = {0.000001, 0.0000025, 0.000005, 0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.005};
+const vector<double> kFetchLatencyBounds = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30};
+const vector<double> kCacheLatencyBounds = {0.00001, 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1};
+
+const string kNoVariationId;
+
+double toSeconds(chrono::nanoseconds duration) {
+    return chrono::duration<double>(duration).count();
+}
+
+} // namespace
+
+MetricsRegistry::Histogram::Histogram(const vector<double>& upperBounds)
+    : upperBounds(upperBounds)
+    , bucketCounts(upperBounds.size() + 1) {
+}
+
+void MetricsRegistry::Histogram::observe(chrono::nanoseconds duration) {
+    const auto seconds = toSeconds(duration);
+    const auto bucket = lower_bound(upperBounds.begin(), upperBounds.end(), seconds) - upperBounds.begin();
+    ++bucketCounts[static_cast<size_t>(bucket)];
+    ++count;
+    sum += seconds;
+}
+
+void MetricsRegistry::Histogram::mergeInto(HistogramSnapshot& snapshot) const {
+    if (snapshot.upperBounds.empty()) {
+        snapshot.upperBounds = upperBounds;
+        snapshot.bucketCounts.assign(bucketCounts.size(), 0);
+    }
+    for (size_t i = 0; i < bucketCounts.size(); ++i) {
+        snapshot.bucketCounts[i] += bucketCounts[i];
+    }
+    snapshot.count += count;
+    snapshot.sum += sum;
+}
+
+MetricsRegistry::Recordings::Recordings()
+    : evaluationLatency(kEvaluationLatencyBounds)
+    , fetchLatency(kFetchLatencyBounds)
+    , cacheReadLatency(kCacheLatencyBounds)
+    , cacheWriteLatency(kCacheLatencyBounds) {
+}
+
+void MetricsRegistry::recordEvaluation(const string& key, const optional<string>& variationId, chrono::nanoseconds latency) {
+    const string& variation = variationId ? *variationId : kNoVariationId;
+    recordings.record([&](Recordings& shard) {
+        // Looked up before inserting, so the steady state doesn't allocate.
+        auto keyIt = shard.evaluations.find(key);
+        if (keyIt == shard.evaluations.end()) {
+            keyIt = shard.evaluations.emplace(key, map<string, uint64_t, less<>>()).first;
+        }
+        auto& variations = keyIt->second;
+        auto variationIt = variations.find(variation);
+        if (variationIt == variations.end()) {
+            variationIt = variations.emplace(variation, 0).first;
+        }
+        ++variationIt->second;
+        shard.evaluationLatency.observe(latency);
+    });
+}
+
+void MetricsRegistry::recordError(int eventId) {
+    recordings.record([&](Recordings& shard) { ++shard.errors[eventId]; });
+}
+
+void MetricsRegistry::recordFetch(FetchOutcome outcome, chrono::nanoseconds latency) {
+    recordings.record([&](Recordings& shard) {
+        ++shard.fetches[static_cast<size_t>(outcome)];
+        shard.fetchLatency.observe(latency);
+    });
+}
+
+void MetricsRegistry::recordCacheRead(chrono::nanoseconds latency) {
+    recordings.record([&](Recordings& shard) { shard.cacheReadLatency.observe(latency); });
+}
+
+void MetricsRegistry::recordCacheWrite(chrono::nanoseconds latency) {
+    recordings.record([&](Recordings& shard) { shard.cacheWriteLatency.observe(latency); });
+}
+
+MetricsSnapshot MetricsRegistry::snapshot() const {
+    MetricsSnapshot snapshot;
+    recordings.forEachShard([&](const Recordings& shard) {
+        for (const auto& [key, variations] : shard.evaluations) {
+            auto& merged = snapshot.evaluations[key];
+            for (const auto& [variationId, count] : variations) {
+                merged[variationId] += count;
+            }
+        }
+        for (const auto& [eventId, count] : shard.errors) {
+            snapshot.errors[eventId] += count;
+        }
+        snapshot.fetchesModified += shard.fetches[static_cast<size_t>(FetchOutcome::modified)];
+        snapshot.fetchesNotModified += shard.fetches[static_cast<size_t>(FetchOutcome::notModified)];
+        snapshot.fetchesFailed += shard.fetches[static_cast<size_t>(FetchOutcome::failed)];
+        shard.evaluationLatency.mergeInto(snapshot.evaluationLatency);
+        shard.fetchLatency.mergeInto(snapshot.fetchLatency);
+        shard.cacheReadLatency.mergeInto(snapshot.cacheReadLatency);
+        shard.cacheWriteLatency.mergeInto(snapshot.cacheWriteLatency);
+    });
+    return snapshot;
+}
+
+namespace {
+
+string escapeLabelValue(const string& value) {
+    string escaped;
+    escaped.reserve(value.size());
+    for (const char c : value) {
+        switch (c) {
+            case '\\': escaped += "\\\\"; break;
+            case '"': escaped += "\\\""; break;
+            case '\n': escaped += "\\n"; break;
+            default: escaped += c; break;
+        }
+    }
+    return escaped;
+}
+
+string formatNumber(double value) {
+    if (isnan(value)) {
+        return "NaN";
+    }
+    if (isinf(value)) {
+        return value > 0 ? "+Inf" : "-Inf";
+    }
+    // The shortest form which reads back as the same value, e.g. 1e-06 instead of 9.9999999999999995e-07.
+    string text;
+    for (int precision = 15; precision <= 17; ++precision) {
+        text = string_format("%.*g", precision, value);
+        if (strtod(text.c_str(), nullptr) == value) {
+            break;
+        }
+    }
+    return text;
+}
+
+void appendHeader(string& text, const string& name, const char* type, const char* help) {
+    text += "# HELP " + name + " " + help + "\n";
+    text += "# TYPE " + name + " " + type + "\n";
+}
+
+void appendHistogram(string& text, const string& name, const char* help, const HistogramSnapshot& histogram) {
+    appendHeader(text, name, "histogram", help);
+    uint64_t cumulativeCount = 0;
+    for (size_t i = 0; i < histogram.bucketCounts.size(); ++i) {
+        cumulativeCount += histogram.bucketCounts[i];
+        const auto bound = i < histogram.upperBounds.size() ? formatNumber(histogram.upperBounds[i]) : string("+Inf");
+        text += name + "_bucket{le=\"" + bound + "\"} " + to_string(cumulativeCount) + "\n";
+    }
+    if (histogram.bucketCounts.empty()) {
+        text += name + "_bucket{le=\"+Inf\"} 0\n";
+    }
+    text += name + "_sum " + formatNumber(histogram.sum) + "\n";
+    text += name + "_count " + to_string(histogram.count) + "\n";
+}
+
+} // namespace
+
+string MetricsSnapshot::toPrometheusText(const string& prefix) const {
+    string text;
+
+    const auto evaluationsName = prefix + "_evaluations_total";
+    appendHeader(text, evaluationsName, "counter", "Number of feature flag and setting evaluations.");
+    for (const auto& [key, variations] : evaluations) {
+        for (const auto& [variationId, count] : variations) {
+            text += evaluationsName + "{key=\"" + escapeLabelValue(key) + "\",variation_id=\"" + escapeLabelValue(variationId) + "\"} "
+                + to_string(count) + "\n";
+        }
+    }
+
+    const auto errorsName = prefix + "_errors_total";
+    appendHeader(text, errorsName, "counter", "Number of errors by log event ID.");
+    for (const auto& [eventId, count] : errors) {
+        text += errorsName + "{event_id=\"" + to_string(eventId) + "\"} " + to_string(count) + "\n";
+    }
+
+    appendHistogram(text, prefix + "_evaluation_duration_seconds", "Duration of the evaluations.", evaluationLatency);
+
+    const auto fetchesName = prefix + "_fetches_total";
+    appendHeader(text, fetchesName, "counter", "Number of config fetches by result.");
+    text += fetchesName + "{result=\"modified\"} " + to_string(fetchesModified) + "\n";
+    text += fetchesName + "{result=\"not_modified\"} " + to_string(fetchesNotModified) + "\n";
+    text += fetchesName + "{result=\"failed\"} " + to_string(fetchesFailed) + "\n";
+
+    appendHistogram(text, prefix + "_fetch_duration_seconds", "Duration of the config fetches.", fetchLatency);
+
+    const auto configAgeName = prefix + "_config_age_seconds";
+    appendHeader(text, configAgeName, "gauge", "Time since the config in use was fetched.");
+    text += configAgeName + " " + formatNumber(configAgeSeconds) + "\n";
+
+    appendHistogram(text, prefix + "_cache_read_duration_seconds", "Duration of the config cache reads.", cacheReadLatency);
+    appendHistogram(text, prefix + "_cache_write_duration_seconds", "Duration of the config cache writes.", cacheWriteLatency);
+
+    return text;
+}
+
+} // namespace configcat
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "configcat/config.h"
+#include "configcat/metrics.h"
+#include "shardedrecorder.h"
+
+namespace configcat {
+
+// Collects the metrics of a client. The recordings go to the shard of the calling thread, so the threads evaluating
+// concurrently don't contend; the shards are only merged when a snapshot is taken.
+class MetricsRegistry {
+public:
+    enum class FetchOutcome { modified, notModified, failed };
+
+    void recordEvaluation(const std::string& key, const std::optional<std::string>& variationId, std::chrono::nanoseconds latency);
+    void recordError(int eventId);
+    void recordFetch(FetchOutcome outcome, std::chrono::nanoseconds latency);
+    void recordCacheRead(std::chrono::nanoseconds latency);
+    void recordCacheWrite(std::chrono::nanoseconds latency);
+
+    // The config age is not recorded, the caller sets it on the snapshot.
+    MetricsSnapshot snapshot() const;
+
+private:
+    class Histogram {
+    public:
+        explicit Histogram(const std::vector<double>& upperBounds);
+        void observe(std::chrono::nanoseconds duration);
+        void mergeInto(HistogramSnapshot& snapshot) const;
+
+    private:
+        const std::vector<double>& upperBounds;
+        std::vector<uint64_t> bucketCounts;
+        uint64_t count = 0;
+        double sum = 0;
+    };
+
+    struct Recordings {
+        Recordings();
+
+        std::map<std::string, std::map<std::string, uint64_t, std::less<>>, std::less<>> evaluations;
+        std::map<int, uint64_t> errors;
+        Histogram evaluationLatency;
+        std::array<uint64_t, 3> fetches{};
+        Histogram fetchLatency;
+        Histogram cacheReadLatency;
+        Histogram cacheWriteLatency;
+    };
+
+    ShardedRecorder<Recordings> recordings;
+};
+
+} // namespace configcat
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+
+// std::pmr is not available on every standard library we support (e.g. older Apple libc++), so we fall back to
+// the global heap on those platforms.
+#if defined(__cpp_lib_memory_resource)
+#define CONFIGCAT_PARSE_ARENA_ENABLED
+#endif
+
+namespace configcat {
+
+#ifdef CONFIGCAT_PARSE_ARENA_ENABLED
+
+// Scope in which the JSON DOM built while parsing a config.json is allocated from a single monotonic buffer.
+// The buffer is released in one step when the scope ends, so the thousands of small DOM nodes are neither
+// malloc'ed nor free'd individually on the polling thread. (Only the temporary DOM lives in the arena, the parsed
+// `Config` is allocated from the global heap, as it outlives the parse.)
+// Everything allocated with `ArenaAllocator` inside the scope must be destroyed before the scope ends, which is
+// asserted on destruction. Memory allocated outside the scope (or in an outer scope) may be released inside it.
+class ParseArena {
+public:
+    explicit ParseArena(size_t initialSize = 0)
+        : resource(initialSize > 0 ? initialSize : kDefaultInitialSize)
+        , previous(current) {
+        current = this;
+    }
+
+    ~ParseArena() {
+        assert(outstandingAllocations == 0 && "A value allocated from the parse arena outlived its scope.");
+        current = previous;
+    }
+
+    ParseArena(const ParseArena&) = delete;
+    ParseArena& operator=(const ParseArena&) = delete;
+
+    // Each block is prefixed with a header recording its arena, so it's always released to the resource it came
+    // from, regardless of the arena active at the time of release.
+    static void* allocate(size_t bytes, size_t alignment) {
+        const auto headerAlignment = alignment > kHeaderSize ? alignment : kHeaderSize;
+        auto arena = current;
+        auto block = static_cast<std::byte*>(arena
+            ? arena->resource.allocate(bytes + headerAlignment, headerAlignment)
+            : std::pmr::new_delete_resource()->allocate(bytes + headerAlignment, headerAlignment));
+        if (arena) {
+            ++arena->outstandingAllocations;
+        }
+        auto data = block + headerAlignment;
+        *reinterpret_cast<ParseArena**>(data - sizeof(ParseArena*)) = arena;
+        return data;
+    }
+
+    static void deallocate(void* p, size_t bytes, size_t alignment) noexcept {
+        const auto headerAlignment = alignment > kHeaderSize ? alignment : kHeaderSize;
+        auto data = static_cast<std::byte*>(p);
+        auto arena = *reinterpret_cast<ParseArena**>(data - sizeof(ParseArena*));
+        auto block = data - headerAlignment;
+        if (arena) {
+            --arena->outstandingAllocations;
+            arena->resource.deallocate(block, bytes + headerAlignment, headerAlignment);
+        } else {
+            std::pmr::new_delete_resource()->deallocate(block, bytes + headerAlignment, headerAlignment);
+        }
+    }
+
+private:
+    static constexpr size_t kDefaultInitialSize = 16 * 1024;
+    static constexpr size_t kHeaderSize = alignof(std::max_align_t);
+
+    static inline thread_local ParseArena* current = nullptr;
+
+    std::pmr::monotonic_buffer_resource resource;
+    ParseArena* previous;
+    size_t outstandingAllocations = 0;
+};
+
+// Stateless allocator (nlohmann::json default-constructs its allocators) which allocates from the parse arena of
+// the current thread or from the global heap when there is no active arena.
+template<typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    ArenaAllocator() noexcept = default;
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(ParseArena::allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        ParseArena::deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>&) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>&) const noexcept { return false; }
+};
+
+#else
+
+class ParseArena {
+public:
+    explicit ParseArena(size_t initialSize = 0) {}
+
+    ParseArena(const ParseArena&) = delete;
+    ParseArena& operator=(const ParseArena&) = delete;
+};
+
+template<typename T>
+using ArenaAllocator = std::allocator<T>;
+
+#endif // CONFIGCAT_PARSE_ARENA_ENABLED
+
+} // namespace configcat
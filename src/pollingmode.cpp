@@ -12,8 +12,12 @@ shared_ptr<PollingMode> PollingMode::autoPoll(uint32_t autoPollIntervalInSeconds
     );
 }
 
-shared_ptr<PollingMode> PollingMode::lazyLoad(uint32_t cacheRefreshIntervalInSeconds) {
-    return shared_ptr<LazyLoadingMode>(new LazyLoadingMode(cacheRefreshIntervalInSeconds));
+shared_ptr<PollingMode> PollingMode::lazyLoad(uint32_t cacheRefreshIntervalInSeconds,
+                                              bool staleWhileRevalidate,
+                                              uint32_t maxStalenessInSeconds) {
+    return shared_ptr<LazyLoadingMode>(
+        new LazyLoadingMode(cacheRefreshIntervalInSeconds, staleWhileRevalidate, maxStalenessInSeconds)
+    );
 }
 
 shared_ptr<PollingMode> PollingMode::manualPoll() {
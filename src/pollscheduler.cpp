@@ -0,0 +1,336 @@
+#include "pollscheduler.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+namespace configcat {
+
+class PollScheduler::Timer {
+public:
+    Timer(function<void()> task, uint64_t intervalTicks, function<chrono::milliseconds()> nextInterval = nullptr)
+        : task(std::move(task)), intervalTicks(intervalTicks), nextInterval(std::move(nextInterval)) {}
+
+    function<void()> task;
+    const uint64_t intervalTicks;
+    function<chrono::milliseconds()> nextInterval;
+    uint64_t expiryTick = 0;
+    bool cancelled = false;
+    bool running = false;
+    thread::id runningThread;
+};
+
+weak_ptr<PollScheduler> PollScheduler::instance;
+mutex PollScheduler::instanceMutex;
+size_t PollScheduler::workerCount = PollScheduler::kDefaultWorkerCount;
+
+shared_ptr<PollScheduler> PollScheduler::getInstance() {
+    lock_guard<mutex> lock(instanceMutex);
+    auto scheduler = instance.lock();
+    if (!scheduler) {
+        scheduler = shared_ptr<PollScheduler>(new PollScheduler(workerCount));
+        instance = scheduler;
+    }
+    return scheduler;
+}
+
+void PollScheduler::setWorkerCount(size_t count) {
+    lock_guard<mutex> lock(instanceMutex);
+    workerCount = min(max<size_t>(count, 1), kMaxWorkerCount);
+}
+
+size_t PollScheduler::getWorkerCount() {
+    lock_guard<mutex> lock(instanceMutex);
+    return workerCount;
+}
+
+PollScheduler::PollScheduler(size_t workerCount) :
+    maxWorkerCount(workerCount),
+    startTime(chrono::steady_clock::now()) {
+    timerThread = thread([this] { runTimer(); });
+    workerThreads.reserve(maxWorkerCount);
+    // The rest of the workers are started when they're needed.
+    lock_guard<mutex> lock(schedulerMutex);
+    startWorker();
+}
+
+PollScheduler::~PollScheduler() {
+    {
+        lock_guard<mutex> lock(schedulerMutex);
+        stopRequested = true;
+    }
+    timerCondition.notify_all();
+    workerCondition.notify_all();
+
+    // The last reference may be released by a task, then the worker running it can't be joined. It finishes on its own
+    // without accessing the scheduler.
+    timerThread.join();
+    for (auto& workerThread : workerThreads) {
+        if (workerThread.get_id() == this_thread::get_id()) {
+            destroyedOnThisThread() = true;
+            workerThread.detach();
+        } else {
+            workerThread.join();
+        }
+    }
+    for (auto& workerThread : exitedWorkerThreads) {
+        workerThread.join();
+    }
+}
+
+bool& PollScheduler::destroyedOnThisThread() {
+    static thread_local bool destroyed = false;
+    return destroyed;
+}
+
+shared_ptr<PollScheduler::Timer> PollScheduler::schedule(function<void()> task,
+                                                         chrono::milliseconds initialDelay,
+                                                         chrono::milliseconds interval) {
+    return add(make_shared<Timer>(std::move(task), max<uint64_t>(toTicks(interval), 1)), initialDelay);
+}
+
+shared_ptr<PollScheduler::Timer> PollScheduler::schedule(function<void()> task,
+                                                         chrono::milliseconds initialDelay,
+                                                         function<chrono::milliseconds()> nextInterval) {
+    // The interval ticks only mark the timer periodic, the actual interval is computed after each run.
+    return add(make_shared<Timer>(std::move(task), 1, std::move(nextInterval)), initialDelay);
+}
+
+shared_ptr<PollScheduler::Timer> PollScheduler::scheduleOnce(function<void()> task, chrono::milliseconds delay) {
+    // A zero interval marks a one-shot timer.
+    return add(make_shared<Timer>(std::move(task), 0), delay);
+}
+
+shared_ptr<PollScheduler::Timer> PollScheduler::add(const shared_ptr<Timer>& timer, chrono::milliseconds initialDelay) {
+    {
+        lock_guard<mutex> lock(schedulerMutex);
+        const auto now = nowTick();
+        // The timer thread sleeps without advancing the wheel while it's empty.
+        if (wheelTimerCount == 0 && currentTick < now) {
+            currentTick = now;
+        }
+        // The current tick is partially elapsed, so the expiry is one tick later to never fire earlier than requested.
+        timer->expiryTick = initialDelay.count() > 0 ? now + 1 + toTicks(initialDelay) : now;
+        ++activeTimerCount;
+        insert(timer);
+    }
+    // The new timer may expire sooner than the planned wake-up of the timer thread.
+    timerCondition.notify_one();
+    return timer;
+}
+
+void PollScheduler::cancel(const shared_ptr<Timer>& timer) {
+    unique_lock<mutex> lock(schedulerMutex);
+    if (!timer || timer->cancelled) {
+        return;
+    }
+
+    timer->cancelled = true;
+    --activeTimerCount;
+
+    // The task may cancel its own timer, that must not wait for itself.
+    if (timer->running && timer->runningThread != this_thread::get_id()) {
+        finishedCondition.wait(lock, [&] { return !timer->running; });
+    }
+
+    // A cancelled timer may stay in the wheel until its slot expires, release what the task captured right away.
+    if (!timer->running) {
+        timer->task = nullptr;
+        timer->nextInterval = nullptr;
+    }
+}
+
+size_t PollScheduler::timerCount() const {
+    lock_guard<mutex> lock(schedulerMutex);
+    return activeTimerCount;
+}
+
+uint64_t PollScheduler::nowTick() const {
+    return static_cast<uint64_t>((chrono::steady_clock::now() - startTime) / kTickDuration);
+}
+
+uint64_t PollScheduler::toTicks(chrono::milliseconds duration) const {
+    // Round up, so the timer never expires earlier than requested.
+    return static_cast<uint64_t>((duration + kTickDuration - chrono::milliseconds(1)) / kTickDuration);
+}
+
+void PollScheduler::insert(const shared_ptr<Timer>& timer) {
+    if (timer->expiryTick <= currentTick) {
+        dueTimers.push_back(timer);
+        // The busy workers may be blocked by fetches for long, the due task shouldn't wait for them.
+        if (idleWorkerCount < dueTimers.size() && workerThreads.size() < maxWorkerCount && !stopRequested) {
+            startWorker();
+        }
+        workerCondition.notify_one();
+        return;
+    }
+
+    // Level N holds the timers expiring in less than 64^(N+1) ticks, bucketed by the N-th 6-bit digit of the expiry tick.
+    const uint64_t delta = timer->expiryTick - currentTick;
+    size_t level = 0;
+    while (level < kLevelCount - 1 && delta >= (uint64_t(1) << (kSlotBits * (level + 1)))) {
+        ++level;
+    }
+
+    // Timers beyond the range of the wheel are parked in the farthest slot and placed again when it gets cascaded.
+    const uint64_t maxDelta = (uint64_t(1) << (kSlotBits * kLevelCount)) - 1;
+    const uint64_t slotTick = delta > maxDelta ? currentTick + maxDelta : timer->expiryTick;
+
+    wheel[level][(slotTick >> (kSlotBits * level)) & kSlotMask].push_back(timer);
+    ++wheelTimerCount;
+}
+
+void PollScheduler::advanceTo(uint64_t tick) {
+    while (currentTick < tick) {
+        ++currentTick;
+
+        // When the lower digits wrap around, the timers of the current slot of the upper levels move down.
+        // The upper levels go first, so a timer cascaded from there lands in a slot that is not processed yet.
+        size_t cascadeLevel = 0;
+        while (cascadeLevel + 1 < kLevelCount && (currentTick & ((uint64_t(1) << (kSlotBits * (cascadeLevel + 1))) - 1)) == 0) {
+            ++cascadeLevel;
+        }
+        for (size_t level = cascadeLevel; level > 0; --level) {
+            Slot timers;
+            timers.swap(wheel[level][(currentTick >> (kSlotBits * level)) & kSlotMask]);
+            wheelTimerCount -= timers.size();
+            for (const auto& timer : timers) {
+                if (!timer->cancelled) {
+                    insert(timer);
+                }
+            }
+        }
+
+        Slot timers;
+        timers.swap(wheel[0][currentTick & kSlotMask]);
+        wheelTimerCount -= timers.size();
+        for (const auto& timer : timers) {
+            if (!timer->cancelled) {
+                insert(timer);
+            }
+        }
+    }
+}
+
+uint64_t PollScheduler::nextWakeupTick() const {
+    if (wheelTimerCount == 0) {
+        return numeric_limits<uint64_t>::max();
+    }
+
+    // Wake up at the next non-empty slot of the first level, or at the next cascade at the latest.
+    const uint64_t nextCascadeTick = (currentTick | kSlotMask) + 1;
+    for (uint64_t tick = currentTick + 1; tick < nextCascadeTick; ++tick) {
+        if (!wheel[0][tick & kSlotMask].empty()) {
+            return tick;
+        }
+    }
+    return nextCascadeTick;
+}
+
+void PollScheduler::startWorker() {
+    // The exited workers have released the lock already, so they can be joined under it.
+    for (auto& workerThread : exitedWorkerThreads) {
+        workerThread.join();
+    }
+    exitedWorkerThreads.clear();
+    workerThreads.emplace_back([this] { runWorker(); });
+}
+
+void PollScheduler::exitWorker() {
+    const auto it = find_if(workerThreads.begin(), workerThreads.end(),
+                            [](const thread& workerThread) { return workerThread.get_id() == this_thread::get_id(); });
+    exitedWorkerThreads.push_back(std::move(*it));
+    workerThreads.erase(it);
+}
+
+void PollScheduler::runTimer() {
+    unique_lock<mutex> lock(schedulerMutex);
+    while (!stopRequested) {
+        advanceTo(nowTick());
+
+        const auto wakeupTick = nextWakeupTick();
+        if (wakeupTick == numeric_limits<uint64_t>::max()) {
+            timerCondition.wait(lock);
+        } else {
+            timerCondition.wait_until(lock, startTime + wakeupTick * kTickDuration);
+        }
+    }
+}
+
+void PollScheduler::runWorker() {
+    unique_lock<mutex> lock(schedulerMutex);
+    while (true) {
+        ++idleWorkerCount;
+        const bool due = workerCondition.wait_for(lock, kWorkerIdleTimeout, [&] { return stopRequested || !dueTimers.empty(); });
+        --idleWorkerCount;
+        if (stopRequested) {
+            break;
+        }
+        if (!due) {
+            // The workers added for a burst of due tasks exit once it's over, the first one stays.
+            if (workerThreads.size() > 1) {
+                exitWorker();
+                return;
+            }
+            continue;
+        }
+
+        auto timer = std::move(dueTimers.front());
+        dueTimers.pop_front();
+        if (timer->cancelled) {
+            continue;
+        }
+
+        timer->running = true;
+        timer->runningThread = this_thread::get_id();
+        lock.unlock();
+
+        // Keeps the scheduler alive while the task runs, the task may release the last reference of it
+        // (nullptr when the scheduler is already being destroyed, which waits for this worker).
+        auto self = weak_from_this().lock();
+
+        try {
+            timer->task();
+        } catch (...) {
+            // The tasks handle their own errors, an escaping exception must not take down the worker.
+        }
+
+        lock.lock();
+        // The task may have cancelled its own timer (e.g. by destroying its client), what `nextInterval` uses may be gone then.
+        // Otherwise a cancellation from another thread waits for the running timer, so its interval can be computed outside
+        // of the lock.
+        uint64_t intervalTicks = timer->intervalTicks;
+        if (!timer->cancelled && timer->nextInterval) {
+            lock.unlock();
+            intervalTicks = max<uint64_t>(toTicks(timer->nextInterval()), 1);
+            lock.lock();
+        }
+        timer->running = false;
+        if (timer->cancelled || timer->intervalTicks == 0) {
+            if (!timer->cancelled) {
+                timer->cancelled = true;
+                --activeTimerCount;
+            }
+            timer->task = nullptr;
+            timer->nextInterval = nullptr;
+            finishedCondition.notify_all();
+        } else {
+            timer->expiryTick = nowTick() + 1 + intervalTicks;
+            insert(timer);
+            timerCondition.notify_one();
+        }
+
+        // Releasing the last reference destroys the scheduler, which needs the lock.
+        if (self) {
+            lock.unlock();
+            self.reset();
+            if (destroyedOnThisThread()) {
+                return;
+            }
+            lock.lock();
+        }
+    }
+}
+
+} // namespace configcat
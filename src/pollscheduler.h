@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace configcat {
+
+// Process-wide scheduler running the periodic tasks (the auto-polling ticks) of every client.
+// The timers are kept in a hierarchical timer wheel driven by a single timer thread, and the due tasks are executed on a
+// small pool of worker threads. So the SDK creates at most `1 + workerCount` threads for auto-polling regardless of the
+// number of clients. The pool starts with a single worker, another one is added when a task is due while all the workers
+// are busy (up to `workerCount`), and the added workers exit after being idle for `kWorkerIdleTimeout`.
+// The scheduler is created on first use and shut down when the last client releases it (even when that happens in one
+// of its tasks).
+class PollScheduler : public std::enable_shared_from_this<PollScheduler> {
+public:
+    class Timer;
+
+    static constexpr std::chrono::milliseconds kTickDuration = std::chrono::milliseconds(10);
+    static constexpr size_t kDefaultWorkerCount = 2;
+    static constexpr size_t kMaxWorkerCount = 16;
+    static constexpr std::chrono::seconds kWorkerIdleTimeout = std::chrono::seconds(60);
+
+    static std::shared_ptr<PollScheduler> getInstance();
+
+    // Sets the maximum number of worker threads of the scheduler (1 to `kMaxWorkerCount`).
+    // Takes effect when the scheduler is (re)created.
+    static void setWorkerCount(size_t workerCount);
+    static size_t getWorkerCount();
+
+    ~PollScheduler();
+
+    PollScheduler(const PollScheduler&) = delete;
+    PollScheduler& operator=(const PollScheduler&) = delete;
+
+    // Runs the task after `initialDelay` and then repeatedly, `interval` after the previous run finished.
+    std::shared_ptr<Timer> schedule(std::function<void()> task,
+                                    std::chrono::milliseconds initialDelay,
+                                    std::chrono::milliseconds interval);
+
+    // Same as above, but the interval is computed by `nextInterval` after each run (e.g. to back off or to add jitter).
+    std::shared_ptr<Timer> schedule(std::function<void()> task,
+                                    std::chrono::milliseconds initialDelay,
+                                    std::function<std::chrono::milliseconds()> nextInterval);
+
+    // Runs the task once after `delay`. Cancelling the timer afterwards is a no-op.
+    std::shared_ptr<Timer> scheduleOnce(std::function<void()> task, std::chrono::milliseconds delay);
+
+    // Cancels the timer. When its task is running on another thread, waits until the task finishes,
+    // so the task is guaranteed not to run after this call returns.
+    void cancel(const std::shared_ptr<Timer>& timer);
+
+    // The number of timers that are scheduled and not cancelled yet.
+    size_t timerCount() const;
+
+private:
+    static constexpr size_t kSlotBits = 6;
+    static constexpr size_t kSlotCount = 1 << kSlotBits;
+    static constexpr uint64_t kSlotMask = kSlotCount - 1;
+    static constexpr size_t kLevelCount = 4;
+
+    using Slot = std::vector<std::shared_ptr<Timer>>;
+
+    explicit PollScheduler(size_t workerCount);
+
+    std::shared_ptr<Timer> add(const std::shared_ptr<Timer>& timer, std::chrono::milliseconds initialDelay);
+
+    uint64_t nowTick() const;
+    uint64_t toTicks(std::chrono::milliseconds duration) const;
+    void insert(const std::shared_ptr<Timer>& timer);
+    void advanceTo(uint64_t tick);
+    uint64_t nextWakeupTick() const;
+    void startWorker();
+    // Removes the calling worker from the pool, it must return right after this.
+    void exitWorker();
+    void runTimer();
+    void runWorker();
+    // Set on the worker thread which destroyed the scheduler, so it stops without touching the scheduler.
+    static bool& destroyedOnThisThread();
+
+    static std::weak_ptr<PollScheduler> instance;
+    static std::mutex instanceMutex;
+    static size_t workerCount;
+
+    const size_t maxWorkerCount;
+
+    const std::chrono::steady_clock::time_point startTime;
+    mutable std::mutex schedulerMutex;
+    std::condition_variable timerCondition;
+    std::condition_variable workerCondition;
+    std::condition_variable finishedCondition;
+    bool stopRequested = false;
+
+    std::array<std::array<Slot, kSlotCount>, kLevelCount> wheel;
+    uint64_t currentTick = 0;
+    size_t wheelTimerCount = 0; // including the cancelled timers that are not yet dropped from the wheel
+    size_t activeTimerCount = 0;
+    std::deque<std::shared_ptr<Timer>> dueTimers;
+    size_t idleWorkerCount = 0;
+
+    std::thread timerThread;
+    std::vector<std::thread> workerThreads;
+    // The workers which exited after being idle, joined when the next worker is started.
+    std::vector<std::thread> exitedWorkerThreads;
+};
+
+} // namespace configcat
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <chrono>
 #include <exception>
 #include <ostream> // must be imported before <semver/semver.hpp>
 #include <sstream>
@@ -33,15 +34,31 @@ static const ValueType& ensureComparisonValue(const UserConditionComparisonValue
     throw runtime_error("Comparison value is missing or invalid.");
 }
 
+// The counters of the evaluation running on the current thread, only set while profiling.
+static thread_local EvaluationCounters* activeCounters = nullptr;
+
+// Concatenates the hash input in a per-thread buffer, which stops allocating once it has grown large enough.
+static const string& hashInput(const string& first, const string& second, const string& third = string()) {
+    thread_local string input;
+    input.assign(first).append(second).append(third);
+    return input;
+}
+
 static string hashComparisonValue(const string& value, const string& configJsonSalt, const string& contextSalt) {
-    return sha256(value + configJsonSalt + contextSalt);
+    if (activeCounters) ++activeCounters->shaComputations;
+    return sha256(hashInput(value, configJsonSalt, contextSalt));
 }
 
-RolloutEvaluator::RolloutEvaluator(const std::shared_ptr<ConfigCatLogger>& logger) :
-    logger(logger) {
+RolloutEvaluator::RolloutEvaluator(const std::shared_ptr<ConfigCatLogger>& logger, const std::shared_ptr<EvaluationProfiler>& profiler) :
+    logger(logger),
+    profiler(profiler) {
 }
 
 EvaluateResult RolloutEvaluator::evaluate(const std::optional<Value>& defaultValue, EvaluateContext& context, std::optional<Value>& returnValue) const {
+    if (profiler && !activeCounters) {
+        return evaluateProfiled(defaultValue, context, returnValue);
+    }
+
     auto& logBuilder = context.logBuilder;
 
     // Building the evaluation log is expensive, so let's not do it if it wouldn't be logged anyway.
@@ -105,6 +122,29 @@ EvaluateResult RolloutEvaluator::evaluate(const std::optional<Value>& defaultVal
     }
 }
 
+EvaluateResult RolloutEvaluator::evaluateProfiled(const std::optional<Value>& defaultValue, EvaluateContext& context, std::optional<Value>& returnValue) const {
+    EvaluationCounters counters;
+    const auto start = chrono::steady_clock::now();
+
+    activeCounters = &counters;
+    try {
+        auto result = evaluate(defaultValue, context, returnValue);
+        activeCounters = nullptr;
+
+        const auto matchedRuleIndex = result.targetingRule
+            ? static_cast<int>(result.targetingRule - context.setting.targetingRules.data())
+            : -1;
+        profiler->record(context.key, counters, matchedRuleIndex, chrono::steady_clock::now() - start);
+        return result;
+    }
+    catch (...) {
+        // The failed evaluations are recorded too, they cost time just as well.
+        activeCounters = nullptr;
+        profiler->record(context.key, counters, -1, chrono::steady_clock::now() - start);
+        throw;
+    }
+}
+
 EvaluateResult RolloutEvaluator::evaluateSetting(EvaluateContext& context) const {
     const auto& targetingRules = context.setting.targetingRules;
     if (!targetingRules.empty()) {
@@ -133,6 +173,8 @@ std::optional<EvaluateResult> RolloutEvaluator::evaluateTargetingRules(const std
     const auto conditionAccessor = std::function([](const ConditionContainer& container) -> const Condition& { return container.condition; });
 
     for (const auto& targetingRule : targetingRules) {
+        if (activeCounters) ++activeCounters->targetingRulesVisited;
+
         const std::vector<ConditionContainer>& conditions = targetingRule.conditions;
 
         const auto isMatchOrError = evaluateConditions(conditions, conditionAccessor, &targetingRule, context.key, context);
@@ -217,7 +259,8 @@ std::optional<EvaluateResult> RolloutEvaluator::evaluatePercentageOptions(const
     const auto userAttributeValuePtr = get_if<string>(percentageOptionsAttributeValuePtr);
     const auto userAttributeValue = userAttributeValuePtr ? string() : userAttributeValueToString(*percentageOptionsAttributeValuePtr);
 
-    auto hash = sha1(context.key + (userAttributeValuePtr ? *userAttributeValuePtr : userAttributeValue));
+    if (activeCounters) ++activeCounters->shaComputations;
+    auto hash = sha1(hashInput(context.key, userAttributeValuePtr ? *userAttributeValuePtr : userAttributeValue));
     const auto hashValue = std::stoul(hash.erase(7), nullptr, 16) % 100;
 
     if (logBuilder) {
@@ -263,6 +306,7 @@ RolloutEvaluator::SuccessOrError RolloutEvaluator::evaluateConditions(const std:
     auto i = 0;
     for (const auto& it : conditions) {
         const ConditionType& condition = conditionAccessor(it);
+        if (activeCounters) ++activeCounters->conditionsVisited;
 
         if (logBuilder) {
             if (i == 0) {
@@ -12,6 +12,7 @@
 #include "configcat/config.h"
 #include "configcat/configcatuser.h"
 #include "evaluatelogbuilder.h"
+#include "evaluationprofiler.h"
 
 namespace configcat {
 
@@ -34,7 +35,7 @@ struct EvaluateContext {
         const std::shared_ptr<ConfigCatUser>& user,
         const std::shared_ptr<Settings>& settings)
         : key(key)
-        , setting(setting)
+        , setting(setting.getDecoded()) // settings of lazily decoded configs are decoded on first evaluation
         , user(user)
         , settings(settings)
         , isMissingUserObjectLogged(false)
@@ -69,7 +70,7 @@ struct EvaluateResult {
 
 class RolloutEvaluator {
 public:
-    RolloutEvaluator(const std::shared_ptr<ConfigCatLogger>& logger);
+    RolloutEvaluator(const std::shared_ptr<ConfigCatLogger>& logger, const std::shared_ptr<EvaluationProfiler>& profiler = nullptr);
 
     // Evaluate the feature flag or setting
     EvaluateResult evaluate(const std::optional<Value>& defaultValue, EvaluateContext& context, std::optional<Value>& returnValue) const;
@@ -78,7 +79,9 @@ private:
     using SuccessOrError = std::variant<bool, std::string>;
 
     std::shared_ptr<ConfigCatLogger> logger;
+    std::shared_ptr<EvaluationProfiler> profiler;
 
+    EvaluateResult evaluateProfiled(const std::optional<Value>& defaultValue, EvaluateContext& context, std::optional<Value>& returnValue) const;
     EvaluateResult evaluateSetting(EvaluateContext& context) const;
     std::optional<EvaluateResult> evaluateTargetingRules(const std::vector<TargetingRule>& targetingRules, EvaluateContext& context) const;
     std::optional<EvaluateResult> evaluatePercentageOptions(const std::vector<PercentageOption>& percentageOptions, const TargetingRule* matchedTargetingRule, EvaluateContext& context) const;
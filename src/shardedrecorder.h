@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+namespace configcat {
+
+// State written on hot paths by many threads and read rarely, e.g. the metrics and the evaluation profile.
+// The recordings go to the shard of the calling thread, so the threads recording concurrently don't contend;
+// the readers visit all the shards.
+template<typename State, size_t kShardCount = 16>
+class ShardedRecorder {
+public:
+    // Calls `update(State&)` with the shard of the calling thread, under the lock of the shard.
+    template<typename Update>
+    void record(Update&& update) {
+        auto& shard = shards[threadShardIndex() % kShardCount];
+        std::lock_guard<std::mutex> lock(shard.shardMutex);
+        update(shard.state);
+    }
+
+    // Calls `visit(const State&)` with each shard, under the lock of the shard.
+    template<typename Visit>
+    void forEachShard(Visit&& visit) const {
+        for (const auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.shardMutex);
+            visit(shard.state);
+        }
+    }
+
+private:
+    // Aligned to the cache line size, so the shards used by different threads don't share cache lines.
+    struct alignas(64) Shard {
+        mutable std::mutex shardMutex;
+        State state;
+    };
+
+    // Each thread gets its own shard (as long as there are not more threads than shards), assigned on first use.
+    static size_t threadShardIndex() {
+        static std::atomic<size_t> nextShardIndex{0};
+        thread_local const size_t shardIndex = nextShardIndex++;
+        return shardIndex;
+    }
+
+    std::array<Shard, kShardCount> shards;
+};
+
+} // namespace configcat
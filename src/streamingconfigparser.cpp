@@ -0,0 +1,204 @@
+#include "streamingconfigparser.h"
+#include "configcat/config.h"
+#include "utils.h"
+
+#include <stdexcept>
+#include <string_view>
+
+using namespace std;
+
+namespace configcat {
+
+static inline bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+StreamingConfigParser::StreamingConfigParser(bool configArena) : configArena(configArena), config(make_shared<Config>()) {
+}
+
+StreamingConfigParser::~StreamingConfigParser() = default;
+
+void StreamingConfigParser::append(const char* data, size_t size) {
+    started = true;
+    text.append(data, size);
+    if (error) {
+        return;
+    }
+
+    // The chunks come from a C callback (of curl), so the error is kept until `finish`.
+    try {
+        scan();
+    } catch (...) {
+        error = current_exception();
+    }
+}
+
+shared_ptr<Config> StreamingConfigParser::finish() {
+    if (!error && state != State::AfterRoot) {
+        try {
+            fail();
+        } catch (...) {
+            error = current_exception();
+        }
+    }
+    if (error) {
+        rethrow_exception(error);
+    }
+
+    config->fixupSaltAndSegments();
+    return config;
+}
+
+void StreamingConfigParser::scan() {
+    while (position < text.size()) {
+        const char c = text[position];
+        switch (state) {
+            case State::BeforeRoot:
+                if (!isWhitespace(c)) {
+                    if (c != '{') fail();
+                    state = State::BeforeKey;
+                    firstMember = true;
+                }
+                break;
+
+            case State::BeforeKey:
+                if (isWhitespace(c)) {
+                    break;
+                }
+                if (c == '}' && firstMember) {
+                    closeObject();
+                    break;
+                }
+                if (c != '"') fail();
+                keyBegin = position;
+                escaped = false;
+                state = State::Key;
+                break;
+
+            case State::Key:
+                if (escaped) {
+                    escaped = false;
+                } else if (c == '\\') {
+                    escaped = true;
+                } else if (c == '"') {
+                    keyEnd = position + 1;
+                    state = State::BeforeColon;
+                }
+                break;
+
+            case State::BeforeColon:
+                if (!isWhitespace(c)) {
+                    if (c != ':') fail();
+                    state = State::BeforeValue;
+                }
+                break;
+
+            case State::BeforeValue:
+                if (isWhitespace(c)) {
+                    break;
+                }
+                // The settings are decoded one by one.
+                if (level == 0 && c == '{' && string_view(text).substr(keyBegin, keyEnd - keyBegin) == "\"f\"") {
+                    level = 1;
+                    state = State::BeforeKey;
+                    firstMember = true;
+                    break;
+                }
+                valueBegin = position;
+                valueDepth = 0;
+                inString = false;
+                escaped = false;
+                state = State::Value;
+                continue; // the first character of the value is scanned as part of it
+
+            case State::Value: {
+                bool consumed = true;
+                if (scanValue(c, consumed)) {
+                    completeValue(consumed ? position + 1 : position);
+                    state = State::AfterValue;
+                    if (!consumed) {
+                        continue;
+                    }
+                }
+                break;
+            }
+
+            case State::AfterValue:
+                if (isWhitespace(c)) {
+                    break;
+                }
+                if (c == ',') {
+                    state = State::BeforeKey;
+                    firstMember = false;
+                } else if (c == '}') {
+                    closeObject();
+                } else {
+                    fail();
+                }
+                break;
+
+            case State::AfterRoot:
+                // Nothing but whitespace may follow the config object.
+                if (!isWhitespace(c)) fail();
+                break;
+        }
+        ++position;
+    }
+}
+
+void StreamingConfigParser::closeObject() {
+    if (level == 1) {
+        level = 0;
+        state = State::AfterValue;
+        firstMember = false;
+    } else {
+        state = State::AfterRoot;
+    }
+}
+
+bool StreamingConfigParser::scanValue(char c, bool& consumed) {
+    if (inString) {
+        if (escaped) {
+            escaped = false;
+        } else if (c == '\\') {
+            escaped = true;
+        } else if (c == '"') {
+            inString = false;
+            return valueDepth == 0;
+        }
+        return false;
+    }
+
+    if (c == '"') {
+        inString = true;
+    } else if (c == '{' || c == '[') {
+        ++valueDepth;
+    } else if (c == '}' || c == ']') {
+        if (valueDepth == 0) {
+            // Closes the enclosing object, which ends a number or a literal.
+            consumed = false;
+            return true;
+        }
+        return --valueDepth == 0;
+    } else if (valueDepth == 0 && (c == ',' || isWhitespace(c))) {
+        consumed = false;
+        return true;
+    }
+    return false;
+}
+
+void StreamingConfigParser::completeValue(size_t end) {
+    const auto key = string_view(text).substr(keyBegin, keyEnd - keyBegin);
+    const auto value = string_view(text).substr(valueBegin, end - valueBegin);
+    if (level == 0) {
+        config->decodeMember(key, value, configArena);
+    } else {
+        config->decodeSetting(key, value, configArena);
+    }
+}
+
+void StreamingConfigParser::fail() const {
+    throw runtime_error(string_format("Config JSON is invalid (unexpected character or end of input at position %zu).", position));
+}
+
+} // namespace configcat
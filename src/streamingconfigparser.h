@@ -0,0 +1,78 @@
+#pragma once
+
+#include <exception>
+#include <memory>
+#include <string>
+
+namespace configcat {
+
+struct Config;
+
+// Parses the config.json while its chunks are still arriving, so the parse overlaps the download instead of starting
+// after it. The chunks are scanned on the thread delivering them (e.g. in the curl write callback), and each member of
+// the config (or each setting of the settings object) is decoded as soon as it's complete. So the DOM of a single
+// setting exists at a time instead of that of the whole config. The text is collected as well, as it's needed for the
+// cache and for detecting unchanged content.
+class StreamingConfigParser {
+public:
+    // When `configArena` is true, the DOM of each member is allocated from a parse arena (see `ConfigCatOptions::configArena`).
+    explicit StreamingConfigParser(bool configArena = false);
+    ~StreamingConfigParser();
+
+    StreamingConfigParser(const StreamingConfigParser&) = delete;
+    StreamingConfigParser& operator=(const StreamingConfigParser&) = delete;
+
+    // Feeds the next chunk of the body to the parser. A parse error is reported by `finish`.
+    void append(const char* data, size_t size);
+
+    // Whether any chunk was received.
+    bool isStarted() const { return started; }
+
+    // Signals the end of the body and returns the parsed config. Rethrows the parse error.
+    std::shared_ptr<Config> finish();
+
+    // The received body, valid after `finish`.
+    std::string& getText() { return text; }
+
+private:
+    enum class State {
+        BeforeRoot,
+        BeforeKey,
+        Key,
+        BeforeColon,
+        BeforeValue,
+        Value,
+        AfterValue,
+        AfterRoot
+    };
+
+    void scan();
+    // Closes the config object or its settings object.
+    void closeObject();
+    // Scans a character of a member value, returns true if it completed the value (a number or a literal is completed by
+    // the character following it, which is not consumed).
+    bool scanValue(char c, bool& consumed);
+    void completeValue(size_t end);
+    [[noreturn]] void fail() const;
+
+    const bool configArena;
+    std::shared_ptr<Config> config;
+    std::exception_ptr error;
+    bool started = false;
+
+    std::string text;
+    size_t position = 0;
+    State state = State::BeforeRoot;
+    // 0 while scanning the members of the config object, 1 within its settings object.
+    int level = 0;
+    bool firstMember = true;
+    size_t keyBegin = 0;
+    size_t keyEnd = 0;
+    size_t valueBegin = 0;
+    // The nesting depth within the current value, and whether it's in a string (after an escape character).
+    int valueDepth = 0;
+    bool inString = false;
+    bool escaped = false;
+};
+
+} // namespace configcat
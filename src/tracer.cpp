@@ -0,0 +1,168 @@
+#include "tracer.h"
+
+#include <atomic>
+#include <random>
+
+using namespace std;
+
+namespace configcat {
+
+namespace {
+
+// The span context of the calling thread, which becomes the parent of the spans started on it.
+thread_local SpanContext threadContext;
+
+atomic<uint32_t> nextThreadId{1};
+
+mt19937_64& randomGenerator() {
+    thread_local mt19937_64 generator(random_device{}());
+    return generator;
+}
+
+uint64_t generateId() {
+    uint64_t id;
+    do {
+        id = randomGenerator()();
+    } while (id == 0); // 0 means no ID
+    return id;
+}
+
+uint32_t currentThreadId() {
+    thread_local const uint32_t threadId = nextThreadId++;
+    return threadId;
+}
+
+} // namespace
+
+TraceSpan::TraceSpan(TraceSpan&& other) noexcept
+    : exporter(std::move(other.exporter))
+    , span(std::move(other.span))
+    , start(other.start) {
+    other.exporter.reset();
+}
+
+TraceSpan& TraceSpan::operator=(TraceSpan&& other) noexcept {
+    if (this != &other) {
+        end();
+        exporter = std::move(other.exporter);
+        span = std::move(other.span);
+        start = other.start;
+        other.exporter.reset();
+    }
+    return *this;
+}
+
+TraceSpan::~TraceSpan() {
+    end();
+}
+
+SpanContext TraceSpan::context() const {
+    return exporter ? SpanContext{ span.traceIdHigh, span.traceIdLow, span.spanId } : SpanContext();
+}
+
+void TraceSpan::setAttribute(const string& key, const string& value) {
+    if (exporter) {
+        span.attributes[key] = value;
+    }
+}
+
+void TraceSpan::end() {
+    if (!exporter) {
+        return;
+    }
+
+    span.duration = chrono::steady_clock::now() - start;
+    const auto spanExporter = std::move(exporter);
+    exporter.reset();
+    try {
+        spanExporter->exportSpan(span);
+    } catch (...) {
+        // A failing exporter must not break the traced operation.
+    }
+}
+
+void TraceSpan::discard() {
+    exporter.reset();
+}
+
+Tracer::Tracer(const shared_ptr<SpanExporter>& exporter, double evaluationSampleRate)
+    : exporter(exporter)
+    , evaluationSampleRate(evaluationSampleRate) {
+}
+
+TraceSpan Tracer::startSpan(const char* name) const {
+    return startSpan(name, threadContext, chrono::system_clock::now(), chrono::steady_clock::now());
+}
+
+TraceSpan Tracer::startSpan(const char* name, const SpanContext& parentContext, chrono::system_clock::time_point startTime,
+                            chrono::steady_clock::time_point start) const {
+    TraceSpan traceSpan;
+    traceSpan.exporter = exporter;
+
+    auto& span = traceSpan.span;
+    span.name = name;
+    if (parentContext.spanId != 0) {
+        span.traceIdHigh = parentContext.traceIdHigh;
+        span.traceIdLow = parentContext.traceIdLow;
+        span.parentSpanId = parentContext.spanId;
+    } else {
+        span.traceIdHigh = generateId();
+        span.traceIdLow = generateId();
+    }
+    span.spanId = generateId();
+    span.threadId = currentThreadId();
+    span.startTime = startTime;
+    traceSpan.start = start;
+    return traceSpan;
+}
+
+SpanContext Tracer::activeContext() {
+    return threadContext;
+}
+
+bool Tracer::sampleEvaluation() const {
+    if (evaluationSampleRate <= 0) {
+        return false;
+    }
+    if (evaluationSampleRate >= 1) {
+        return true;
+    }
+    return uniform_real_distribution<double>(0, 1)(randomGenerator()) < evaluationSampleRate;
+}
+
+DeferredSpan::DeferredSpan(const shared_ptr<Tracer>& tracer, const char* name, DeferredSpan* parent)
+    : tracer(tracer.get())
+    , name(name)
+    , parent(parent) {
+    if (tracer) {
+        if (!parent) {
+            parentContext = threadContext;
+        }
+        startTime = chrono::system_clock::now();
+        steadyStart = chrono::steady_clock::now();
+    }
+}
+
+TraceSpan& DeferredSpan::start() {
+    if (tracer && !started) {
+        started = true;
+        span = tracer->startSpan(name, parent ? parent->start().context() : parentContext, startTime, steadyStart);
+    }
+    return span;
+}
+
+Tracer::ActiveScope::ActiveScope(const SpanContext& context)
+    : active(context.spanId != 0)
+    , previousContext(threadContext) {
+    if (active) {
+        threadContext = context;
+    }
+}
+
+Tracer::ActiveScope::~ActiveScope() {
+    if (active) {
+        threadContext = previousContext;
+    }
+}
+
+} // namespace configcat
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "configcat/tracing.h"
+
+namespace configcat {
+
+// Identifies a span as the parent of other spans.
+struct SpanContext {
+    uint64_t traceIdHigh = 0;
+    uint64_t traceIdLow = 0;
+    uint64_t spanId = 0; // 0 means no span
+};
+
+// An ongoing span, which is exported when it's ended (or destroyed). A default constructed span is inactive, all its
+// methods are no-ops, so the call sites don't need to care whether tracing is enabled.
+class TraceSpan {
+public:
+    TraceSpan() = default;
+    TraceSpan(TraceSpan&& other) noexcept;
+    TraceSpan& operator=(TraceSpan&& other) noexcept;
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+    ~TraceSpan();
+
+    inline explicit operator bool() const { return exporter != nullptr; }
+
+    SpanContext context() const;
+    void setAttribute(const std::string& key, const std::string& value);
+    void end();
+    // Drops the span without exporting it, for the operations which turned out to be uninteresting.
+    void discard();
+
+private:
+    friend class Tracer;
+
+    // Held by the span, as it may end after the client is closed (e.g. on the thread of an asynchronous request).
+    std::shared_ptr<SpanExporter> exporter;
+    Span span;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Creates the spans of a client and passes them to the exporter.
+class Tracer {
+public:
+    Tracer(const std::shared_ptr<SpanExporter>& exporter, double evaluationSampleRate);
+
+    // Starts a span, which is the child of the active span of the calling thread (if any).
+    TraceSpan startSpan(const char* name) const;
+
+    // The active span of the calling thread, to be reactivated where the operation continues (e.g. in a callback).
+    static SpanContext activeContext();
+
+    // Whether the current evaluation should be traced.
+    bool sampleEvaluation() const;
+
+    // Makes the span the parent of the spans started on the calling thread until the scope ends. The span itself is
+    // not affected, it may end earlier or later (e.g. on another thread).
+    class ActiveScope {
+    public:
+        explicit ActiveScope(const SpanContext& context);
+        explicit ActiveScope(const TraceSpan& span) : ActiveScope(span.context()) {}
+        ~ActiveScope();
+        ActiveScope(const ActiveScope&) = delete;
+        ActiveScope& operator=(const ActiveScope&) = delete;
+
+    private:
+        bool active;
+        SpanContext previousContext;
+    };
+
+private:
+    friend class DeferredSpan;
+
+    TraceSpan startSpan(const char* name, const SpanContext& parentContext, std::chrono::system_clock::time_point startTime,
+                        std::chrono::steady_clock::time_point start) const;
+
+    std::shared_ptr<SpanExporter> exporter;
+    double evaluationSampleRate;
+};
+
+// A span which is only started once it turns out to be interesting (e.g. when a cache read loads a new config), so the
+// operations running on each evaluation don't build spans for nothing. Only the clocks and the parent are recorded
+// up front, the started span is backdated to the construction.
+class DeferredSpan {
+public:
+    // Without a parent, the active span of the calling thread at construction becomes the parent.
+    DeferredSpan(const std::shared_ptr<Tracer>& tracer, const char* name, DeferredSpan* parent = nullptr);
+    DeferredSpan(const DeferredSpan&) = delete;
+    DeferredSpan& operator=(const DeferredSpan&) = delete;
+
+    // Starts the span (and its parent) if it's not started yet. Returns an inactive span when tracing is disabled.
+    TraceSpan& start();
+
+private:
+    const Tracer* tracer;
+    const char* name;
+    DeferredSpan* parent;
+    bool started = false;
+    SpanContext parentContext;
+    std::chrono::system_clock::time_point startTime;
+    std::chrono::steady_clock::time_point steadyStart;
+    TraceSpan span;
+};
+
+} // namespace configcat
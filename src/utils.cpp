@@ -179,8 +179,9 @@ std::optional<long long> integer_from_string(const std::string& str) {
 }
 
 #ifndef CONFIGCAT_EXTERNAL_SHA_ENABLED
-SHA1 sha1Calculator;
-SHA256 sha256Calculator;
+// The calculators keep the state of the ongoing hashing, so they can't be shared between threads.
+thread_local SHA1 sha1Calculator;
+thread_local SHA256 sha256Calculator;
 
 std::string sha1(const std::string& input) {
     return sha1Calculator(input);
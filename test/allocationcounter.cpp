@@ -0,0 +1,68 @@
+#include "allocationcounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local uint64_t allocationCount = 0;
+
+void* allocate(std::size_t size) {
+    ++allocationCount;
+    return std::malloc(size > 0 ? size : 1);
+}
+
+} // namespace
+
+AllocationCounter::AllocationCounter() : start(allocationCount) {}
+
+AllocationCounter::~AllocationCounter() = default;
+
+uint64_t AllocationCounter::count() const {
+    return allocationCount - start;
+}
+
+// Every plain new/delete goes through malloc/free, so the counts are not affected by the allocator of the platform.
+// The over-aligned variants are left to the standard library and are not counted (the SDK doesn't use over-aligned types).
+void* operator new(std::size_t size) {
+    if (void* ptr = allocate(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
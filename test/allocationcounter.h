@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts the heap allocations (calls of the global operator new) made by the current thread while the counter is alive.
+// The global operator new is replaced in the test and the benchmark binaries (see allocationcounter.cpp), so this works
+// in any test or benchmark. The counts are per thread, so they don't add contention to the multi-threaded benchmarks.
+// Counters can be nested, each one sees the allocations made during its own lifetime.
+// Only operator new is hooked: malloc, calloc, etc. called directly (e.g. by C libraries like curl) are not counted.
+class AllocationCounter {
+public:
+    AllocationCounter();
+    ~AllocationCounter();
+
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+    // The number of allocations since the construction of the counter.
+    uint64_t count() const;
+
+private:
+    const uint64_t start;
+};
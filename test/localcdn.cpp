@@ -0,0 +1,283 @@
+#ifndef _WIN32
+
+#include "localcdn.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+using namespace std;
+
+namespace configcat {
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+constexpr size_t kThrottledChunkSize = 16 * 1024;
+// The pause after an accept() failure other than an interrupted or aborted connection (e.g. out of file descriptors).
+constexpr auto kAcceptRetryDelay = chrono::milliseconds(10);
+
+const char* reasonPhrase(int statusCode) {
+    switch (statusCode) {
+        case 200: return "OK";
+        case 304: return "Not Modified";
+        case 404: return "Not Found";
+        case 500: return "Internal Server Error";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        default: return "Error";
+    }
+}
+
+string toLower(string text) {
+    transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return text;
+}
+
+} // namespace
+
+LocalCdn::LocalCdn(const Options& options) : options(options) {
+    listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenSocket < 0) {
+        throw runtime_error("LocalCdn: socket() failed.");
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0; // any free port
+    socklen_t addressLength = sizeof(address);
+    if (::bind(listenSocket, reinterpret_cast<sockaddr*>(&address), addressLength) != 0
+        || listen(listenSocket, SOMAXCONN) != 0
+        || getsockname(listenSocket, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0) {
+        close(listenSocket);
+        throw runtime_error("LocalCdn: could not listen on the loopback interface.");
+    }
+    port = ntohs(address.sin_port);
+
+    acceptThread = thread([this] { acceptConnections(); });
+}
+
+LocalCdn::~LocalCdn() {
+    stopRequested = true;
+    // Shutting down the sockets wakes up the threads blocked in accept() and recv().
+    shutdown(listenSocket, SHUT_RDWR);
+    acceptThread.join();
+    close(listenSocket);
+
+    vector<thread> threads;
+    {
+        lock_guard<mutex> lock(cdnMutex);
+        for (auto& [connection, connectionThread] : connectionThreads) {
+            shutdown(connection, SHUT_RDWR);
+            threads.push_back(std::move(connectionThread));
+        }
+        connectionThreads.clear();
+        for (auto& closedThread : closedConnectionThreads) {
+            threads.push_back(std::move(closedThread));
+        }
+        closedConnectionThreads.clear();
+    }
+    for (auto& connectionThread : threads) {
+        connectionThread.join();
+    }
+}
+
+string LocalCdn::getBaseUrl() const {
+    return "http://127.0.0.1:" + to_string(port);
+}
+
+void LocalCdn::setConfigJson(const string& sdkKey, const string& configJson) {
+    lock_guard<mutex> lock(cdnMutex);
+    fixtures[sdkKey] = {configJson, "\"" + to_string(++version) + "\""};
+}
+
+void LocalCdn::failNextRequests(size_t count, int statusCode) {
+    lock_guard<mutex> lock(cdnMutex);
+    failingRequestCount = count;
+    failureStatusCode = statusCode;
+}
+
+size_t LocalCdn::getRequestCount() const {
+    return requestCount;
+}
+
+void LocalCdn::acceptConnections() {
+    while (!stopRequested) {
+        const int connection = accept(listenSocket, nullptr, nullptr);
+        if (connection < 0) {
+            // Retrying right away would spin while the error persists.
+            if (errno != EINTR && errno != ECONNABORTED) {
+                this_thread::sleep_for(kAcceptRetryDelay);
+            }
+            continue;
+        }
+
+        const int noDelay = 1;
+        setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        // The threads of the closed connections are joined here, so they don't pile up until the destructor.
+        vector<thread> closedThreads;
+        {
+            lock_guard<mutex> lock(cdnMutex);
+            if (stopRequested) {
+                close(connection);
+                break;
+            }
+            closedThreads.swap(closedConnectionThreads);
+            // Started under the lock, so the thread is registered before it can finish.
+            connectionThreads.emplace(connection, thread([this, connection] { serveConnection(connection); }));
+        }
+        for (auto& closedThread : closedThreads) {
+            closedThread.join();
+        }
+    }
+}
+
+void LocalCdn::serveConnection(int connection) {
+    string buffer;
+    char chunk[4096];
+    bool keepAlive = true;
+    while (keepAlive && !stopRequested) {
+        // The requests are GETs without a body, so a request ends with the empty line after the headers.
+        size_t headerEnd;
+        while ((headerEnd = buffer.find("\r\n\r\n")) == string::npos) {
+            const auto received = recv(connection, chunk, sizeof(chunk), 0);
+            if (received <= 0) {
+                keepAlive = false;
+                break;
+            }
+            buffer.append(chunk, static_cast<size_t>(received));
+        }
+        if (!keepAlive) {
+            break;
+        }
+
+        const auto request = buffer.substr(0, headerEnd);
+        buffer.erase(0, headerEnd + 4);
+
+        // Request line: GET <path> HTTP/1.1
+        const auto lineEnd = request.find("\r\n");
+        const auto requestLine = request.substr(0, lineEnd);
+        const auto pathStart = requestLine.find(' ');
+        const auto pathEnd = requestLine.find(' ', pathStart + 1);
+        const auto path = pathStart == string::npos ? string() : requestLine.substr(pathStart + 1, pathEnd - pathStart - 1);
+
+        string ifNoneMatch;
+        size_t lineStart = lineEnd == string::npos ? request.size() : lineEnd + 2;
+        while (lineStart < request.size()) {
+            auto nextLineEnd = request.find("\r\n", lineStart);
+            if (nextLineEnd == string::npos) {
+                nextLineEnd = request.size();
+            }
+            const auto line = request.substr(lineStart, nextLineEnd - lineStart);
+            const auto colon = line.find(':');
+            if (colon != string::npos) {
+                const auto name = toLower(line.substr(0, colon));
+                auto value = line.substr(colon + 1);
+                trim(value);
+                if (name == "if-none-match") {
+                    ifNoneMatch = value;
+                } else if (name == "connection" && toLower(value) == "close") {
+                    keepAlive = false;
+                }
+            }
+            lineStart = nextLineEnd + 2;
+        }
+
+        if (!respond(connection, path, ifNoneMatch)) {
+            break;
+        }
+    }
+
+    lock_guard<mutex> lock(cdnMutex);
+    // The thread is joined by the accept loop after it returns from here, unless the destructor has taken it already.
+    if (const auto it = connectionThreads.find(connection); it != connectionThreads.end()) {
+        closedConnectionThreads.push_back(std::move(it->second));
+        connectionThreads.erase(it);
+    }
+    close(connection);
+}
+
+bool LocalCdn::respond(int connection, const string& path, const string& ifNoneMatch) {
+    ++requestCount;
+    if (options.latency.count() > 0) {
+        this_thread::sleep_for(options.latency);
+    }
+
+    int statusCode = 200;
+    Fixture fixture;
+    {
+        lock_guard<mutex> lock(cdnMutex);
+        if (failingRequestCount > 0) {
+            --failingRequestCount;
+            statusCode = failureStatusCode;
+        } else {
+            // Path: /configuration-files/<sdk key>/config_v6.json
+            const string prefix = "/configuration-files/";
+            const auto keyEnd = path.rfind('/');
+            const auto sdkKey = path.compare(0, prefix.size(), prefix) == 0 && keyEnd > prefix.size()
+                ? path.substr(prefix.size(), keyEnd - prefix.size())
+                : string();
+            const auto it = fixtures.find(sdkKey);
+            if (it == fixtures.end()) {
+                statusCode = 404;
+            } else {
+                fixture = it->second;
+                if (options.eTags && !ifNoneMatch.empty() && ifNoneMatch == fixture.eTag) {
+                    statusCode = 304;
+                }
+            }
+        }
+    }
+
+    if (statusCode == 0) {
+        // Dropped connection.
+        return false;
+    }
+
+    const auto& body = statusCode == 200 ? fixture.configJson : string();
+    auto header = string_format("HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n",
+                                statusCode, reasonPhrase(statusCode), body.size());
+    if (options.eTags && !fixture.eTag.empty()) {
+        header += "ETag: " + fixture.eTag + "\r\n";
+    }
+    header += "\r\n";
+
+    return sendAll(connection, header.data(), header.size(), false)
+        && sendAll(connection, body.data(), body.size(), options.bandwidthBytesPerSecond > 0);
+}
+
+bool LocalCdn::sendAll(int connection, const char* data, size_t size, bool throttled) {
+    while (size > 0) {
+        const auto chunkSize = throttled ? min(size, kThrottledChunkSize) : size;
+        const auto sent = send(connection, data, chunkSize, kSendFlags);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+        if (throttled) {
+            this_thread::sleep_for(chrono::microseconds(static_cast<int64_t>(sent) * 1000000 / static_cast<int64_t>(options.bandwidthBytesPerSecond)));
+        }
+    }
+    return true;
+}
+
+} // namespace configcat
+
+#endif // _WIN32
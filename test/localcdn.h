@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace configcat {
+
+// Minimal HTTP/1.1 server on the loopback interface, standing in for the ConfigCat CDN, so the SDK can be tested and
+// benchmarked end-to-end (including libcurl and the sockets) without network access. It serves the config JSON set for an SDK key
+// at `/configuration-files/<sdk key>/config_v6.json`. Only available on POSIX platforms.
+class LocalCdn {
+public:
+    struct Options {
+        // Delay before each response, simulating the round trip and the processing time of the CDN.
+        std::chrono::milliseconds latency = std::chrono::milliseconds(0);
+
+        // Limit of the response body transfer rate (0 means unlimited).
+        size_t bandwidthBytesPerSecond = 0;
+
+        // Whether the responses have an ETag, and the requests with a matching `If-None-Match` get 304 Not Modified.
+        bool eTags = true;
+    };
+
+    explicit LocalCdn(const Options& options);
+    LocalCdn() : LocalCdn(Options()) {}
+    ~LocalCdn();
+
+    LocalCdn(const LocalCdn&) = delete;
+    LocalCdn& operator=(const LocalCdn&) = delete;
+
+    // The base URL to be set as `ConfigCatOptions::baseUrl`.
+    std::string getBaseUrl() const;
+
+    // Sets the config JSON served for the SDK key, a new ETag is assigned to each version.
+    void setConfigJson(const std::string& sdkKey, const std::string& configJson);
+
+    // The next `count` requests fail with the given status code. With status code 0 the connection is dropped instead.
+    void failNextRequests(size_t count, int statusCode = 503);
+
+    // The number of requests served so far (including the failed ones).
+    size_t getRequestCount() const;
+
+private:
+    struct Fixture {
+        std::string configJson;
+        std::string eTag;
+    };
+
+    void acceptConnections();
+    void serveConnection(int connection);
+    bool respond(int connection, const std::string& path, const std::string& ifNoneMatch);
+    bool sendAll(int connection, const char* data, size_t size, bool throttled);
+
+    const Options options;
+    int listenSocket = -1;
+    uint16_t port = 0;
+
+    mutable std::mutex cdnMutex;
+    std::map<std::string, Fixture> fixtures;
+    size_t failingRequestCount = 0;
+    int failureStatusCode = 0;
+    int version = 0;
+    // The threads serving the open connections by socket, and those of the closed connections to be joined.
+    std::map<int, std::thread> connectionThreads;
+    std::vector<std::thread> closedConnectionThreads;
+    std::atomic<size_t> requestCount{0};
+    std::atomic<bool> stopRequested{false};
+
+    std::thread acceptThread;
+};
+
+} // namespace configcat
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <queue>
+#include <mutex>
 #include <thread>
 #include <chrono>
 #include <unordered_map>
@@ -121,14 +122,154 @@ public:
         return {};
     };
 
+    void getStreamingAsync(const std::string& url, const std::map<std::string, std::string>& header,
+                           const std::map<std::string, std::string>& proxies,
+                           const std::map<std::string, configcat::ProxyAuthentication>& proxyAuthentications,
+                           const std::shared_ptr<configcat::CancellationToken>& cancellationToken,
+                           const configcat::BodyChunkCallback& onBodyChunk,
+                           const configcat::ResponseCallback& callback) override {
+        auto response = get(url, header, proxies, proxyAuthentications);
+        if (streamChunkSize > 0 && response.statusCode >= 200 && response.statusCode < 300) {
+            for (size_t position = 0; position < response.text.size(); position += streamChunkSize) {
+                onBodyChunk(response.text.data() + position, std::min(streamChunkSize, response.text.size() - position));
+            }
+            response.text.clear();
+        }
+        callback(response);
+    }
+
     void close() override {
         closed = true;
     }
 
     std::queue<MockResponse> responses;
     std::vector<Request> requests;
+    // When set, the body of the successful responses is streamed in chunks of this size by `getStreamingAsync`.
+    size_t streamChunkSize = 0;
+
+private:
+    std::atomic<bool> closed = false;
+};
+
+// Asynchronous adapter which completes the requests only when the test calls `complete` (like an external event loop would).
+class MockAsyncHttpSessionAdapter : public configcat::HttpSessionAdapter {
+public:
+    struct PendingRequest {
+        std::string url;
+        std::map<std::string, std::string> header;
+        configcat::ResponseCallback callback;
+    };
+
+    bool init(uint32_t connectTimeoutMs, uint32_t readTimeoutMs) override {
+        return true;
+    }
+
+    void getAsync(const std::string& url, const std::map<std::string, std::string>& header,
+                  const std::map<std::string, std::string>& proxies,
+                  const std::map<std::string, configcat::ProxyAuthentication>& proxyAuthentications,
+                  const std::shared_ptr<configcat::CancellationToken>& cancellationToken,
+                  const configcat::ResponseCallback& callback) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pendingRequests.push_back({url, header, callback});
+        }
+        cancellationToken->onCancelled([this] {
+            configcat::Response response;
+            response.errorCode = configcat::ResponseErrorCode::RequestCancelled;
+            response.error = "Request was cancelled.";
+            completeAll(response);
+        });
+    }
+
+    size_t pendingCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pendingRequests.size();
+    }
+
+    // Completes the oldest pending request.
+    void complete(const configcat::Response& response) {
+        PendingRequest request;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            request = pendingRequests.front();
+            pendingRequests.erase(pendingRequests.begin());
+        }
+        request.callback(response);
+    }
+
+    void completeAll(const configcat::Response& response) {
+        std::vector<PendingRequest> requests;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.swap(pendingRequests);
+        }
+        for (const auto& request : requests) {
+            request.callback(response);
+        }
+    }
+
+    void close() override {}
+
+private:
+    std::mutex mutex;
+    std::vector<PendingRequest> pendingRequests;
+};
+
+// Thread-safe adapter responding by the base url of the request, with an optional delay that can be cut short by cancellation.
+class DelayedHttpSessionAdapter : public configcat::HttpSessionAdapter {
+public:
+    void setResponse(const std::string& baseUrl, const configcat::Response& response, int delayInMilliseconds = 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        responses[baseUrl] = {response, delayInMilliseconds};
+    }
+
+    bool init(uint32_t connectTimeoutMs, uint32_t readTimeoutMs) override {
+        return true;
+    }
+
+    void getAsync(const std::string& url, const std::map<std::string, std::string>& header,
+                  const std::map<std::string, std::string>& proxies,
+                  const std::map<std::string, configcat::ProxyAuthentication>& proxyAuthentications,
+                  const std::shared_ptr<configcat::CancellationToken>& cancellationToken,
+                  const configcat::ResponseCallback& callback) override {
+        std::pair<configcat::Response, int> response;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requestedUrls.push_back(url);
+            for (const auto& [baseUrl, baseUrlResponse] : responses) {
+                if (url.rfind(baseUrl, 0) == 0) {
+                    response = baseUrlResponse;
+                }
+            }
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(response.second);
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (closed || cancellationToken->isCancelled()) {
+                configcat::Response cancelled;
+                cancelled.errorCode = configcat::ResponseErrorCode::RequestCancelled;
+                cancelled.error = "Request was cancelled.";
+                callback(cancelled);
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        callback(response.first);
+    }
+
+    std::vector<std::string> getRequestedUrls() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return requestedUrls;
+    }
+
+    void close() override {
+        closed = true;
+    }
 
 private:
+    std::mutex mutex;
+    std::map<std::string, std::pair<configcat::Response, int>> responses;
+    std::vector<std::string> requestedUrls;
     std::atomic<bool> closed = false;
 };
 
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include "mock.h"
+#include "allocationcounter.h"
+#include "configcat/configcat.h"
+
+using namespace configcat;
+using namespace std;
+
+class AllocationTest : public ::testing::Test {
+public:
+    static constexpr char kTestSdkKey[] = "TestSdkKey-23456789012/1234567890123456789012";
+    static constexpr char kTestJson[] = R"({"p":{"u":"https://cdn-global.configcat.com","r":0,"s":"salt"},"f":{)"
+        R"("simple":{"t":0,"v":{"b":true},"i":"id1"},)"
+        R"("text":{"t":1,"v":{"s":"default"},"i":"id2"},)"
+        R"("isOneOf":{"t":0,"v":{"b":false},"i":"id3","r":[{"c":[{"u":{"a":"Email","c":0,"l":["a@example.com","b@example.com","c@example.com"]}}],"s":{"v":{"b":true},"i":"id4"}}]},)"
+        R"("percentage":{"t":0,"v":{"b":false},"i":"id5","p":[{"p":30,"v":{"b":true},"i":"id6"},{"p":70,"v":{"b":false},"i":"id7"}]})"
+        R"(}})";
+
+    shared_ptr<ConfigCatClient> client = nullptr;
+    shared_ptr<MockHttpSessionAdapter> mockHttpSessionAdapter = make_shared<MockHttpSessionAdapter>();
+    shared_ptr<ConfigCatUser> user = ConfigCatUser::create("id", "b@example.com");
+
+    void SetUp() override {
+        mockHttpSessionAdapter->enqueueResponse({200, kTestJson});
+
+        ConfigCatOptions options;
+        options.pollingMode = PollingMode::manualPoll();
+        options.httpSessionAdapter = mockHttpSessionAdapter;
+        client = ConfigCatClient::get(kTestSdkKey, &options);
+        client->forceRefresh();
+    }
+
+    void TearDown() override {
+        ConfigCatClient::closeAll();
+    }
+
+    template<typename Evaluate>
+    uint64_t countAllocations(const Evaluate& evaluate) {
+        // The first evaluation may fill lazily initialized state, the steady state is what matters.
+        evaluate();
+        AllocationCounter counter;
+        evaluate();
+        return counter.count();
+    }
+};
+
+TEST_F(AllocationTest, SimpleValue) {
+    EXPECT_EQ(0, countAllocations([&] { EXPECT_TRUE(client->getValue("simple", false)); }));
+    EXPECT_EQ(0, countAllocations([&] { EXPECT_TRUE(client->getValue("simple", false, user)); }));
+    EXPECT_EQ(0, countAllocations([&] { EXPECT_EQ("default", client->getValue("text", "")); }));
+}
+
+TEST_F(AllocationTest, IsOneOfRule) {
+    EXPECT_EQ(0, countAllocations([&] { EXPECT_TRUE(client->getValue("isOneOf", false, user)); }));
+    const auto otherUser = ConfigCatUser::create("id", "x@example.com");
+    EXPECT_EQ(0, countAllocations([&] { EXPECT_FALSE(client->getValue("isOneOf", false, otherUser)); }));
+}
+
+TEST_F(AllocationTest, PercentageOptions) {
+    // The SHA-1 hex digest doesn't fit into the small string buffer, that's the only allocation left.
+    EXPECT_EQ(1, countAllocations([&] { client->getValue("percentage", false, user); }));
+}
+
+TEST_F(AllocationTest, OnFlagEvaluatedSubscriberGetsDetails) {
+    string evaluatedVariationId;
+    client->getHooks()->addOnFlagEvaluated([&](const EvaluationDetailsBase& details) {
+        evaluatedVariationId = details.variationId.value_or("");
+    });
+
+    EXPECT_TRUE(client->getValue("isOneOf", false, user));
+    EXPECT_EQ("id4", evaluatedVariationId);
+}
+
+TEST_F(AllocationTest, TracingDoesntAllocateWithoutFetch) {
+    class DiscardingSpanExporter : public SpanExporter {
+    public:
+        void exportSpan(const Span&) override {}
+    };
+
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson});
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.spanExporter = make_shared<DiscardingSpanExporter>();
+    auto tracedClient = ConfigCatClient::get("TestSdkKey-23456789012/1234567890123456789013", &options);
+    tracedClient->forceRefresh();
+
+    // The spans are only started when an evaluation triggers a fetch or a config change.
+    EXPECT_EQ(0, countAllocations([&] { EXPECT_TRUE(tracedClient->getValue("simple", false)); }));
+}
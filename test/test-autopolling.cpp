@@ -337,3 +337,67 @@ TEST_F(AutoPollingTest, InitOffline) {
     EXPECT_EQ("test", std::get<string>((*settings)["fakeKey"].value));
     EXPECT_TRUE(mockHttpSessionAdapter->requests.size() >= 2);
 }
+
+TEST_F(AutoPollingTest, NoWaitForInitOnEvaluation) {
+    configcat::Response response = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"test"})")};
+    constexpr int responseDelay = 2;
+    mockHttpSessionAdapter->enqueueResponse(response, responseDelay);
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::autoPoll(60, 5);
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.waitForInitOnEvaluation = false;
+    auto service = ConfigService(kTestSdkKey, logger, make_shared<Hooks>(), make_shared<NullConfigCache>(), options);
+
+    bool readyCallbackInvoked = false;
+    service.onReady([&] { readyCallbackInvoked = true; });
+
+    // The evaluation doesn't wait for the first fetch.
+    auto startTime = steady_clock::now();
+    auto settings = service.getSettings().settings;
+    EXPECT_EQ(settings, nullptr);
+    EXPECT_LT(duration<double>(steady_clock::now() - startTime).count(), 0.5);
+
+    auto readyFuture = service.getReadyFuture();
+    EXPECT_EQ(future_status::timeout, readyFuture.wait_for(milliseconds(100)));
+    EXPECT_FALSE(readyCallbackInvoked);
+
+    EXPECT_EQ(future_status::ready, readyFuture.wait_for(seconds(5)));
+    EXPECT_TRUE(readyCallbackInvoked);
+
+    settings = service.getSettings().settings;
+    ASSERT_NE(settings, nullptr);
+    EXPECT_EQ("test", std::get<string>((*settings)["fakeKey"].value));
+
+    // Callbacks registered after the initialization are invoked immediately.
+    bool lateReadyCallbackInvoked = false;
+    service.onReady([&] { lateReadyCallbackInvoked = true; });
+    EXPECT_TRUE(lateReadyCallbackInvoked);
+}
+
+TEST_F(AutoPollingTest, NoWaitForInitOnEvaluationServesCache) {
+    // The cached config is expired, so the client is initialized only by the (slow) fetch.
+    auto jsonString = string_format(kTestJsonFormat, SettingType::String, R"({"s":"cached"})");
+    auto mockCache = make_shared<SingleValueCache>(ConfigEntry(
+        Config::fromJson(jsonString),
+        "test-etag",
+        jsonString,
+        get_utcnowseconds_since_epoch() - 120).serialize()
+    );
+
+    configcat::Response response = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"test"})")};
+    constexpr int responseDelay = 2;
+    mockHttpSessionAdapter->enqueueResponse(response, responseDelay);
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::autoPoll(60, 5);
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.waitForInitOnEvaluation = false;
+    auto service = ConfigService(kTestSdkKey, logger, make_shared<Hooks>(), mockCache, options);
+
+    auto startTime = steady_clock::now();
+    auto settings = service.getSettings().settings;
+    EXPECT_LT(duration<double>(steady_clock::now() - startTime).count(), 0.5);
+    ASSERT_NE(settings, nullptr);
+    EXPECT_EQ("cached", std::get<string>((*settings)["fakeKey"].value));
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include "circuitbreaker.h"
+#include "configcat/configcatoptions.h"
+
+using namespace configcat;
+using namespace std;
+using namespace std::chrono;
+
+class CircuitBreakerTest : public ::testing::Test {
+public:
+    CircuitBreaker::Clock::time_point now = CircuitBreaker::Clock::now();
+};
+
+TEST_F(CircuitBreakerTest, DisabledByDefault) {
+    CircuitBreaker breaker{FetchRetryOptions()};
+
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_FALSE(breaker.recordFailure(now));
+        EXPECT_TRUE(breaker.allowRequest(now));
+    }
+    EXPECT_EQ(CircuitBreaker::State::closed, breaker.getState());
+    EXPECT_EQ(0ms, breaker.retryDelay(now));
+}
+
+TEST_F(CircuitBreakerTest, ExponentialBackoff) {
+    FetchRetryOptions options;
+    options.initialBackoffMs = 100;
+    options.maxBackoffMs = 500;
+    CircuitBreaker breaker(options);
+
+    for (auto expectedDelay : { 100ms, 200ms, 400ms, 500ms, 500ms }) {
+        breaker.recordFailure(now);
+        EXPECT_EQ(expectedDelay, breaker.retryDelay(now));
+        EXPECT_FALSE(breaker.allowRequest(now));
+        EXPECT_TRUE(breaker.allowRequest(now, true));
+        EXPECT_TRUE(breaker.allowRequest(now + expectedDelay));
+    }
+
+    EXPECT_FALSE(breaker.recordSuccess());
+    EXPECT_EQ(0ms, breaker.retryDelay(now));
+    EXPECT_TRUE(breaker.allowRequest(now));
+}
+
+TEST_F(CircuitBreakerTest, Jitter) {
+    FetchRetryOptions options;
+    options.jitter = 0.2;
+    CircuitBreaker breaker(options);
+
+    bool varies = false;
+    for (int i = 0; i < 100; ++i) {
+        auto delay = breaker.applyJitter(1000ms);
+        EXPECT_GE(delay, 800ms);
+        EXPECT_LE(delay, 1200ms);
+        varies |= delay != 1000ms;
+    }
+    EXPECT_TRUE(varies);
+}
+
+TEST_F(CircuitBreakerTest, OpenHalfOpenClosed) {
+    FetchRetryOptions options;
+    options.circuitBreakerThreshold = 3;
+    options.circuitBreakerOpenMs = 1000;
+    CircuitBreaker breaker(options);
+
+    EXPECT_FALSE(breaker.recordFailure(now));
+    EXPECT_FALSE(breaker.recordFailure(now));
+    EXPECT_TRUE(breaker.recordFailure(now));
+    EXPECT_EQ(CircuitBreaker::State::open, breaker.getState());
+
+    // Explicit refreshes are blocked too while the breaker is open.
+    EXPECT_FALSE(breaker.allowRequest(now + 999ms, true));
+    EXPECT_EQ(1000ms, breaker.retryDelay(now));
+
+    // The failed probe reopens the breaker.
+    EXPECT_TRUE(breaker.allowRequest(now + 1000ms));
+    EXPECT_EQ(CircuitBreaker::State::halfOpen, breaker.getState());
+    EXPECT_TRUE(breaker.recordFailure(now + 1000ms));
+    EXPECT_EQ(CircuitBreaker::State::open, breaker.getState());
+    EXPECT_FALSE(breaker.allowRequest(now + 1999ms));
+
+    // The successful probe closes it.
+    EXPECT_TRUE(breaker.allowRequest(now + 2000ms));
+    EXPECT_TRUE(breaker.recordSuccess());
+    EXPECT_EQ(CircuitBreaker::State::closed, breaker.getState());
+    EXPECT_EQ(0, breaker.getConsecutiveFailures());
+    EXPECT_TRUE(breaker.allowRequest(now + 2000ms));
+}
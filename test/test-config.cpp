@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+#include <fstream>
+#include <thread>
+#include "test.h"
+#include "mock.h"
+#include "configcat/config.h"
+#include "parsearena.h"
+
+using namespace configcat;
+using namespace std;
+
+TEST(ConfigTest, FromJson) {
+    auto config = Config::fromJson(kTestJsonString);
+    EXPECT_EQ(Config::fromJson(kTestJsonString)->toJson(), config->toJson());
+
+    auto& settings = *config->getSettingsOrEmpty();
+    EXPECT_EQ(6, settings.size());
+    EXPECT_EQ("testValue", get<string>(settings["testStringKey"].value));
+    EXPECT_EQ(2, settings["testStringKey"].targetingRules.size());
+    EXPECT_EQ("fakeId1", settings["key1"].variationId);
+}
+
+TEST(ConfigTest, FromJsonInvalidJsonDoesNotAffectLaterParsing) {
+    EXPECT_ANY_THROW(Config::fromJson(R"({"f":{"key":{"t":0,"v":{"b":true}})"));
+
+    auto config = Config::fromJson(R"({"f":{"key":{"t":0,"v":{"b":true}}}})");
+    EXPECT_EQ(true, get<bool>((*config->getSettingsOrEmpty())["key"].value));
+}
+
+TEST(ConfigTest, FromJsonInsideOuterArena) {
+    shared_ptr<Config> config;
+    {
+        ParseArena outerArena;
+        config = Config::fromJson(kTestJsonString);
+    }
+
+    // The parsed config must not reference memory of the (already released) arenas.
+    EXPECT_EQ(Config::fromJson(kTestJsonString)->toJson(), config->toJson());
+}
+
+#ifdef CONFIGCAT_PARSE_ARENA_ENABLED
+
+TEST(ConfigTest, ParseArenaReleasesToTheOwningResource) {
+    using ArenaVector = vector<int, ArenaAllocator<int>>;
+
+    // Allocated from the heap, released inside an arena.
+    auto heapVector = make_unique<ArenaVector>(100, 1);
+    {
+        ParseArena outerArena;
+        ArenaVector outerVector(100, 2);
+        {
+            ParseArena innerArena;
+            heapVector.reset();
+            // Allocated from the outer arena, released inside the inner one.
+            outerVector = ArenaVector();
+            ArenaVector innerVector(100, 3);
+            EXPECT_EQ(3, innerVector.back());
+        }
+    }
+    SUCCEED();
+}
+
+#ifndef NDEBUG
+TEST(ConfigTest, ParseArenaAssertsValuesOutlivingTheScope) {
+    using ArenaVector = vector<int, ArenaAllocator<int>>;
+
+    EXPECT_DEATH({
+        unique_ptr<ArenaVector> escaped;
+        {
+            ParseArena arena;
+            escaped = make_unique<ArenaVector>(100, 1);
+        }
+    }, "outlived its scope");
+}
+#endif
+
+#endif
+
+TEST(ConfigTest, FromJsonWithConfigArena) {
+    auto heapConfig = Config::fromJson(kTestJsonString);
+    auto config = Config::fromJson(kTestJsonString, false, false, true);
+    EXPECT_EQ(heapConfig->toJson(), config->toJson());
+
+    // Only the DOM lives in the arena, the parsed config outlives the parse.
+    Setting setting = config->getSettingsOrEmpty()->at("testStringKey");
+    config.reset();
+    EXPECT_EQ(2, setting.targetingRules.size());
+    EXPECT_EQ("@test1.com", get<vector<string>>(get<UserCondition>(setting.targetingRules[0].conditions[0].condition).comparisonValue)[0]);
+}
+
+TEST(ConfigTest, FromJsonLazyWithConfigArena) {
+    auto heapConfig = Config::fromJson(kTestJsonString);
+    auto config = Config::fromJson(kTestJsonString, false, true, true);
+    EXPECT_EQ(heapConfig->toJson(), config->toJson());
+}
+
+TEST(ConfigTest, FromJsonLazyDecodesToTheSameConfig) {
+    const auto directoryPath = RemoveFileName(__FILE__);
+    for (const auto& fileName : { "data/test_override_segments_v6.json", "data/test_override_flagdependency_v6.json", "data/comparison_attribute_conversion.json" }) {
+        ifstream file(directoryPath + fileName);
+        const string jsonString((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+        auto eagerConfig = Config::fromJson(jsonString);
+        auto lazyConfig = Config::fromJson(jsonString, false, true);
+
+        EXPECT_EQ(eagerConfig->getSettingsOrEmpty()->size(), lazyConfig->getSettingsOrEmpty()->size()) << fileName;
+        for (const auto& [key, setting] : *eagerConfig->getSettingsOrEmpty()) {
+            EXPECT_EQ(setting.type, (*lazyConfig->getSettingsOrEmpty())[key].type) << fileName << ": " << key;
+        }
+        EXPECT_EQ(eagerConfig->toJson(), lazyConfig->toJson()) << fileName;
+    }
+}
+
+TEST(ConfigTest, FromJsonLazyDecodesSettingsOnFirstAccess) {
+    auto config = Config::fromJson(R"({
+        "p": {"u": "https://cdn-global.configcat.com", "r": 0, "s": "salt"},
+        "f": {
+            "valid": {"t": 1, "r": [{"c": [{"u": {"a": "Email", "c": 2, "l": ["@example.com"]}}], "s": {"v": {"s": "a\"}"}, "i": "id1"}}], "v": {"s": "b"}, "i": "id2"},
+            "invalid": {"t": 0, "r": "not an array", "v": {"b": false}},
+            "escaped \"key\"": {"t": 2, "v": {"i": 42}}
+        }
+    })", false, true);
+
+    auto& settings = *config->getSettingsOrEmpty();
+    ASSERT_EQ(3, settings.size());
+
+    auto& valid = settings["valid"];
+    EXPECT_EQ(SettingType::String, valid.type);
+    EXPECT_TRUE(valid.targetingRules.empty()); // not decoded yet
+
+    vector<thread> threads;
+    vector<const Setting*> decodedSettings(8);
+    for (size_t i = 0; i < decodedSettings.size(); ++i) {
+        threads.emplace_back([&, i] { decodedSettings[i] = &valid.getDecoded(); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto decoded : decodedSettings) {
+        EXPECT_EQ(decodedSettings[0], decoded);
+    }
+
+    auto& decoded = valid.getDecoded();
+    ASSERT_EQ(1, decoded.targetingRules.size());
+    EXPECT_EQ("a\"}", get<string>(get<SettingValueContainer>(decoded.targetingRules[0].then).value));
+    EXPECT_EQ("id2", decoded.variationId);
+    EXPECT_EQ("Email", get<UserCondition>(decoded.targetingRules[0].conditions[0].condition).comparisonAttribute);
+
+    EXPECT_EQ(SettingType::Int, settings["escaped \"key\""].type);
+    EXPECT_EQ(42, get<int32_t>(settings["escaped \"key\""].getDecoded().value));
+
+    // Errors in a setting surface only when the setting gets decoded.
+    EXPECT_EQ(SettingType::Boolean, settings["invalid"].type);
+    EXPECT_ANY_THROW(settings["invalid"].getDecoded());
+}
+
+TEST(ConfigTest, FromJsonLazyInvalidJson) {
+    EXPECT_ANY_THROW(Config::fromJson(R"({"f":{"key":{"t":0,"v":{"b":true}})", false, true));
+    EXPECT_ANY_THROW(Config::fromJson(R"({"f":{"key" {"t":0,"v":{"b":true}}}})", false, true));
+    EXPECT_ANY_THROW(Config::fromJson(R"({"f":{"key":{"t":"x","v":{"b":true}}}})", false, true));
+
+    // The structure is validated when the config is loaded, even within the settings which are decoded later.
+    EXPECT_ANY_THROW(Config::fromJson(R"({"f":{"key":{"t":0,"v":{"b":true]}}})", false, true));
+    EXPECT_ANY_THROW(Config::fromJson(R"({"f":{"key":{"t":0,"v":{"b":tru}}}})", false, true));
+    EXPECT_ANY_THROW(Config::fromJson(R"({"f":{"key":{"t":0,"v":{"s":"\x"}}}})", false, true));
+    EXPECT_ANY_THROW(Config::fromJson(R"({"f":{"key":{"t":0,"r":[1,],"v":{"b":true}}}})", false, true));
+    EXPECT_ANY_THROW(Config::fromJson(R"({"f":{"key":{"t":0,"v":{"d":01}}}})", false, true));
+    EXPECT_ANY_THROW(Config::fromJson(R"({"f":{}} garbage)", false, true));
+    EXPECT_ANY_THROW(Config::fromJson(R"({"f":{}}{})", false, true));
+    EXPECT_NO_THROW(Config::fromJson(R"( {"f":{"key":{"t":3,"r":[],"v":{"d":-1.5e+3},"i":"\u00e9"}}} )", false, true));
+}
+
+TEST(ConfigTest, ConfigDiff) {
+    auto oldConfig = Config::fromJson(R"({
+        "p": {"u": "https://cdn-global.configcat.com", "r": 0, "s": "salt"},
+        "s": [{"n": "Beta", "r": [{"a": "Email", "c": 2, "l": ["@example.com"]}]}, {"n": "Alpha", "r": [{"a": "Country", "c": 28, "s": "HU"}]}],
+        "f": {
+            "unchanged": {"t": 0, "v": {"b": true}},
+            "modified": {"t": 0, "v": {"b": true}},
+            "removed": {"t": 0, "v": {"b": true}},
+            "inBeta": {"t": 0, "r": [{"c": [{"s": {"s": 0, "c": 0}}], "s": {"v": {"b": true}}}], "v": {"b": false}},
+            "inAlpha": {"t": 0, "r": [{"c": [{"s": {"s": 1, "c": 0}}], "s": {"v": {"b": true}}}], "v": {"b": false}},
+            "dependsOnModified": {"t": 0, "r": [{"c": [{"p": {"f": "modified", "c": 0, "v": {"b": true}}}], "s": {"v": {"b": true}}}], "v": {"b": false}},
+            "dependsOnDependent": {"t": 0, "r": [{"c": [{"p": {"f": "dependsOnModified", "c": 0, "v": {"b": true}}}], "s": {"v": {"b": true}}}], "v": {"b": false}}
+        }
+    })");
+    auto newConfig = Config::fromJson(R"({
+        "p": {"u": "https://cdn-global.configcat.com", "r": 0, "s": "salt"},
+        "s": [{"n": "Beta", "r": [{"a": "Email", "c": 2, "l": ["@example.org"]}]}, {"n": "Alpha", "r": [{"a": "Country", "c": 28, "s": "HU"}]}],
+        "f": {
+            "unchanged": {"t": 0, "v": {"b": true}},
+            "modified": {"t": 0, "v": {"b": false}},
+            "added": {"t": 0, "v": {"b": true}},
+            "inBeta": {"t": 0, "r": [{"c": [{"s": {"s": 0, "c": 0}}], "s": {"v": {"b": true}}}], "v": {"b": false}},
+            "inAlpha": {"t": 0, "r": [{"c": [{"s": {"s": 1, "c": 0}}], "s": {"v": {"b": true}}}], "v": {"b": false}},
+            "dependsOnModified": {"t": 0, "r": [{"c": [{"p": {"f": "modified", "c": 0, "v": {"b": true}}}], "s": {"v": {"b": true}}}], "v": {"b": false}},
+            "dependsOnDependent": {"t": 0, "r": [{"c": [{"p": {"f": "dependsOnModified", "c": 0, "v": {"b": true}}}], "s": {"v": {"b": true}}}], "v": {"b": false}}
+        }
+    })");
+
+    for (auto lazy : { false, true }) {
+        auto oldLazyOrEager = lazy ? Config::fromJson(oldConfig->toJson(), false, true) : oldConfig;
+        auto newLazyOrEager = lazy ? Config::fromJson(newConfig->toJson(), false, true) : newConfig;
+
+        const auto settingsMemory = newLazyOrEager->memoryUsage().settings;
+        auto diff = ConfigDiff::compute(*oldLazyOrEager, *newLazyOrEager);
+        // The unchanged settings are not decoded, their raw JSON is scanned for the segment and prerequisite flag references.
+        EXPECT_EQ(settingsMemory, newLazyOrEager->memoryUsage().settings);
+
+        EXPECT_EQ(vector<string>{ "added" }, diff.addedKeys);
+        EXPECT_EQ(vector<string>{ "removed" }, diff.removedKeys);
+        EXPECT_EQ((vector<string>{ "dependsOnDependent", "dependsOnModified", "inBeta", "modified" }), diff.modifiedKeys);
+        EXPECT_EQ(vector<string>{ "Beta" }, diff.changedSegments);
+        EXPECT_TRUE(diff.contains("inBeta"));
+        EXPECT_FALSE(diff.contains("inAlpha"));
+        EXPECT_FALSE(diff.contains("unchanged"));
+
+        EXPECT_TRUE(ConfigDiff::compute(*newLazyOrEager, *newLazyOrEager).empty());
+    }
+
+    auto diff = ConfigDiff::compute(*Config::empty, *newConfig);
+    EXPECT_EQ(newConfig->getSettingsOrEmpty()->size(), diff.addedKeys.size());
+    EXPECT_EQ((vector<string>{ "Beta", "Alpha" }), diff.changedSegments);
+}
+
+TEST(ConfigTest, ConfigDiffComparesTheWholeSetting) {
+    auto oldConfig = Config::fromJson(R"({"f": {
+        "variationId": {"t": 0, "v": {"b": true}, "i": "a"},
+        "comparator": {"t": 0, "r": [{"c": [{"u": {"a": "Email", "c": 2, "l": ["@example.com"]}}], "s": {"v": {"b": true}}}], "v": {"b": false}},
+        "percentage": {"t": 1, "p": [{"p": 30, "v": {"s": "a"}}, {"p": 70, "v": {"s": "b"}}], "v": {"s": "c"}},
+        "unsupported": {"t": 0, "v": {"b": true}, "r": [{"c": [{"p": {"f": "variationId", "c": 0, "v": {"x": 1}}}], "s": {"v": {"b": true}}}]},
+        "unchanged": {"t": 1, "a": "Email", "p": [{"p": 30, "v": {"s": "a"}}, {"p": 70, "v": {"s": "b"}}], "v": {"s": "c"}}
+    }})");
+    auto newConfig = Config::fromJson(R"({"f": {
+        "variationId": {"t": 0, "v": {"b": true}, "i": "b"},
+        "comparator": {"t": 0, "r": [{"c": [{"u": {"a": "Email", "c": 3, "l": ["@example.com"]}}], "s": {"v": {"b": true}}}], "v": {"b": false}},
+        "percentage": {"t": 1, "p": [{"p": 40, "v": {"s": "a"}}, {"p": 60, "v": {"s": "b"}}], "v": {"s": "c"}},
+        "unsupported": {"t": 0, "v": {"b": true}, "r": [{"c": [{"p": {"f": "variationId", "c": 0, "v": {"x": 2}}}], "s": {"v": {"b": true}}}]},
+        "unchanged": {"t": 1, "a": "Email", "p": [{"p": 30, "v": {"s": "a"}}, {"p": 70, "v": {"s": "b"}}], "v": {"s": "c"}}
+    }})");
+
+    auto diff = ConfigDiff::compute(*oldConfig, *newConfig);
+
+    EXPECT_EQ((vector<string>{ "comparator", "percentage", "unsupported", "variationId" }), diff.modifiedKeys);
+}
@@ -1,9 +1,17 @@
 #include <gtest/gtest.h>
+#include <fstream>
 #include "mock.h"
 #include "configcat/configcat.h"
 #include "configfetcher.h"
+#include "configservice.h"
+#include "test.h"
 #include <hash-library/sha1.h>
 
+#ifdef CONFIGCAT_TEST_EMBEDDED_CONFIG
+#include "test_embedded_config.h"
+#include "test_embedded_segments_config.h"
+#endif
+
 using namespace configcat;
 using namespace std;
 using namespace std::this_thread;
@@ -463,6 +471,59 @@ TEST_F(ConfigCatClientTest, GetValueDetails) {
     EXPECT_LE(now, details.fetchTime + std::chrono::seconds(1));
 }
 
+TEST_F(ConfigCatClientTest, LazySettingDecoding) {
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.lazySettingDecoding = true;
+    client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    configcat::Response response = {200, kTestJsonString};
+    mockHttpSessionAdapter->enqueueResponse(response);
+    client->forceRefresh();
+
+    auto user = make_shared<ConfigCatUser>("test@test1.com");
+    auto details = client->getValueDetails("testStringKey", "", user);
+
+    EXPECT_EQ("fake1", details.value);
+    EXPECT_EQ("id1", details.variationId);
+    EXPECT_FALSE(details.isDefaultValue);
+    EXPECT_EQ(UserComparator::TextContainsAnyOf, get<UserCondition>(details.matchedTargetingRule->conditions[0].condition).comparator);
+
+    auto keyValue = client->getKeyAndValue("fakeId2");
+    EXPECT_TRUE(keyValue.has_value());
+    EXPECT_EQ("key2", keyValue->key);
+
+    EXPECT_EQ(6, client->getAllValues(user).size());
+}
+
+TEST_F(ConfigCatClientTest, ConfigArena) {
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.configArena = true;
+    client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    configcat::Response response = {200, kTestJsonString};
+    mockHttpSessionAdapter->enqueueResponse(response);
+    client->forceRefresh();
+
+    auto user = make_shared<ConfigCatUser>("test@test1.com");
+    auto details = client->getValueDetails("testStringKey", "", user);
+
+    EXPECT_EQ("fake1", details.value);
+    EXPECT_EQ("id1", details.variationId);
+    EXPECT_FALSE(details.isDefaultValue);
+
+    // The replaced config is released while the settings of the new one are in use.
+    configcat::Response response2 = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"test2"})")};
+    mockHttpSessionAdapter->enqueueResponse(response2);
+    client->forceRefresh();
+
+    EXPECT_EQ("test2", client->getValue("fakeKey", ""));
+    EXPECT_EQ(1, client->getAllKeys().size());
+}
+
 TEST_F(ConfigCatClientTest, AutoPollUserAgentHeader) {
     configcat::Response response = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"fake"})")};
     mockHttpSessionAdapter->enqueueResponse(response);
@@ -820,4 +881,248 @@ TEST_F(ConfigCatClientTest, SetOnlineAfterCloseAll) {
 
     client->setOnline();
     EXPECT_TRUE(client->isOffline());
-}
\ No newline at end of file
+}
+
+TEST_F(ConfigCatClientTest, ForceRefreshAsync) {
+    auto asyncHttpSessionAdapter = make_shared<MockAsyncHttpSessionAdapter>();
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = asyncHttpSessionAdapter;
+    client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    vector<RefreshResult> results;
+    client->forceRefreshAsync([&](RefreshResult result) { results.push_back(result); });
+    // The second refresh joins the ongoing fetch.
+    client->forceRefreshAsync([&](RefreshResult result) { results.push_back(result); });
+
+    EXPECT_TRUE(results.empty());
+    EXPECT_EQ(1, asyncHttpSessionAdapter->pendingCount());
+    EXPECT_EQ("", client->getValue("fakeKey", ""));
+
+    asyncHttpSessionAdapter->complete({200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"fake"})")});
+
+    ASSERT_EQ(2, results.size());
+    EXPECT_TRUE(results[0].success());
+    EXPECT_TRUE(results[1].success());
+    EXPECT_EQ("fake", client->getValue("fakeKey", ""));
+}
+
+TEST_F(ConfigCatClientTest, ForceRefreshAsyncCancelledByClose) {
+    auto asyncHttpSessionAdapter = make_shared<MockAsyncHttpSessionAdapter>();
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = asyncHttpSessionAdapter;
+    client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    optional<RefreshResult> refreshResult;
+    client->forceRefreshAsync([&](RefreshResult result) { refreshResult = result; });
+    EXPECT_FALSE(refreshResult.has_value());
+
+    // Closing the client cancels the ongoing request.
+    ConfigCatClient::close(client);
+
+    ASSERT_TRUE(refreshResult.has_value());
+    EXPECT_FALSE(refreshResult->success());
+    EXPECT_TRUE(refreshResult->errorMessage->find("cancelled") != string::npos);
+    EXPECT_EQ(0, asyncHttpSessionAdapter->pendingCount());
+}
+
+TEST_F(ConfigCatClientTest, AdapterWithoutGetOrGetAsync) {
+    class IncompleteHttpSessionAdapter : public configcat::HttpSessionAdapter {
+    public:
+        bool init(uint32_t connectTimeoutMs, uint32_t readTimeoutMs) override { return true; }
+        void close() override {}
+    };
+
+    auto adapter = make_shared<IncompleteHttpSessionAdapter>();
+    EXPECT_THROW(adapter->get("https://example.com", {}, {}, {}), logic_error);
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = adapter;
+    client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    // The default implementations of `get` and `getAsync` don't call each other endlessly.
+    auto result = client->forceRefresh();
+
+    EXPECT_FALSE(result.success());
+    ASSERT_TRUE(result.errorException);
+    EXPECT_THROW(rethrow_exception(result.errorException), logic_error);
+}
+
+TEST_F(ConfigCatClientTest, WaitForReady) {
+    configcat::Response response = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"fake"})")};
+    constexpr int responseDelay = 1;
+    mockHttpSessionAdapter->enqueueResponse(response, responseDelay);
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::autoPoll(60, 5);
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.waitForInitOnEvaluation = false;
+    client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    EXPECT_EQ("default", client->getValue("fakeKey", "default"));
+    EXPECT_FALSE(client->waitForReady(chrono::milliseconds(100)));
+
+    EXPECT_TRUE(client->waitForReady(chrono::seconds(5)));
+    EXPECT_EQ("fake", client->getValue("fakeKey", "default"));
+
+    bool readyCallbackInvoked = false;
+    client->onReady([&] { readyCallbackInvoked = true; });
+    EXPECT_TRUE(readyCallbackInvoked);
+}
+
+TEST_F(ConfigCatClientTest, EvaluateFromOnReady) {
+    configcat::Response response = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"fake"})")};
+    constexpr int responseDelay = 1;
+    mockHttpSessionAdapter->enqueueResponse(response, responseDelay);
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::autoPoll(60, 5);
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.waitForInitOnEvaluation = false;
+    client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    // The callback is invoked on the thread completing the fetch, but not under the locks of the client.
+    promise<string> value;
+    client->onReady([&] { value.set_value(client->getValue("fakeKey", "default")); });
+
+    auto future = value.get_future();
+    ASSERT_EQ(future_status::ready, future.wait_for(chrono::seconds(5)));
+    EXPECT_EQ("fake", future.get());
+}
+
+TEST_F(ConfigCatClientTest, CloseFromOnClientReady) {
+    configcat::Response response = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"fake"})")};
+    mockHttpSessionAdapter->enqueueResponse(response);
+
+    // The hook is invoked on the worker of the polling tick, closing the client there must not wait for the tick.
+    promise<shared_ptr<ConfigCatClient>> createdClient;
+    auto createdClientFuture = createdClient.get_future().share();
+    promise<void> closed;
+    auto hooks = make_shared<Hooks>();
+    hooks->addOnClientReady([&, createdClientFuture] {
+        ConfigCatClient::close(createdClientFuture.get());
+        closed.set_value();
+    });
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::autoPoll(60, 5);
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.hooks = hooks;
+    client = ConfigCatClient::get(kTestSdkKey, &options);
+    createdClient.set_value(client);
+
+    ASSERT_EQ(future_status::ready, closed.get_future().wait_for(chrono::seconds(5)));
+    EXPECT_EQ(0, ConfigCatClient::instanceCount());
+}
+
+TEST_F(ConfigCatClientTest, CloseFromConfigChangedOnPollingTick) {
+    configcat::Response response = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"fake"})")};
+    mockHttpSessionAdapter->enqueueResponse(response);
+
+    promise<shared_ptr<ConfigCatClient>> createdClient;
+    auto createdClientFuture = createdClient.get_future().share();
+    promise<void> closed;
+    auto hooks = make_shared<Hooks>();
+    hooks->addOnConfigChanged([&, createdClientFuture](std::shared_ptr<const Settings>) {
+        ConfigCatClient::close(createdClientFuture.get());
+        closed.set_value();
+    });
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::autoPoll(60, 5);
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.hooks = hooks;
+    client = ConfigCatClient::get(kTestSdkKey, &options);
+    createdClient.set_value(client);
+
+    ASSERT_EQ(future_status::ready, closed.get_future().wait_for(chrono::seconds(5)));
+    EXPECT_EQ(0, ConfigCatClient::instanceCount());
+}
+
+#ifdef CONFIGCAT_TEST_EMBEDDED_CONFIG
+
+TEST_F(ConfigCatClientTest, InitialConfig) {
+    configcat::Response response = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"fetched"})")};
+    constexpr int responseDelay = 1;
+    mockHttpSessionAdapter->enqueueResponse(response, responseDelay);
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::autoPoll(60, 5);
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.initialConfig = test_embedded_config.config();
+    client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    // The embedded snapshot is evaluated without waiting for the first fetch.
+    auto startTime = chrono::steady_clock::now();
+    EXPECT_EQ("private", client->getValue("mainStringFlag", ""));
+    EXPECT_LT(chrono::duration<double>(chrono::steady_clock::now() - startTime).count(), 0.5);
+
+    // The snapshot is replaced by the fetched config.
+    EXPECT_TRUE(client->waitForReady(chrono::seconds(5)));
+    EXPECT_EQ("fetched", client->getValue("fakeKey", ""));
+    EXPECT_EQ("", client->getValue("mainStringFlag", ""));
+}
+
+TEST_F(ConfigCatClientTest, InitialConfigIsNotWrittenToTheCacheOnInvalidSdkKey) {
+    mockHttpSessionAdapter->enqueueResponse({403, ""});
+
+    auto configCache = make_shared<InMemoryConfigCache>();
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.initialConfig = test_embedded_config.config();
+    options.configCache = configCache;
+    options.logger = make_shared<TestLogger>();
+    client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    EXPECT_FALSE(client->forceRefresh().success());
+
+    // The cache shared with other clients doesn't get an entry without a config JSON.
+    EXPECT_TRUE(configCache->store[ConfigService::generateCacheKey(kTestSdkKey)].empty());
+    EXPECT_EQ("private", client->getValue("mainStringFlag", ""));
+}
+
+TEST_F(ConfigCatClientTest, EmbeddedConfigIsBuiltOnce) {
+    EXPECT_EQ(test_embedded_config.config(), test_embedded_config.config());
+}
+
+TEST_F(ConfigCatClientTest, EmbeddedConfigMatchesTheParsedConfig) {
+    const auto directoryPath = RemoveFileName(__FILE__);
+    for (const auto& [embeddedConfig, fileName] : { make_pair(&test_embedded_config, "data/test_override_flagdependency_v6.json"),
+                                                    make_pair(&test_embedded_segments_config, "data/test_override_segments_v6.json") }) {
+        ifstream file(directoryPath + fileName);
+        const string jsonString((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+        auto config = embeddedConfig->config();
+        EXPECT_EQ(Config::fromJson(jsonString)->toJson(), Config(*config).toJson()) << fileName;
+    }
+}
+
+TEST_F(ConfigCatClientTest, LazyLoadServesInitialConfigWhileFetching) {
+    configcat::Response response = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"fetched"})")};
+    constexpr int responseDelay = 2;
+    mockHttpSessionAdapter->enqueueResponse(response, responseDelay);
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::lazyLoad(120);
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.initialConfig = test_embedded_config.config();
+    client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    // The snapshot is served right away, the first fetch runs in the background.
+    auto startTime = chrono::steady_clock::now();
+    EXPECT_EQ("private", client->getValue("mainStringFlag", ""));
+    EXPECT_EQ("private", client->getValue("mainStringFlag", ""));
+    EXPECT_LT(chrono::duration<double>(chrono::steady_clock::now() - startTime).count(), 1.0);
+
+    // The fetched config replaces the snapshot when it arrives, a single fetch is started for all the evaluations.
+    for (int i = 0; i < 50 && client->getValue("fakeKey", "") != "fetched"; ++i) {
+        sleep_for(chrono::milliseconds(100));
+    }
+    EXPECT_EQ("fetched", client->getValue("fakeKey", ""));
+    EXPECT_EQ(1, mockHttpSessionAdapter->requests.size());
+}
+
+#endif // CONFIGCAT_TEST_EMBEDDED_CONFIG
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "mock.h"
+#include "localcdn.h"
 #include "configcat/configcatclient.h"
 
 using namespace configcat;
@@ -40,3 +41,161 @@ TEST(ConfigCatClientIntegrationTest, DISABLED_ProxyTest) {
     auto value = client->getValue("stringDefaultCat", "");
     EXPECT_EQ("Cat", value);
 }
+
+#ifndef _WIN32
+
+TEST(ConfigCatClientIntegrationTest, SharedFetchEngine) {
+    static constexpr char kSdkKey1[] = "LocalCdnKey-3456789012/1234567890123456789012";
+    static constexpr char kSdkKey2[] = "LocalCdnKey-3456789012/2234567890123456789012";
+    LocalCdn cdn;
+    cdn.setConfigJson(kSdkKey1, R"({"f":{"stringDefaultCat":{"t":1,"v":{"s":"Cat"}}}})");
+    cdn.setConfigJson(kSdkKey2, R"({"f":{"stringDefaultCat":{"t":1,"v":{"s":"Dog"}}}})");
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.baseUrl = cdn.getBaseUrl();
+    options.httpTransport.sharedFetchEngine = true;
+    auto client1 = ConfigCatClient::get(kSdkKey1, &options);
+    auto client2 = ConfigCatClient::get(kSdkKey2, &options);
+
+    // The fetches of both clients run concurrently on the I/O thread of the engine.
+    RefreshResult result2;
+    thread refreshThread([&] { result2 = client2->forceRefresh(); });
+    auto result1 = client1->forceRefresh();
+    refreshThread.join();
+
+    EXPECT_TRUE(result1.success());
+    EXPECT_TRUE(result2.success());
+    EXPECT_EQ("Cat", client1->getValue("stringDefaultCat", ""));
+    EXPECT_EQ("Dog", client2->getValue("stringDefaultCat", ""));
+    EXPECT_EQ(2, cdn.getRequestCount());
+
+    ConfigCatClient::close(client1);
+    ConfigCatClient::close(client2);
+}
+
+TEST(ConfigCatClientIntegrationTest, SharedFetchEngineCompletesAsynchronously) {
+    static constexpr char kSdkKey[] = "LocalCdnKey-3456789012/1234567890123456789012";
+    LocalCdn::Options cdnOptions;
+    cdnOptions.latency = chrono::milliseconds(200);
+    LocalCdn cdn(cdnOptions);
+    cdn.setConfigJson(kSdkKey, R"({"f":{"stringDefaultCat":{"t":1,"v":{"s":"Cat"}}}})");
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.baseUrl = cdn.getBaseUrl();
+    options.httpTransport.sharedFetchEngine = true;
+    auto client = ConfigCatClient::get(kSdkKey, &options);
+
+    // The request is completed on the I/O thread of the engine, the calling thread isn't blocked by it.
+    promise<pair<RefreshResult, thread::id>> completion;
+    auto future = completion.get_future();
+    const auto start = chrono::steady_clock::now();
+    client->forceRefreshAsync([&completion](RefreshResult result) {
+        completion.set_value({ result, this_thread::get_id() });
+    });
+    EXPECT_LT(chrono::steady_clock::now() - start, cdnOptions.latency);
+
+    auto [result, completingThread] = future.get();
+    EXPECT_TRUE(result.success());
+    EXPECT_NE(this_thread::get_id(), completingThread);
+    EXPECT_EQ("Cat", client->getValue("stringDefaultCat", ""));
+
+    ConfigCatClient::close(client);
+}
+
+TEST(ConfigCatClientIntegrationTest, HedgedFetch) {
+    static constexpr char kSdkKey[] = "LocalCdnKey-3456789012/1234567890123456789012";
+    static constexpr char kConfigJson[] = R"({"f":{"stringDefaultCat":{"t":1,"v":{"s":"Cat"}}}})";
+    LocalCdn::Options slowCdnOptions;
+    slowCdnOptions.latency = chrono::milliseconds(1000);
+    LocalCdn slowCdn(slowCdnOptions);
+    slowCdn.setConfigJson(kSdkKey, kConfigJson);
+    LocalCdn hedgeCdn;
+    hedgeCdn.setConfigJson(kSdkKey, kConfigJson);
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.baseUrl = slowCdn.getBaseUrl();
+    options.hedgeBaseUrl = hedgeCdn.getBaseUrl();
+    options.hedgeDelayMs = 50;
+    auto client = ConfigCatClient::get(kSdkKey, &options);
+
+    // Both requests run on the fetch engine, the hedged one answers first.
+    const auto start = chrono::steady_clock::now();
+    auto result = client->forceRefresh();
+    EXPECT_TRUE(result.success());
+    EXPECT_LT(chrono::steady_clock::now() - start, slowCdnOptions.latency);
+    EXPECT_EQ(1, hedgeCdn.getRequestCount());
+    EXPECT_EQ("Cat", client->getValue("stringDefaultCat", ""));
+
+    ConfigCatClient::close(client);
+}
+
+TEST(ConfigCatClientIntegrationTest, FetchTiming) {
+    static constexpr char kSdkKey[] = "LocalCdnKey-3456789012/1234567890123456789012";
+    static constexpr char kConfigJson[] = R"({"f":{"stringDefaultCat":{"t":1,"v":{"s":"Cat"}}}})";
+    LocalCdn cdn;
+    cdn.setConfigJson(kSdkKey, kConfigJson);
+
+    vector<FetchCompletedInfo> fetches;
+    auto hooks = make_shared<Hooks>();
+    hooks->addOnFetchCompleted([&](const FetchCompletedInfo& info) { fetches.push_back(info); });
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.baseUrl = cdn.getBaseUrl();
+    options.hooks = hooks;
+    auto client = ConfigCatClient::get(kSdkKey, &options);
+    client->forceRefresh();
+    client->forceRefresh();
+
+    // The local CDN is plain HTTP, so there's no TLS handshake to measure.
+    ASSERT_EQ(2, fetches.size());
+    ASSERT_TRUE(fetches[0].timing);
+    const auto& timing = *fetches[0].timing;
+    EXPECT_EQ(200, fetches[0].statusCode);
+    EXPECT_LE(timing.nameLookup, timing.connect);
+    EXPECT_EQ(0, timing.tlsHandshake.count());
+    EXPECT_LE(timing.connect, timing.firstByte);
+    EXPECT_LE(timing.firstByte, timing.total);
+    EXPECT_EQ(strlen(kConfigJson), timing.downloadedBytes);
+    EXPECT_FALSE(timing.connectionReused);
+
+    // The second fetch (304 Not Modified) goes over the same connection.
+    ASSERT_TRUE(fetches[1].timing);
+    EXPECT_EQ(304, fetches[1].statusCode);
+    EXPECT_TRUE(fetches[1].timing->connectionReused);
+
+    ConfigCatClient::close(client);
+}
+
+
+TEST(ConfigCatClientIntegrationTest, FetchWithoutConnectionReuse) {
+    static constexpr char kSdkKey[] = "LocalCdnKey-3456789012/1234567890123456789013";
+    static constexpr char kConfigJson[] = R"({"f":{"stringDefaultCat":{"t":1,"v":{"s":"Cat"}}}})";
+    LocalCdn cdn;
+    cdn.setConfigJson(kSdkKey, kConfigJson);
+
+    vector<FetchCompletedInfo> fetches;
+    auto hooks = make_shared<Hooks>();
+    hooks->addOnFetchCompleted([&](const FetchCompletedInfo& info) { fetches.push_back(info); });
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.baseUrl = cdn.getBaseUrl();
+    options.hooks = hooks;
+    options.httpTransport.connectionReuse = false;
+    auto client = ConfigCatClient::get(kSdkKey, &options);
+    client->forceRefresh();
+    client->forceRefresh();
+
+    ASSERT_EQ(2, fetches.size());
+    ASSERT_TRUE(fetches[1].timing);
+    EXPECT_EQ(304, fetches[1].statusCode);
+    EXPECT_FALSE(fetches[1].timing->connectionReused);
+
+    ConfigCatClient::close(client);
+}
+
+#endif
@@ -1,9 +1,13 @@
 #include <gtest/gtest.h>
+#include <fstream>
 #include "configfetcher.h"
+#include "pollscheduler.h"
+#include "streamingconfigparser.h"
 #include "configcat/configcatoptions.h"
 #include "configcatlogger.h"
 #include "configcat/consolelogger.h"
 #include "mock.h"
+#include "test.h"
 
 using namespace configcat;
 using namespace std;
@@ -277,6 +281,31 @@ TEST_F(ConfigFetcherTest, Fetcher_FetchNotModifiedEtag) {
     EXPECT_EQ(eTag, mockHttpSessionAdapter->requests.back().header["If-None-Match"]);
 }
 
+TEST_F(ConfigFetcherTest, Fetcher_IdenticalContentReusesConfig) {
+    SetUp();
+
+    configcat::Response firstResponse = {200, kTestJson, {{"etag", "test1"}}};
+    mockHttpSessionAdapter->enqueueResponse(firstResponse);
+    configcat::Response secondResponse = {200, kTestJson, {{"etag", "test2"}}};
+    mockHttpSessionAdapter->enqueueResponse(secondResponse);
+    configcat::Response thirdResponse = {200, R"({"f":{"fakeKey":{"t":1,"v":{"s":"fakeValue2"}}}})", {{"etag", "test3"}}};
+    mockHttpSessionAdapter->enqueueResponse(thirdResponse);
+
+    auto firstFetchResponse = fetcher->fetchConfiguration("");
+    EXPECT_TRUE(firstFetchResponse.isFetched());
+
+    auto secondFetchResponse = fetcher->fetchConfiguration("test1", firstFetchResponse.entry);
+    EXPECT_TRUE(secondFetchResponse.isFetched());
+    EXPECT_EQ("test2", secondFetchResponse.entry->eTag);
+    EXPECT_EQ(firstFetchResponse.entry->config, secondFetchResponse.entry->config);
+    EXPECT_GE(secondFetchResponse.entry->fetchTime, firstFetchResponse.entry->fetchTime);
+
+    auto thirdFetchResponse = fetcher->fetchConfiguration("test2", secondFetchResponse.entry);
+    EXPECT_TRUE(thirdFetchResponse.isFetched());
+    EXPECT_NE(secondFetchResponse.entry->config, thirdFetchResponse.entry->config);
+    EXPECT_EQ("fakeValue2", get<string>((*thirdFetchResponse.entry->config->settings)["fakeKey"].value));
+}
+
 TEST_F(ConfigFetcherTest, Fethcer_ServerSideEtag) {
     ConfigCatOptions options;
     options.pollingMode = PollingMode::manualPoll();
@@ -297,3 +326,149 @@ TEST_F(ConfigFetcherTest, Fethcer_ServerSideEtag) {
     EXPECT_TRUE(fetchResponse.isFetched());
     EXPECT_FALSE(fetchResponse.notModified());
 }
+
+class ConfigFetcherHedgingTest : public ::testing::Test {
+public:
+    static constexpr char kTestSdkKey[] = "TestSdkKey";
+    static constexpr char kPrimaryUrl[] = "https://primary.configcat.com";
+    static constexpr char kHedgeUrl[] = "https://hedge.configcat.com";
+    static constexpr char kTestJsonFormat[] = R"({"f":{"fakeKey":{"t":1,"v":{"s":"%s"}}}})";
+    shared_ptr<DelayedHttpSessionAdapter> httpSessionAdapter = make_shared<DelayedHttpSessionAdapter>();
+    shared_ptr<ConfigCatLogger> logger = make_shared<ConfigCatLogger>(make_shared<ConsoleLogger>(), make_shared<Hooks>());
+
+    unique_ptr<ConfigFetcher> createFetcher(uint32_t hedgeDelayMs) {
+        ConfigCatOptions options;
+        options.pollingMode = PollingMode::manualPoll();
+        options.httpSessionAdapter = httpSessionAdapter;
+        options.baseUrl = kPrimaryUrl;
+        options.hedgeDelayMs = hedgeDelayMs;
+        options.hedgeBaseUrl = kHedgeUrl;
+        return make_unique<ConfigFetcher>(kTestSdkKey, logger, "m", options);
+    }
+
+    static string getValue(const FetchResponse& response) {
+        return get<string>((*response.entry->config->getSettingsOrEmpty())["fakeKey"].value);
+    }
+};
+
+TEST_F(ConfigFetcherHedgingTest, SlowPrimaryIsHedged) {
+    httpSessionAdapter->setResponse(kPrimaryUrl, {200, string_format(kTestJsonFormat, "primary")}, 3000);
+    httpSessionAdapter->setResponse(kHedgeUrl, {200, string_format(kTestJsonFormat, "hedge")});
+    auto fetcher = createFetcher(100);
+
+    auto startTime = chrono::steady_clock::now();
+    auto response = fetcher->fetchConfiguration();
+    auto elapsedTime = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    EXPECT_TRUE(response.isFetched());
+    EXPECT_EQ("hedge", getValue(response));
+    EXPECT_LT(elapsedTime, 1);
+    EXPECT_EQ(2, httpSessionAdapter->getRequestedUrls().size());
+}
+
+TEST_F(ConfigFetcherHedgingTest, FastPrimaryIsNotHedged) {
+    httpSessionAdapter->setResponse(kPrimaryUrl, {200, string_format(kTestJsonFormat, "primary")});
+    httpSessionAdapter->setResponse(kHedgeUrl, {200, string_format(kTestJsonFormat, "hedge")});
+    auto fetcher = createFetcher(500);
+    const auto timerCount = PollScheduler::getInstance()->timerCount();
+
+    auto response = fetcher->fetchConfiguration();
+
+    EXPECT_TRUE(response.isFetched());
+    EXPECT_EQ("primary", getValue(response));
+    auto requestedUrls = httpSessionAdapter->getRequestedUrls();
+    ASSERT_EQ(1, requestedUrls.size());
+    EXPECT_EQ(0, requestedUrls[0].rfind(kPrimaryUrl, 0));
+    // The timer of the hedged request is cancelled when the fetch finishes.
+    EXPECT_EQ(timerCount, PollScheduler::getInstance()->timerCount());
+}
+
+TEST_F(ConfigFetcherHedgingTest, FailedHedgeWaitsForPrimary) {
+    httpSessionAdapter->setResponse(kPrimaryUrl, {200, string_format(kTestJsonFormat, "primary")}, 500);
+    httpSessionAdapter->setResponse(kHedgeUrl, {500, ""});
+    auto fetcher = createFetcher(100);
+
+    auto response = fetcher->fetchConfiguration();
+
+    EXPECT_TRUE(response.isFetched());
+    EXPECT_EQ("primary", getValue(response));
+    EXPECT_EQ(2, httpSessionAdapter->getRequestedUrls().size());
+}
+
+TEST_F(ConfigFetcherTest, StreamingParse) {
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.streamingParse = true;
+    fetcher = make_unique<ConfigFetcher>(kTestSdkKey, logger, "m", options);
+    mockHttpSessionAdapter->streamChunkSize = 7;
+
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson, {{"ETag", "test-etag"}}});
+    auto fetchResponse = fetcher->fetchConfiguration();
+    ASSERT_TRUE(fetchResponse.isFetched());
+    EXPECT_EQ(kTestJson, fetchResponse.entry->configJsonString());
+    EXPECT_EQ("fakeValue", std::get<string>((*fetchResponse.entry->config->getSettingsOrEmpty())["fakeKey"].value));
+
+    // The unchanged content reuses the previous config.
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson, {{"ETag", "test-etag2"}}});
+    auto secondResponse = fetcher->fetchConfiguration("test-etag", fetchResponse.entry);
+    ASSERT_TRUE(secondResponse.isFetched());
+    EXPECT_EQ(fetchResponse.entry->config, secondResponse.entry->config);
+    EXPECT_EQ("test-etag2", secondResponse.entry->eTag);
+
+    // The body of the failed responses is not streamed.
+    mockHttpSessionAdapter->enqueueResponse({500, "error"});
+    EXPECT_TRUE(fetcher->fetchConfiguration().isFailed());
+}
+
+TEST_F(ConfigFetcherTest, StreamingParseInvalidJson) {
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.streamingParse = true;
+    fetcher = make_unique<ConfigFetcher>(kTestSdkKey, logger, "m", options);
+    mockHttpSessionAdapter->streamChunkSize = 5;
+
+    mockHttpSessionAdapter->enqueueResponse({200, R"({"f":{"fakeKey":)"});
+    auto fetchResponse = fetcher->fetchConfiguration();
+    EXPECT_TRUE(fetchResponse.isFailed());
+    EXPECT_TRUE(fetchResponse.isTransientError);
+    EXPECT_EQ(ConfigEntry::empty, fetchResponse.entry);
+}
+
+TEST(StreamingConfigParserTest, DecodesToTheSameConfig) {
+    const auto directoryPath = RemoveFileName(__FILE__);
+    for (const auto& fileName : { "data/test_override_segments_v6.json", "data/test_override_flagdependency_v6.json", "data/comparison_attribute_conversion.json" }) {
+        ifstream file(directoryPath + fileName);
+        const string jsonString((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        const auto expectedJson = Config::fromJson(jsonString)->toJson();
+
+        // The members and the settings are completed by different chunks, down to single characters.
+        for (const size_t chunkSize : { size_t(1), size_t(7), size_t(4096) }) {
+            for (const bool configArena : { false, true }) {
+                StreamingConfigParser parser(configArena);
+                for (size_t position = 0; position < jsonString.size(); position += chunkSize) {
+                    parser.append(jsonString.data() + position, min(chunkSize, jsonString.size() - position));
+                }
+                EXPECT_EQ(expectedJson, parser.finish()->toJson()) << fileName << ", chunk size: " << chunkSize;
+                EXPECT_EQ(jsonString, parser.getText());
+            }
+        }
+    }
+}
+
+TEST(StreamingConfigParserTest, RejectsInvalidJson) {
+    for (const string jsonString : {
+        R"({"f":{"fakeKey":{"t":1,"v":{"s":"fakeValue"}}})",        // truncated
+        R"({"f":{"fakeKey":{"t":1,"v":{"s":"fakeValue"}}}} x)",     // trailing garbage
+        R"({"f":{"fakeKey":{"t":1,"v":{"s":"fakeValue"}}}}{})",     // second root
+        R"({"f":{"fakeKey" {"t":1,"v":{"s":"fakeValue"}}}})",       // missing colon
+        R"({"p":{"s":"salt"},})",                                    // trailing comma
+        R"(["f"])",
+        ""
+    }) {
+        StreamingConfigParser parser;
+        parser.append(jsonString.data(), jsonString.size());
+        EXPECT_ANY_THROW(parser.finish()) << jsonString;
+    }
+}
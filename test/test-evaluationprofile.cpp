@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include "mock.h"
+#include "configcat/configcat.h"
+
+using namespace configcat;
+using namespace std;
+
+class EvaluationProfileTest : public ::testing::Test {
+public:
+    static constexpr char kTestSdkKey[] = "TestSdkKey-23456789012/1234567890123456789012";
+    static constexpr char kTestJson[] = R"({"p":{"u":"https://cdn-global.configcat.com","r":0,"s":"salt"},"f":{)"
+        R"("rules":{"t":0,"v":{"b":false},"r":[)"
+            R"({"c":[{"u":{"a":"Email","c":0,"l":["a@example.com"]}}],"s":{"v":{"b":true}}},)"
+            R"({"c":[{"u":{"a":"Email","c":0,"l":["b@example.com"]}},{"u":{"a":"Country","c":0,"l":["HU"]}}],"s":{"v":{"b":true}}})"
+        R"(]},)"
+        R"("percentage":{"t":0,"v":{"b":false},"p":[{"p":30,"v":{"b":true}},{"p":70,"v":{"b":false}}]},)"
+        R"("simple":{"t":1,"v":{"s":"value"}})"
+        R"(}})";
+
+    shared_ptr<ConfigCatClient> client = nullptr;
+    shared_ptr<MockHttpSessionAdapter> mockHttpSessionAdapter = make_shared<MockHttpSessionAdapter>();
+
+    void createClient(bool profileEvaluations = true) {
+        mockHttpSessionAdapter->enqueueResponse({200, kTestJson});
+
+        ConfigCatOptions options;
+        options.pollingMode = PollingMode::manualPoll();
+        options.httpSessionAdapter = mockHttpSessionAdapter;
+        options.logger = make_shared<TestLogger>();
+        options.profileEvaluations = profileEvaluations;
+        client = ConfigCatClient::get(kTestSdkKey, &options);
+        client->forceRefresh();
+    }
+
+    void TearDown() override {
+        ConfigCatClient::closeAll();
+    }
+
+    const FlagProfile& findFlag(const EvaluationProfile& profile, const string& key) {
+        const auto it = find_if(profile.flags.begin(), profile.flags.end(), [&](const FlagProfile& flag) { return flag.key == key; });
+        EXPECT_NE(profile.flags.end(), it);
+        return *it;
+    }
+};
+
+TEST_F(EvaluationProfileTest, DisabledByDefault) {
+    createClient(false);
+    client->getValue("simple", "");
+
+    EXPECT_TRUE(client->evaluationProfile().flags.empty());
+}
+
+TEST_F(EvaluationProfileTest, RulesAndConditions) {
+    createClient();
+
+    const auto firstRuleUser = ConfigCatUser::create("id", "a@example.com");
+    const auto secondRuleUser = ConfigCatUser::create("id", "b@example.com", "HU");
+    const auto otherUser = ConfigCatUser::create("id", "b@example.com", "DE");
+    EXPECT_TRUE(client->getValue("rules", false, firstRuleUser));
+    EXPECT_TRUE(client->getValue("rules", false, secondRuleUser));
+    EXPECT_TRUE(client->getValueDetails("rules", false, secondRuleUser).value);
+    EXPECT_FALSE(client->getValue("rules", false, otherUser));
+
+    const auto profile = client->evaluationProfile();
+    const auto& flag = findFlag(profile, "rules");
+    EXPECT_EQ(4, flag.evaluations);
+    EXPECT_EQ(1 + 2 + 2 + 2, flag.targetingRulesVisited);
+    EXPECT_EQ(1 + 3 + 3 + 3, flag.conditionsVisited);
+    EXPECT_EQ(0, flag.shaComputations);
+    EXPECT_EQ((map<int, uint64_t>{{-1, 1}, {0, 1}, {1, 2}}), flag.matchedRules);
+    EXPECT_GT(flag.totalTime.count(), 0);
+}
+
+TEST_F(EvaluationProfileTest, ShaComputations) {
+    createClient();
+
+    const auto user = ConfigCatUser::create("id");
+    client->getValue("percentage", false, user);
+    client->getValue("percentage", false, user);
+    client->getValue("percentage", false); // no user, no hash
+
+    const auto profile = client->evaluationProfile();
+    const auto& flag = findFlag(profile, "percentage");
+    EXPECT_EQ(3, flag.evaluations);
+    EXPECT_EQ(2, flag.shaComputations);
+    EXPECT_EQ((map<int, uint64_t>{{-1, 3}}), flag.matchedRules);
+}
+
+TEST_F(EvaluationProfileTest, FailedEvaluationsAreRecorded) {
+    createClient();
+
+    EXPECT_EQ(42, client->getValue("simple", 42)); // type mismatch
+
+    const auto profile = client->evaluationProfile();
+    EXPECT_EQ(1, findFlag(profile, "simple").evaluations);
+}
+
+TEST_F(EvaluationProfileTest, Report) {
+    createClient();
+
+    const auto user = ConfigCatUser::create("id", "a@example.com");
+    for (int i = 0; i < 3; ++i) {
+        client->getValue("rules", false, user);
+    }
+    client->getValue("simple", "");
+    client->getValue("percentage", false, user);
+
+    const auto profile = client->evaluationProfile();
+    ASSERT_EQ(3, profile.flags.size());
+    for (size_t i = 1; i < profile.flags.size(); ++i) {
+        EXPECT_GE(profile.flags[i - 1].totalTime, profile.flags[i].totalTime);
+    }
+
+    const auto report = profile.toReport(2);
+    EXPECT_NE(string::npos, report.find("Top 2 most expensive flags (by total evaluation time, 3 flags profiled):\n"));
+    const auto hotSection = report.find("Top 2 hottest flags (by evaluation count):\n");
+    ASSERT_NE(string::npos, hotSection);
+    // The hottest flag is listed first, with its most frequently matched rule.
+    const auto hotTable = report.substr(hotSection);
+    const auto firstRow = hotTable.substr(hotTable.find('\n', hotTable.find("top match")) + 1);
+    EXPECT_EQ(0, firstRow.find("  rules "));
+    EXPECT_NE(string::npos, firstRow.substr(0, firstRow.find('\n')).find("#0 (100%)"));
+}
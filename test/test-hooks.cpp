@@ -151,3 +151,181 @@ TEST_F(HooksTest, Evaluation) {
 
     ConfigCatClient::close(client);
 }
+
+TEST_F(HooksTest, ConfigChangedWithDiffAndFlagChanged) {
+    static constexpr char kTestJsonFormat[] = R"({"f":{"key1":{"t":1,"v":{"s":"%s"}},"key2":{"t":1,"v":{"s":"value2"}}}})";
+    configcat::Response firstResponse = {200, string_format(kTestJsonFormat, "value1")};
+    mockHttpSessionAdapter->enqueueResponse(firstResponse);
+    configcat::Response secondResponse = {200, string_format(kTestJsonFormat, "changed")};
+    mockHttpSessionAdapter->enqueueResponse(secondResponse);
+
+    vector<ConfigDiff> diffs;
+    vector<string> changedFlags;
+    auto hooks = make_shared<Hooks>();
+    hooks->addOnConfigChangedWithDiff([&](std::shared_ptr<const configcat::Settings>, const ConfigDiff& diff) { diffs.push_back(diff); });
+    hooks->addOnFlagChanged("key1", [&](const string& key) { changedFlags.push_back(key); });
+    hooks->addOnFlagChanged("key3", [&](const string& key) { changedFlags.push_back(key); });
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.hooks = hooks;
+    auto client = ConfigCatClient::get("test-67890123456789012/1234567890123456789012", &options);
+
+    client->forceRefresh();
+
+    ASSERT_EQ(1, diffs.size());
+    EXPECT_EQ((vector<string>{ "key1", "key2" }), diffs[0].addedKeys);
+    EXPECT_EQ(vector<string>{ "key1" }, changedFlags);
+
+    client->forceRefresh();
+
+    ASSERT_EQ(2, diffs.size());
+    EXPECT_TRUE(diffs[1].addedKeys.empty());
+    EXPECT_EQ(vector<string>{ "key1" }, diffs[1].modifiedKeys);
+    EXPECT_EQ((vector<string>{ "key1", "key1" }), changedFlags);
+
+    ConfigCatClient::closeAll();
+}
+
+TEST_F(HooksTest, RemoveConfigChangedWithDiffAndFlagChanged) {
+    static constexpr char kTestJsonFormat[] = R"({"f":{"key1":{"t":1,"v":{"s":"%s"}}}})";
+    configcat::Response firstResponse = {200, string_format(kTestJsonFormat, "value1")};
+    mockHttpSessionAdapter->enqueueResponse(firstResponse);
+    configcat::Response secondResponse = {200, string_format(kTestJsonFormat, "changed")};
+    mockHttpSessionAdapter->enqueueResponse(secondResponse);
+
+    int diffCount = 0;
+    vector<string> changedFlags;
+    auto hooks = make_shared<Hooks>();
+    const auto diffId = hooks->addOnConfigChangedWithDiff([&](std::shared_ptr<const configcat::Settings>, const ConfigDiff&) { ++diffCount; });
+    const auto flagId = hooks->addOnFlagChanged("key1", [&](const string& key) { changedFlags.push_back("removed " + key); });
+    hooks->addOnFlagChanged("key1", [&](const string& key) { changedFlags.push_back(key); });
+    EXPECT_NE(diffId, flagId);
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.hooks = hooks;
+    auto client = ConfigCatClient::get("test-67890123456789012/1234567890123456789012", &options);
+
+    client->forceRefresh();
+
+    EXPECT_EQ(1, diffCount);
+    EXPECT_EQ((vector<string>{ "removed key1", "key1" }), changedFlags);
+
+    EXPECT_TRUE(hooks->removeOnConfigChangedWithDiff(diffId));
+    EXPECT_TRUE(hooks->removeOnFlagChanged(flagId));
+    EXPECT_FALSE(hooks->removeOnFlagChanged(flagId));
+    EXPECT_FALSE(hooks->removeOnConfigChangedWithDiff(flagId));
+
+    client->forceRefresh();
+
+    EXPECT_EQ(1, diffCount);
+    EXPECT_EQ((vector<string>{ "removed key1", "key1", "key1" }), changedFlags);
+
+    ConfigCatClient::closeAll();
+}
+
+TEST_F(HooksTest, ConfigChangedWithDiffCanEvaluate) {
+    static constexpr char kTestJsonFormat[] = R"({"f":{"key1":{"t":1,"v":{"s":"%s"}}}})";
+    configcat::Response firstResponse = {200, string_format(kTestJsonFormat, "value1")};
+    mockHttpSessionAdapter->enqueueResponse(firstResponse);
+    configcat::Response secondResponse = {200, string_format(kTestJsonFormat, "changed")};
+    mockHttpSessionAdapter->enqueueResponse(secondResponse);
+
+    // The diff is computed and delivered once the client released its locks, so the subscribers may use the client.
+    shared_ptr<ConfigCatClient> client;
+    vector<string> values;
+    auto hooks = make_shared<Hooks>();
+    hooks->addOnFlagChanged("key1", [&](const string& key) { values.push_back(client->getValue(key, string())); });
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.hooks = hooks;
+    client = ConfigCatClient::get("test-67890123456789012/1234567890123456789012", &options);
+
+    client->forceRefresh();
+    client->forceRefresh();
+
+    EXPECT_EQ((vector<string>{ "value1", "changed" }), values);
+
+    ConfigCatClient::closeAll();
+}
+
+TEST_F(HooksTest, ConfigChangedWithLazySettingDecoding) {
+    static constexpr char kTestJson[] = R"({"f":{"key1":{"t":1,"v":{"s":"value1"}}}})";
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson});
+
+    string value;
+    auto hooks = make_shared<Hooks>();
+    hooks->addOnConfigChanged([&](std::shared_ptr<const configcat::Settings> settings) {
+        // The subscribers get decoded settings.
+        value = get<string>(settings->at("key1").value);
+    });
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.hooks = hooks;
+    options.lazySettingDecoding = true;
+    auto client = ConfigCatClient::get("test-67890123456789012/1234567890123456789012", &options);
+
+    client->forceRefresh();
+
+    EXPECT_EQ("value1", value);
+
+    ConfigCatClient::closeAll();
+}
+
+TEST_F(HooksTest, FetchCompleted) {
+    static constexpr char kTestJson[] = R"({"f":{"key1":{"t":1,"v":{"s":"value1"}}}})";
+    configcat::Response firstResponse = {200, kTestJson, {{"ETag", "etag1"}}};
+    ResponseTiming timing;
+    timing.nameLookup = microseconds(100);
+    timing.connect = microseconds(300);
+    timing.tlsHandshake = microseconds(900);
+    timing.firstByte = microseconds(1500);
+    timing.total = microseconds(1600);
+    timing.downloadedBytes = sizeof(kTestJson) - 1;
+    firstResponse.timing = timing;
+    mockHttpSessionAdapter->enqueueResponse(firstResponse);
+    mockHttpSessionAdapter->enqueueResponse({304, ""});
+    mockHttpSessionAdapter->enqueueResponse({500, ""});
+
+    vector<FetchCompletedInfo> fetches;
+    auto hooks = make_shared<Hooks>();
+    hooks->addOnFetchCompleted([&](const FetchCompletedInfo& info) { fetches.push_back(info); });
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.hooks = hooks;
+    options.logger = make_shared<TestLogger>();
+    auto client = ConfigCatClient::get("test-67890123456789012/1234567890123456789012", &options);
+
+    client->forceRefresh();
+    client->forceRefresh();
+    client->forceRefresh();
+
+    ASSERT_EQ(3, fetches.size());
+    EXPECT_EQ(FetchCompletedInfo::Result::fetched, fetches[0].result);
+    EXPECT_EQ(200, fetches[0].statusCode);
+    EXPECT_FALSE(fetches[0].errorMessage);
+    ASSERT_TRUE(fetches[0].timing);
+    EXPECT_EQ(microseconds(900), fetches[0].timing->tlsHandshake);
+    EXPECT_EQ(microseconds(1500), fetches[0].timing->firstByte);
+    EXPECT_EQ(sizeof(kTestJson) - 1, fetches[0].timing->downloadedBytes);
+    EXPECT_GT(fetches[0].duration.count(), 0);
+
+    EXPECT_EQ(FetchCompletedInfo::Result::notModified, fetches[1].result);
+    EXPECT_EQ(304, fetches[1].statusCode);
+    EXPECT_FALSE(fetches[1].timing); // not measured by the mock adapter
+
+    EXPECT_EQ(FetchCompletedInfo::Result::failed, fetches[2].result);
+    EXPECT_EQ(500, fetches[2].statusCode);
+    EXPECT_TRUE(fetches[2].errorMessage);
+
+    ConfigCatClient::closeAll();
+}
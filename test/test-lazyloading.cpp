@@ -251,3 +251,107 @@ TEST_F(LazyLoadingTest, InitOffline) {
     EXPECT_EQ("test", std::get<string>((*settings)["fakeKey"].value));
     EXPECT_EQ(1, mockHttpSessionAdapter->requests.size());
 }
+
+TEST_F(LazyLoadingTest, StaleWhileRevalidate) {
+    configcat::Response firstResponse = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"test"})")};
+    mockHttpSessionAdapter->enqueueResponse(firstResponse);
+    configcat::Response secondResponse = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"test2"})")};
+    constexpr int secondResponseDelay = 1;
+    mockHttpSessionAdapter->enqueueResponse(secondResponse, secondResponseDelay);
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::lazyLoad(1, true);
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    auto service = ConfigService(kTestSdkKey, logger, make_shared<Hooks>(), make_shared<NullConfigCache>(), options);
+
+    auto settings = *service.getSettings().settings;
+    EXPECT_EQ("test", std::get<string>(settings["fakeKey"].value));
+
+    // Wait for cache invalidation
+    sleep_for(milliseconds(1500));
+
+    // The expired config is served without waiting for the (slow) refresh.
+    auto startTime = steady_clock::now();
+    settings = *service.getSettings().settings;
+    EXPECT_EQ("test", std::get<string>(settings["fakeKey"].value));
+    settings = *service.getSettings().settings;
+    EXPECT_EQ("test", std::get<string>(settings["fakeKey"].value));
+    EXPECT_LT(duration<double>(steady_clock::now() - startTime).count(), 0.5);
+
+    // Wait for the background refresh
+    sleep_for(milliseconds(1500));
+
+    settings = *service.getSettings().settings;
+    EXPECT_EQ("test2", std::get<string>(settings["fakeKey"].value));
+    EXPECT_EQ(2, mockHttpSessionAdapter->requests.size());
+}
+
+TEST_F(LazyLoadingTest, StaleWhileRevalidateMaxStaleness) {
+    configcat::Response firstResponse = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"test"})")};
+    mockHttpSessionAdapter->enqueueResponse(firstResponse);
+    configcat::Response secondResponse = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"test2"})")};
+    mockHttpSessionAdapter->enqueueResponse(secondResponse);
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::lazyLoad(1, true, 1);
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    auto service = ConfigService(kTestSdkKey, logger, make_shared<Hooks>(), make_shared<NullConfigCache>(), options);
+
+    auto settings = *service.getSettings().settings;
+    EXPECT_EQ("test", std::get<string>(settings["fakeKey"].value));
+
+    // Wait beyond the refresh interval + the max staleness
+    sleep_for(milliseconds(2500));
+
+    // The config is too old to be served, the caller waits for the fresh one.
+    settings = *service.getSettings().settings;
+    EXPECT_EQ("test2", std::get<string>(settings["fakeKey"].value));
+}
+
+TEST_F(LazyLoadingTest, BackoffAndCircuitBreaker) {
+    mockHttpSessionAdapter->enqueueResponse({200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"test"})")});
+    for (int i = 0; i < 3; ++i) {
+        mockHttpSessionAdapter->enqueueResponse({500, ""});
+    }
+    mockHttpSessionAdapter->enqueueResponse({200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"test2"})")});
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::lazyLoad(1);
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    options.fetchRetry.initialBackoffMs = 300;
+    options.fetchRetry.circuitBreakerThreshold = 2;
+    options.fetchRetry.circuitBreakerOpenMs = 1000;
+    auto service = ConfigService(kTestSdkKey, logger, make_shared<Hooks>(), make_shared<NullConfigCache>(), options);
+
+    auto settings = *service.getSettings().settings;
+    EXPECT_EQ("test", std::get<string>(settings["fakeKey"].value));
+
+    // Wait for cache invalidation, the first failure backs off the reads in the meantime.
+    sleep_for(milliseconds(1100));
+    settings = *service.getSettings().settings;
+    EXPECT_EQ("test", std::get<string>(settings["fakeKey"].value));
+    settings = *service.getSettings().settings;
+    EXPECT_EQ(2, mockHttpSessionAdapter->requests.size());
+
+    // The second failure opens the breaker, even the explicit refresh doesn't hit the network.
+    sleep_for(milliseconds(400));
+    settings = *service.getSettings().settings;
+    EXPECT_EQ("test", std::get<string>(settings["fakeKey"].value));
+    EXPECT_EQ(3, mockHttpSessionAdapter->requests.size());
+    auto result = service.refresh();
+    EXPECT_FALSE(result.success());
+    settings = *service.getSettings().settings;
+    EXPECT_EQ(3, mockHttpSessionAdapter->requests.size());
+
+    // The failed probe reopens the breaker.
+    sleep_for(milliseconds(1100));
+    service.getSettings();
+    service.getSettings();
+    EXPECT_EQ(4, mockHttpSessionAdapter->requests.size());
+
+    // The successful probe closes it.
+    sleep_for(milliseconds(1100));
+    settings = *service.getSettings().settings;
+    EXPECT_EQ("test2", std::get<string>(settings["fakeKey"].value));
+    EXPECT_EQ(5, mockHttpSessionAdapter->requests.size());
+}
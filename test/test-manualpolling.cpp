@@ -163,3 +163,35 @@ TEST_F(ManualPollingTest, InitOffline) {
     EXPECT_EQ("test", std::get<string>(settings["fakeKey"].value));
     EXPECT_EQ(1, mockHttpSessionAdapter->requests.size());
 }
+
+TEST_F(ManualPollingTest, IdenticalContentDoesNotTriggerConfigChanged) {
+    configcat::Response firstResponse = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"test"})"), {{"etag", "test1"}}};
+    mockHttpSessionAdapter->enqueueResponse(firstResponse);
+    configcat::Response secondResponse = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"test"})"), {{"etag", "test2"}}};
+    mockHttpSessionAdapter->enqueueResponse(secondResponse);
+    configcat::Response thirdResponse = {200, string_format(kTestJsonFormat, SettingType::String, R"({"s":"test2"})"), {{"etag", "test3"}}};
+    mockHttpSessionAdapter->enqueueResponse(thirdResponse);
+
+    HookCallbacks hookCallbacks;
+    auto hooks = make_shared<Hooks>();
+    hooks->addOnConfigChanged([&](std::shared_ptr<const configcat::Settings> config) { hookCallbacks.onConfigChanged(config); });
+
+    ConfigCatOptions options;
+    options.pollingMode = PollingMode::manualPoll();
+    options.httpSessionAdapter = mockHttpSessionAdapter;
+    auto configCache = make_shared<InMemoryConfigCache>();
+    auto service = ConfigService(kTestSdkKey, logger, hooks, configCache, options);
+
+    service.refresh();
+    auto settings = service.getSettings().settings;
+    EXPECT_EQ(1, hookCallbacks.changedConfigCallCount);
+
+    service.refresh();
+    EXPECT_EQ(1, hookCallbacks.changedConfigCallCount);
+    EXPECT_EQ(settings, service.getSettings().settings);
+    EXPECT_NE(string::npos, configCache->store.begin()->second.find("\ntest2\n"));
+
+    service.refresh();
+    EXPECT_EQ(2, hookCallbacks.changedConfigCallCount);
+    EXPECT_EQ("test2", std::get<string>((*service.getSettings().settings)["fakeKey"].value));
+}
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include "mock.h"
+#include "configcat/configcat.h"
+
+using namespace configcat;
+using namespace std;
+
+class MemoryStatsTest : public ::testing::Test {
+public:
+    static constexpr char kTestSdkKey[] = "TestSdkKey-23456789012/1234567890123456789012";
+    static constexpr char kTestJson[] = R"({
+        "p": {"u": "https://cdn-global.configcat.com", "r": 0, "s": "test-salt-which-does-not-fit-in-the-small-buffer"},
+        "s": [{"n": "Beta users of the product", "r": [{"a": "Country", "c": 34, "l": ["Hungary", "United Kingdom of Great Britain and Northern Ireland"]}]}],
+        "f": {
+            "flag": {"t": 0, "v": {"b": false}, "i": "default-variation-id-0123456789", "r": [
+                {"c": [{"u": {"a": "Email", "c": 34, "l": ["john.doe@example.com", "jane.doe@example.com"]}}], "s": {"v": {"b": true}, "i": "rule-variation-id-0123456789"}},
+                {"c": [{"s": {"s": 0, "c": 0}}], "s": {"v": {"b": true}, "i": "segment-variation-id-0123456789"}}
+            ]},
+            "text": {"t": 1, "v": {"s": "a text value which does not fit in the small buffer"}, "i": "text-variation-id-0123456789"}
+        }
+    })";
+    static constexpr char kTestJson2[] = R"({"f":{"flag":{"t":0,"v":{"b":true},"i":"id"}}})";
+
+    shared_ptr<MockHttpSessionAdapter> mockHttpSessionAdapter = make_shared<MockHttpSessionAdapter>();
+
+    ConfigCatOptions createOptions() {
+        ConfigCatOptions options;
+        options.pollingMode = PollingMode::manualPoll();
+        options.httpSessionAdapter = mockHttpSessionAdapter;
+        options.configCache = make_shared<InMemoryConfigCache>();
+        return options;
+    }
+
+    void TearDown() override {
+        ConfigCatClient::closeAll();
+    }
+};
+
+TEST_F(MemoryStatsTest, NoConfig) {
+    const auto options = createOptions();
+    auto client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    const auto stats = client->memoryStats();
+
+    EXPECT_EQ(0, stats.totalBytes());
+    EXPECT_EQ(0, stats.retiredSnapshots);
+}
+
+TEST_F(MemoryStatsTest, Breakdown) {
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson});
+    const auto options = createOptions();
+    auto client = ConfigCatClient::get(kTestSdkKey, &options);
+    client->forceRefresh();
+    client->getValue("flag", false); // reads back the cache entry written by the refresh
+
+    const auto stats = client->memoryStats();
+
+    EXPECT_GT(stats.config.settings, 2 * sizeof(Setting));
+    EXPECT_GT(stats.config.segments, sizeof(Segment));
+    EXPECT_GT(stats.config.strings, strlen("test-salt-which-does-not-fit-in-the-small-buffer") + strlen("a text value which does not fit in the small buffer"));
+    EXPECT_EQ(4 * sizeof(string), stats.config.comparisonLists);
+    EXPECT_GT(stats.config.indexes, 2 * sizeof(void*));
+    EXPECT_EQ(0, stats.config.lazySource);
+    EXPECT_GT(stats.configJsonString, strlen(kTestJson));
+    EXPECT_GT(stats.cachedEntryString, strlen(kTestJson));
+    EXPECT_EQ(0, stats.retiredSnapshots);
+    EXPECT_EQ(stats.config.total() + stats.configJsonString + stats.cachedEntryString, stats.totalBytes());
+    EXPECT_NE(string::npos, stats.toString().find("comparison lists:"));
+}
+
+TEST_F(MemoryStatsTest, SharedObjectsAreCountedOnce) {
+    const auto oneFlag = Config::fromJson(R"({
+        "p": {"u": "https://cdn-global.configcat.com", "r": 0, "s": "test-salt-which-does-not-fit-in-the-small-buffer"},
+        "s": [{"n": "Beta", "r": [{"a": "Email", "c": 34, "l": ["an address which does not fit in the buffer"]}]}],
+        "f": {"a": {"t": 0, "v": {"b": false}, "r": [{"c": [{"s": {"s": 0, "c": 0}}], "s": {"v": {"b": true}}}]}}})");
+    const auto threeFlags = Config::fromJson(R"({
+        "p": {"u": "https://cdn-global.configcat.com", "r": 0, "s": "test-salt-which-does-not-fit-in-the-small-buffer"},
+        "s": [{"n": "Beta", "r": [{"a": "Email", "c": 34, "l": ["an address which does not fit in the buffer"]}]}],
+        "f": {"a": {"t": 0, "v": {"b": false}, "r": [{"c": [{"s": {"s": 0, "c": 0}}], "s": {"v": {"b": true}}}]},
+              "b": {"t": 0, "v": {"b": false}, "r": [{"c": [{"s": {"s": 0, "c": 0}}], "s": {"v": {"b": true}}}]},
+              "c": {"t": 0, "v": {"b": false}, "r": [{"c": [{"s": {"s": 0, "c": 0}}], "s": {"v": {"b": true}}}]}}})");
+
+    // The segments and the salt are referenced by each setting, but they are held only once.
+    EXPECT_EQ(oneFlag->memoryUsage().segments, threeFlags->memoryUsage().segments);
+    EXPECT_EQ(oneFlag->memoryUsage().strings, threeFlags->memoryUsage().strings);
+    EXPECT_EQ(oneFlag->memoryUsage().comparisonLists, threeFlags->memoryUsage().comparisonLists);
+    EXPECT_LT(oneFlag->memoryUsage().settings, threeFlags->memoryUsage().settings);
+}
+
+TEST_F(MemoryStatsTest, LazySettingDecoding) {
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson});
+    auto options = createOptions();
+    options.lazySettingDecoding = true;
+    auto client = ConfigCatClient::get(kTestSdkKey, &options);
+    client->forceRefresh();
+
+    const auto before = client->memoryStats();
+    // The config.json is shared between the lazy source and the cached entry, and it's counted once.
+    EXPECT_GT(before.configJsonString, strlen(kTestJson));
+    EXPECT_GT(before.config.lazySource, 0);
+    EXPECT_LT(before.config.lazySource, strlen(kTestJson));
+    // The segments are decoded up front.
+    EXPECT_EQ(2 * sizeof(string), before.config.comparisonLists);
+
+    client->getValue("flag", false);
+
+    const auto after = client->memoryStats();
+    EXPECT_GT(after.config.settings, before.config.settings);
+    EXPECT_EQ(4 * sizeof(string), after.config.comparisonLists);
+}
+
+TEST_F(MemoryStatsTest, RetiredSnapshots) {
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson});
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson2});
+    auto options = createOptions();
+    vector<shared_ptr<const Settings>> heldSettings;
+    options.hooks = make_shared<Hooks>();
+    options.hooks->addOnConfigChanged([&](shared_ptr<const Settings> settings) { heldSettings.push_back(settings); });
+    auto client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    client->forceRefresh();
+    const auto firstConfig = client->memoryStats().config;
+    client->forceRefresh();
+
+    auto stats = client->memoryStats();
+    EXPECT_EQ(1, stats.retiredSnapshots);
+    // Only the settings are alive, which reference the segments and the strings of the config (but not the preferences).
+    EXPECT_EQ(firstConfig.segments, stats.retiredSnapshotsMemory.segments);
+    EXPECT_EQ(firstConfig.comparisonLists, stats.retiredSnapshotsMemory.comparisonLists);
+    EXPECT_EQ(firstConfig.strings - strlen("https://cdn-global.configcat.com") - 1, stats.retiredSnapshotsMemory.strings);
+    EXPECT_EQ(stats.config.total() + stats.configJsonString + stats.cachedEntryString + stats.retiredSnapshotsMemory.total(), stats.totalBytes());
+
+    heldSettings.clear();
+
+    stats = client->memoryStats();
+    EXPECT_EQ(0, stats.retiredSnapshots);
+    EXPECT_EQ(0, stats.retiredSnapshotsMemory.total());
+}
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "mock.h"
+#include "configcat/configcat.h"
+
+using namespace configcat;
+using namespace std;
+
+class MetricsTest : public ::testing::Test {
+public:
+    static constexpr char kTestSdkKey[] = "TestSdkKey-23456789012/1234567890123456789012";
+    static constexpr char kTestJson[] = R"({"p":{"u":"https://cdn-global.configcat.com","r":0,"s":"salt"},"f":{)"
+        R"("flag":{"t":0,"v":{"b":false},"i":"off","r":[{"c":[{"u":{"a":"Email","c":0,"l":["a@example.com"]}}],"s":{"v":{"b":true},"i":"on"}}]},)"
+        R"("text":{"t":1,"v":{"s":"default"}})"
+        R"(}})";
+
+    shared_ptr<ConfigCatClient> client = nullptr;
+    shared_ptr<MockHttpSessionAdapter> mockHttpSessionAdapter = make_shared<MockHttpSessionAdapter>();
+    shared_ptr<InMemoryConfigCache> configCache = make_shared<InMemoryConfigCache>();
+
+    void createClient(bool collectMetrics = true) {
+        ConfigCatOptions options;
+        options.pollingMode = PollingMode::manualPoll();
+        options.httpSessionAdapter = mockHttpSessionAdapter;
+        options.configCache = configCache;
+        options.logger = make_shared<TestLogger>();
+        options.collectMetrics = collectMetrics;
+        client = ConfigCatClient::get(kTestSdkKey, &options);
+    }
+
+    void TearDown() override {
+        ConfigCatClient::closeAll();
+    }
+};
+
+TEST_F(MetricsTest, DisabledByDefault) {
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson});
+    createClient(false);
+    client->forceRefresh();
+    client->getValue("flag", false);
+
+    const auto metrics = client->metrics();
+    EXPECT_TRUE(metrics.evaluations.empty());
+    EXPECT_EQ(0, metrics.fetches());
+    EXPECT_TRUE(isnan(metrics.configAgeSeconds));
+}
+
+TEST_F(MetricsTest, EvaluationsPerVariation) {
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson});
+    createClient();
+    client->forceRefresh();
+
+    const auto matchingUser = ConfigCatUser::create("id", "a@example.com");
+    const auto otherUser = ConfigCatUser::create("id", "b@example.com");
+    EXPECT_TRUE(client->getValue("flag", false, matchingUser));
+    EXPECT_FALSE(client->getValue("flag", false, otherUser));
+    EXPECT_FALSE(client->getValueDetails("flag", false, otherUser).value);
+    EXPECT_EQ("default", client->getValue("text", ""));
+
+    const auto metrics = client->metrics();
+    EXPECT_EQ(1, metrics.evaluations.at("flag").at("on"));
+    EXPECT_EQ(2, metrics.evaluations.at("flag").at("off"));
+    EXPECT_EQ(1, metrics.evaluations.at("text").at(""));
+    EXPECT_EQ(4, metrics.evaluationLatency.count);
+    EXPECT_EQ(metrics.evaluationLatency.upperBounds.size() + 1, metrics.evaluationLatency.bucketCounts.size());
+}
+
+TEST_F(MetricsTest, ErrorsByEventId) {
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson});
+    createClient();
+
+    client->getValue("flag", false); // 1000: no config yet
+    client->forceRefresh();
+    client->getValue("missing", false); // 1001: missing key
+    client->getValue("missing", false);
+
+    const auto metrics = client->metrics();
+    EXPECT_EQ(1, metrics.errors.at(1000));
+    EXPECT_EQ(2, metrics.errors.at(1001));
+    EXPECT_EQ(metrics.evaluations.end(), metrics.evaluations.find("missing"));
+}
+
+TEST_F(MetricsTest, FetchesAndCache) {
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson, {{"ETag", "etag1"}}});
+    mockHttpSessionAdapter->enqueueResponse({304, ""});
+    mockHttpSessionAdapter->enqueueResponse({500, ""});
+    createClient();
+
+    EXPECT_TRUE(isnan(client->metrics().configAgeSeconds));
+
+    client->forceRefresh();
+    client->forceRefresh();
+    client->forceRefresh();
+
+    const auto metrics = client->metrics();
+    EXPECT_EQ(1, metrics.fetchesModified);
+    EXPECT_EQ(1, metrics.fetchesNotModified);
+    EXPECT_EQ(1, metrics.fetchesFailed);
+    EXPECT_EQ(3, metrics.fetchLatency.count);
+    EXPECT_GE(metrics.configAgeSeconds, 0);
+    EXPECT_LT(metrics.configAgeSeconds, 60);
+    EXPECT_GT(metrics.cacheReadLatency.count, 0);
+    EXPECT_EQ(2, metrics.cacheWriteLatency.count); // the 200 and the 304 (which refreshes the fetch time)
+}
+
+TEST_F(MetricsTest, PrometheusText) {
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson});
+    createClient();
+    client->forceRefresh();
+    client->getValue("flag", false);
+    client->getValue("missing", false);
+
+    const auto text = client->metrics().toPrometheusText("app_configcat");
+    EXPECT_NE(string::npos, text.find("# TYPE app_configcat_evaluations_total counter\n"));
+    EXPECT_NE(string::npos, text.find("app_configcat_evaluations_total{key=\"flag\",variation_id=\"off\"} 1\n"));
+    EXPECT_NE(string::npos, text.find("app_configcat_errors_total{event_id=\"1001\"} 1\n"));
+    EXPECT_NE(string::npos, text.find("app_configcat_fetches_total{result=\"modified\"} 1\n"));
+    EXPECT_NE(string::npos, text.find("# TYPE app_configcat_fetch_duration_seconds histogram\n"));
+    EXPECT_NE(string::npos, text.find("app_configcat_fetch_duration_seconds_bucket{le=\"+Inf\"} 1\n"));
+    EXPECT_NE(string::npos, text.find("app_configcat_evaluation_duration_seconds_bucket{le=\"1e-06\"} "));
+    EXPECT_NE(string::npos, text.find("app_configcat_config_age_seconds "));
+}
+
+TEST(MetricsSnapshotTest, EscapesLabelValues) {
+    MetricsSnapshot snapshot;
+    snapshot.evaluations["a\"b\\c\nd"][""] = 3;
+
+    const auto text = snapshot.toPrometheusText();
+    EXPECT_NE(string::npos, text.find("configcat_evaluations_total{key=\"a\\\"b\\\\c\\nd\",variation_id=\"\"} 3\n"));
+    EXPECT_NE(string::npos, text.find("configcat_config_age_seconds NaN\n"));
+    EXPECT_NE(string::npos, text.find("configcat_fetch_duration_seconds_bucket{le=\"+Inf\"} 0\n"));
+}
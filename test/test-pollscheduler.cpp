@@ -0,0 +1,231 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include "pollscheduler.h"
+
+using namespace configcat;
+using namespace std;
+using namespace std::chrono;
+using namespace std::this_thread;
+
+TEST(PollSchedulerTest, RunsPeriodically) {
+    auto scheduler = PollScheduler::getInstance();
+    atomic<int> count = 0;
+    auto timer = scheduler->schedule([&] { ++count; }, milliseconds(0), milliseconds(100));
+
+    sleep_for(milliseconds(550));
+    scheduler->cancel(timer);
+
+    EXPECT_GE(count, 5);
+    EXPECT_LE(count, 7);
+    EXPECT_EQ(0, scheduler->timerCount());
+}
+
+TEST(PollSchedulerTest, InitialDelay) {
+    auto scheduler = PollScheduler::getInstance();
+    atomic<int> count = 0;
+    auto timer = scheduler->schedule([&] { ++count; }, milliseconds(300), seconds(60));
+
+    sleep_for(milliseconds(150));
+    EXPECT_EQ(0, count);
+    sleep_for(milliseconds(300));
+    EXPECT_EQ(1, count);
+
+    scheduler->cancel(timer);
+}
+
+TEST(PollSchedulerTest, CancelWaitsForRunningTask) {
+    auto scheduler = PollScheduler::getInstance();
+    atomic<bool> started = false;
+    atomic<bool> finished = false;
+    auto timer = scheduler->schedule([&] {
+        started = true;
+        sleep_for(milliseconds(200));
+        finished = true;
+    }, milliseconds(0), milliseconds(10));
+
+    while (!started) {
+        sleep_for(milliseconds(1));
+    }
+    scheduler->cancel(timer);
+    EXPECT_TRUE(finished);
+
+    // The task doesn't run again after the cancellation.
+    finished = false;
+    sleep_for(milliseconds(100));
+    EXPECT_FALSE(finished);
+}
+
+TEST(PollSchedulerTest, ManyTimersOnFewThreads) {
+    auto scheduler = PollScheduler::getInstance();
+    constexpr int kTimerCount = 500;
+    vector<atomic<int>> counts(kTimerCount);
+    vector<shared_ptr<PollScheduler::Timer>> timers;
+    for (int i = 0; i < kTimerCount; ++i) {
+        // Spread the intervals over several levels of the wheel.
+        const auto interval = milliseconds(100 + (i % 5) * 100);
+        timers.push_back(scheduler->schedule([&counts, i] { ++counts[i]; }, milliseconds(i % 50), interval));
+    }
+    EXPECT_EQ(kTimerCount, scheduler->timerCount());
+
+    sleep_for(milliseconds(1100));
+    for (auto& timer : timers) {
+        scheduler->cancel(timer);
+    }
+
+    for (int i = 0; i < kTimerCount; ++i) {
+        const int interval = 100 + (i % 5) * 100;
+        // The first run is (almost) immediate, then one run per interval.
+        EXPECT_GE(counts[i], 1000 / interval - 1) << "timer " << i;
+        EXPECT_LE(counts[i], 1100 / interval + 1) << "timer " << i;
+    }
+    EXPECT_EQ(0, scheduler->timerCount());
+}
+
+TEST(PollSchedulerTest, LongDelayIsCascaded) {
+    auto scheduler = PollScheduler::getInstance();
+    atomic<int> count = 0;
+    // 64 ticks is the range of the first level, this timer starts at the second one.
+    auto timer = scheduler->schedule([&] { ++count; }, PollScheduler::kTickDuration * 70, seconds(60));
+
+    sleep_for(PollScheduler::kTickDuration * 60);
+    EXPECT_EQ(0, count);
+    sleep_for(PollScheduler::kTickDuration * 30);
+    EXPECT_EQ(1, count);
+
+    scheduler->cancel(timer);
+}
+
+TEST(PollSchedulerTest, ScheduleOnce) {
+    auto scheduler = PollScheduler::getInstance();
+    atomic<int> count = 0;
+    auto timer = scheduler->scheduleOnce([&] { ++count; }, milliseconds(50));
+
+    sleep_for(milliseconds(300));
+    EXPECT_EQ(1, count);
+    EXPECT_EQ(0, scheduler->timerCount());
+
+    // Cancelling a completed one-shot timer is a no-op.
+    scheduler->cancel(timer);
+    EXPECT_EQ(0, scheduler->timerCount());
+}
+
+TEST(PollSchedulerTest, DynamicInterval) {
+    auto scheduler = PollScheduler::getInstance();
+    vector<steady_clock::time_point> runs;
+    mutex runsMutex;
+    atomic<int> intervalMs = 50;
+    auto timer = scheduler->schedule([&] {
+        lock_guard<mutex> lock(runsMutex);
+        runs.push_back(steady_clock::now());
+    }, milliseconds(0), [&] {
+        // Doubles the interval after each run.
+        return milliseconds(intervalMs.exchange(intervalMs * 2));
+    });
+
+    sleep_for(milliseconds(500));
+    scheduler->cancel(timer);
+
+    lock_guard<mutex> lock(runsMutex);
+    // Runs at 0, 50, 150 and 350 ms.
+    ASSERT_EQ(4, runs.size());
+    EXPECT_GE(runs[3] - runs[2], milliseconds(200));
+}
+
+TEST(PollSchedulerTest, BlockedWorkersDontHoldUpDueTasks) {
+    auto scheduler = PollScheduler::getInstance();
+    atomic<bool> released = false;
+    vector<shared_ptr<PollScheduler::Timer>> blockingTimers;
+    // The pool starts with a single worker, the next one is added for the due task.
+    for (size_t i = 0; i + 1 < PollScheduler::getWorkerCount(); ++i) {
+        // Like a fetch that takes long.
+        blockingTimers.push_back(scheduler->scheduleOnce([&] {
+            while (!released) {
+                sleep_for(milliseconds(10));
+            }
+        }, milliseconds(0)));
+    }
+    atomic<bool> ran = false;
+    scheduler->scheduleOnce([&] { ran = true; }, milliseconds(50));
+
+    sleep_for(milliseconds(300));
+    EXPECT_TRUE(ran);
+
+    released = true;
+    for (auto& blockingTimer : blockingTimers) {
+        scheduler->cancel(blockingTimer);
+    }
+}
+
+TEST(PollSchedulerTest, WorkerCountIsHardCap) {
+    auto scheduler = PollScheduler::getInstance();
+    atomic<bool> released = false;
+    vector<shared_ptr<PollScheduler::Timer>> blockingTimers;
+    for (size_t i = 0; i < PollScheduler::getWorkerCount(); ++i) {
+        blockingTimers.push_back(scheduler->scheduleOnce([&] {
+            while (!released) {
+                sleep_for(milliseconds(10));
+            }
+        }, milliseconds(0)));
+    }
+    atomic<bool> ran = false;
+    scheduler->scheduleOnce([&] { ran = true; }, milliseconds(50));
+
+    // All the workers are busy, the due task waits for one of them.
+    sleep_for(milliseconds(300));
+    EXPECT_FALSE(ran);
+
+    released = true;
+    const auto deadline = steady_clock::now() + seconds(2);
+    while (!ran && steady_clock::now() < deadline) {
+        sleep_for(milliseconds(10));
+    }
+    EXPECT_TRUE(ran);
+    for (auto& blockingTimer : blockingTimers) {
+        scheduler->cancel(blockingTimer);
+    }
+}
+
+TEST(PollSchedulerTest, CancelledByItsOwnTask) {
+    auto scheduler = PollScheduler::getInstance();
+    shared_ptr<PollScheduler::Timer> timer;
+    mutex timerMutex;
+    atomic<int> runCount = 0;
+    atomic<int> intervalCount = 0;
+    {
+        lock_guard<mutex> lock(timerMutex);
+        timer = scheduler->schedule([&] {
+            ++runCount;
+            lock_guard<mutex> lock(timerMutex);
+            scheduler->cancel(timer);
+        }, milliseconds(0), [&] {
+            // Like the polling of a client destroyed by the task, whatever this refers to may be gone.
+            ++intervalCount;
+            return milliseconds(10);
+        });
+    }
+
+    sleep_for(milliseconds(200));
+    EXPECT_EQ(1, runCount);
+    EXPECT_EQ(0, intervalCount);
+    EXPECT_EQ(0, scheduler->timerCount());
+}
+
+TEST(PollSchedulerTest, ReleasedByItsOwnTask) {
+    auto scheduler = PollScheduler::getInstance();
+    weak_ptr<PollScheduler> weakScheduler = scheduler;
+    auto holder = make_shared<shared_ptr<PollScheduler>>(scheduler);
+    atomic<bool> ran = false;
+    scheduler->scheduleOnce([holder, &ran] {
+        holder->reset();
+        ran = true;
+    }, milliseconds(50));
+    scheduler.reset();
+
+    // The last reference is released on the worker running the task, which can't join itself.
+    const auto deadline = steady_clock::now() + seconds(2);
+    while (!weakScheduler.expired() && steady_clock::now() < deadline) {
+        sleep_for(milliseconds(10));
+    }
+    EXPECT_TRUE(ran);
+    EXPECT_TRUE(weakScheduler.expired());
+}
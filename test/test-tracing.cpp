@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <nlohmann/json.hpp>
+#include "mock.h"
+#include "configentry.h"
+#include "configcat/configcat.h"
+
+using namespace configcat;
+using namespace std;
+using json = nlohmann::json;
+
+class InMemorySpanExporter : public SpanExporter {
+public:
+    void exportSpan(const Span& span) override {
+        lock_guard<mutex> lock(spansMutex);
+        spans.push_back(span);
+    }
+
+    vector<Span> getSpans() {
+        lock_guard<mutex> lock(spansMutex);
+        return spans;
+    }
+
+    const Span* find(const string& name) {
+        lock_guard<mutex> lock(spansMutex);
+        const auto it = find_if(spans.begin(), spans.end(), [&](const Span& span) { return span.name == name; });
+        return it != spans.end() ? &*it : nullptr;
+    }
+
+private:
+    mutex spansMutex;
+    vector<Span> spans;
+};
+
+class TracingTest : public ::testing::Test {
+public:
+    static constexpr char kTestSdkKey[] = "TestSdkKey-23456789012/1234567890123456789012";
+    static constexpr char kTestJson[] = R"({"f":{"flag":{"t":0,"v":{"b":true},"i":"id1"}}})";
+
+    shared_ptr<MockHttpSessionAdapter> mockHttpSessionAdapter = make_shared<MockHttpSessionAdapter>();
+    shared_ptr<InMemorySpanExporter> exporter = make_shared<InMemorySpanExporter>();
+
+    ConfigCatOptions createOptions() {
+        ConfigCatOptions options;
+        options.pollingMode = PollingMode::manualPoll();
+        options.httpSessionAdapter = mockHttpSessionAdapter;
+        options.configCache = make_shared<InMemoryConfigCache>();
+        options.spanExporter = exporter;
+        return options;
+    }
+
+    void TearDown() override {
+        ConfigCatClient::closeAll();
+    }
+};
+
+TEST_F(TracingTest, Refresh) {
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson, {{"ETag", "etag1"}}});
+    const auto options = createOptions();
+    auto client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    client->forceRefresh();
+
+    const auto fetchIfOlder = exporter->find("configcat.fetch_if_older");
+    ASSERT_NE(nullptr, fetchIfOlder);
+    EXPECT_EQ(0, fetchIfOlder->parentSpanId);
+    EXPECT_EQ("started", fetchIfOlder->attributes.at("fetch"));
+
+    for (const auto name : {"configcat.http_fetch", "configcat.parse", "configcat.snapshot_swap", "configcat.cache_write"}) {
+        const auto span = exporter->find(name);
+        ASSERT_NE(nullptr, span) << name;
+        EXPECT_EQ(fetchIfOlder->spanId, span->parentSpanId) << name;
+        EXPECT_EQ(fetchIfOlder->traceIdHigh, span->traceIdHigh) << name;
+        EXPECT_EQ(fetchIfOlder->traceIdLow, span->traceIdLow) << name;
+        EXPECT_LE(span->duration, fetchIfOlder->duration) << name;
+    }
+    EXPECT_EQ("200", exporter->find("configcat.http_fetch")->attributes.at("http.status_code"));
+    EXPECT_EQ("fetch", exporter->find("configcat.snapshot_swap")->attributes.at("source"));
+    EXPECT_EQ("false", exporter->find("configcat.parse")->attributes.at("streamed"));
+}
+
+TEST_F(TracingTest, EvaluationsDontProduceSpansByDefault) {
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson});
+    const auto options = createOptions();
+    auto client = ConfigCatClient::get(kTestSdkKey, &options);
+    client->forceRefresh();
+    // The first read loads the entry written by the refresh.
+    EXPECT_TRUE(client->getValue("flag", false));
+    const auto spanCount = exporter->getSpans().size();
+
+    // Checking the cache on each evaluation is not interesting when nothing changes.
+    EXPECT_TRUE(client->getValue("flag", false));
+    EXPECT_TRUE(client->getValue("flag", false));
+
+    EXPECT_EQ(spanCount, exporter->getSpans().size());
+}
+
+TEST_F(TracingTest, SampledEvaluations) {
+    mockHttpSessionAdapter->enqueueResponse({200, kTestJson});
+    auto options = createOptions();
+    options.traceEvaluationSampleRate = 1;
+    auto client = ConfigCatClient::get(kTestSdkKey, &options);
+    client->forceRefresh();
+
+    EXPECT_TRUE(client->getValue("flag", false));
+
+    const auto evaluate = exporter->find("configcat.evaluate");
+    ASSERT_NE(nullptr, evaluate);
+    EXPECT_EQ("flag", evaluate->attributes.at("key"));
+    EXPECT_EQ("id1", evaluate->attributes.at("variation_id"));
+}
+
+TEST_F(TracingTest, CacheRead) {
+    auto options = createOptions();
+    options.configCache = make_shared<SingleValueCache>(ConfigEntry(Config::fromJson(kTestJson), "etag1", kTestJson, get_utcnowseconds_since_epoch()).serialize());
+    auto client = ConfigCatClient::get(kTestSdkKey, &options);
+
+    EXPECT_TRUE(client->getValue("flag", false));
+
+    const auto fetchIfOlder = exporter->find("configcat.fetch_if_older");
+    ASSERT_NE(nullptr, fetchIfOlder);
+    EXPECT_EQ("none", fetchIfOlder->attributes.at("fetch"));
+    const auto cacheRead = exporter->find("configcat.cache_read");
+    ASSERT_NE(nullptr, cacheRead);
+    EXPECT_EQ(fetchIfOlder->spanId, cacheRead->parentSpanId);
+    const auto snapshotSwap = exporter->find("configcat.snapshot_swap");
+    ASSERT_NE(nullptr, snapshotSwap);
+    EXPECT_EQ("cache", snapshotSwap->attributes.at("source"));
+    EXPECT_EQ(nullptr, exporter->find("configcat.http_fetch"));
+}
+
+class FileSpanExporterTest : public ::testing::Test {
+public:
+    filesystem::path path = filesystem::temp_directory_path() / ("configcat-trace-" + to_string(random_device{}()) + ".json");
+
+    void TearDown() override {
+        filesystem::remove(path);
+    }
+
+    static Span createSpan(const string& name, uint64_t spanId, uint64_t parentSpanId) {
+        Span span;
+        span.name = name;
+        span.traceIdHigh = 0x0123456789abcdef;
+        span.traceIdLow = 1;
+        span.spanId = spanId;
+        span.parentSpanId = parentSpanId;
+        span.startTime = chrono::system_clock::time_point(chrono::microseconds(1700000000000000));
+        span.duration = chrono::microseconds(1500);
+        span.threadId = 2;
+        span.attributes["key"] = "value";
+        return span;
+    }
+
+    string readFile() {
+        ifstream file(path);
+        return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    }
+};
+
+TEST_F(FileSpanExporterTest, ChromeTrace) {
+    {
+        FileSpanExporter exporter(path.string(), FileSpanExporter::Format::chromeTrace, 1);
+        exporter.exportSpan(createSpan("configcat.fetch_if_older", 1, 0));
+        exporter.exportSpan(createSpan("configcat.http_fetch", 2, 1));
+    }
+
+    const auto events = json::parse(readFile());
+    ASSERT_EQ(2, events.size());
+    EXPECT_EQ("configcat.fetch_if_older", events[0]["name"]);
+    EXPECT_EQ("X", events[0]["ph"]);
+    EXPECT_EQ(1700000000000000.0, events[0]["ts"].get<double>());
+    EXPECT_EQ(1500.0, events[0]["dur"].get<double>());
+    EXPECT_EQ(2, events[0]["tid"]);
+    EXPECT_EQ("value", events[0]["args"]["key"]);
+    EXPECT_EQ("0123456789abcdef0000000000000001", events[1]["args"]["trace_id"]);
+    EXPECT_EQ("0000000000000001", events[1]["args"]["parent_span_id"]);
+}
+
+TEST_F(FileSpanExporterTest, ChromeTraceIsReadableBeforeClose) {
+    FileSpanExporter exporter(path.string(), FileSpanExporter::Format::chromeTrace, 10);
+    exporter.exportSpan(createSpan("configcat.parse", 1, 0));
+    exporter.flush();
+    // The viewers accept the array without the closing bracket, which is written on destruction.
+    const auto events = json::parse(readFile() + "]");
+    EXPECT_EQ(1, events.size());
+}
+
+TEST_F(FileSpanExporterTest, OtlpJson) {
+    {
+        FileSpanExporter exporter(path.string(), FileSpanExporter::Format::otlpJson, 2);
+        exporter.exportSpan(createSpan("configcat.fetch_if_older", 1, 0));
+        exporter.exportSpan(createSpan("configcat.http_fetch", 2, 1));
+        exporter.exportSpan(createSpan("configcat.parse", 3, 1));
+    }
+
+    // One request per batch.
+    ifstream file(path);
+    vector<json> requests;
+    for (string line; getline(file, line);) {
+        requests.push_back(json::parse(line));
+    }
+    ASSERT_EQ(2, requests.size());
+
+    const auto& spans = requests[0]["resourceSpans"][0]["scopeSpans"][0]["spans"];
+    ASSERT_EQ(2, spans.size());
+    EXPECT_EQ("0123456789abcdef0000000000000001", spans[0]["traceId"]);
+    EXPECT_EQ("0000000000000001", spans[0]["spanId"]);
+    EXPECT_FALSE(spans[0].contains("parentSpanId"));
+    EXPECT_EQ("1700000000000000000", spans[0]["startTimeUnixNano"]);
+    EXPECT_EQ("1700000000001500000", spans[0]["endTimeUnixNano"]);
+    EXPECT_EQ(1, spans[0]["kind"]);
+    EXPECT_EQ("configcat.http_fetch", spans[1]["name"]);
+    EXPECT_EQ("0000000000000001", spans[1]["parentSpanId"]);
+    EXPECT_EQ(3, spans[1]["kind"]);
+    EXPECT_EQ(1, requests[1]["resourceSpans"][0]["scopeSpans"][0]["spans"].size());
+}